@@ -24,6 +24,11 @@
 #include "sharpyuv/sharpyuv_dsp.h"
 #include "sharpyuv/sharpyuv_gamma.h"
 
+#if defined(WEBP_USE_THREAD) && !defined(_WIN32)
+#include <pthread.h>  // NOLINT
+#define SHARPYUV_USE_THREAD
+#endif
+
 //------------------------------------------------------------------------------
 
 int SharpYuvGetVersion(void) {
@@ -35,6 +40,17 @@ int SharpYuvGetVersion(void) {
 
 static const int kNumIterations = 4;
 
+// Maximum number of bands processed concurrently, and minimum number of row
+// pairs in each of them.
+#define MAX_THREADS 16
+static const int kMinPairsPerBand = 16;
+
+// In low-memory mode, the image is converted by strips of kStripPairs row
+// pairs. Each strip is refined together with kStripOverlap pairs of context
+// above and below it, which are discarded.
+static const int kStripPairs = 64;
+static const int kStripOverlap = 8;
+
 #define YUV_FIX 16  // fixed-point precision for RGB->YUV
 static const int kYuvHalf = 1 << (YUV_FIX - 1);
 
@@ -292,6 +308,178 @@ static int ConvertWRGBToYUV(const fixed_y_t* best_y, const fixed_t* best_uv,
 //------------------------------------------------------------------------------
 // Main function
 
+// Per-band state of the conversion. The image is split in horizontal bands
+// of row pairs [j_start, j_end) that can be processed concurrently.
+typedef struct {
+  // common parameters
+  const uint8_t* r_ptr;
+  const uint8_t* g_ptr;
+  const uint8_t* b_ptr;
+  int rgb_step, rgb_stride, rgb_bit_depth;
+  int width, height;
+  SharpYuvTransferFunctionType transfer_type;
+  int base_j;            // image row stored first in the *_base buffers
+  fixed_y_t* best_y_base;
+  fixed_y_t* target_y_base;
+  fixed_t* best_uv_base;
+  fixed_t* target_uv_base;
+  // band
+  int j_start, j_end;
+  // scratch
+  fixed_y_t* tmp_buffer;
+  fixed_y_t* best_rgb_y;
+  fixed_t* best_rgb_uv;
+  // copies of the chroma rows just above and below the band, taken before
+  // each iteration. NULL at the image borders, or if there is only one band.
+  fixed_t* top_uv;
+  fixed_t* bottom_uv;
+  uint64_t diff_y_sum;   // result of the last iteration
+} SharpYuvBand;
+
+// Imports the RGB samples of the band to W/RGB representation.
+static void ImportRows(SharpYuvBand* const band) {
+  const int w = (band->width + 1) & ~1;
+  const int uv_w = w >> 1;
+  const int height = band->height;
+  const int rgb_stride = band->rgb_stride;
+  const uint8_t* r_ptr = band->r_ptr + (ptrdiff_t)band->j_start * rgb_stride;
+  const uint8_t* g_ptr = band->g_ptr + (ptrdiff_t)band->j_start * rgb_stride;
+  const uint8_t* b_ptr = band->b_ptr + (ptrdiff_t)band->j_start * rgb_stride;
+  const int j0 = band->j_start - band->base_j;
+  fixed_y_t* best_y = band->best_y_base + (size_t)j0 * w;
+  fixed_y_t* target_y = band->target_y_base + (size_t)j0 * w;
+  fixed_t* best_uv = band->best_uv_base + (size_t)(j0 >> 1) * 3 * uv_w;
+  fixed_t* target_uv = band->target_uv_base + (size_t)(j0 >> 1) * 3 * uv_w;
+  const int j_end = (band->j_end < height) ? band->j_end : height;
+  int j;
+
+  for (j = band->j_start; j < j_end; j += 2) {
+    const int is_last_row = (j == height - 1);
+    fixed_y_t* const src1 = band->tmp_buffer + 0 * w;
+    fixed_y_t* const src2 = band->tmp_buffer + 3 * w;
+
+    // prepare two rows of input
+    ImportOneRow(r_ptr, g_ptr, b_ptr, band->rgb_step, band->rgb_bit_depth,
+                 band->width, src1);
+    if (!is_last_row) {
+      ImportOneRow(r_ptr + rgb_stride, g_ptr + rgb_stride, b_ptr + rgb_stride,
+                   band->rgb_step, band->rgb_bit_depth, band->width, src2);
+    } else {
+      memcpy(src2, src1, 3 * w * sizeof(*src2));
+    }
+    StoreGray(src1, best_y + 0, w);
+    StoreGray(src2, best_y + w, w);
+
+    UpdateW(src1, target_y, w, band->rgb_bit_depth, band->transfer_type);
+    UpdateW(src2, target_y + w, w, band->rgb_bit_depth, band->transfer_type);
+    UpdateChroma(src1, src2, target_uv, uv_w, band->rgb_bit_depth,
+                 band->transfer_type);
+    memcpy(best_uv, target_uv, 3 * uv_w * sizeof(*best_uv));
+    best_y += 2 * w;
+    best_uv += 3 * uv_w;
+    target_y += 2 * w;
+    target_uv += 3 * uv_w;
+    r_ptr += 2 * rgb_stride;
+    g_ptr += 2 * rgb_stride;
+    b_ptr += 2 * rgb_stride;
+  }
+}
+
+// Runs one refinement iteration over the band and stores the sum of the luma
+// differences in band->diff_y_sum.
+static void RefineRows(SharpYuvBand* const band) {
+  const int w = (band->width + 1) & ~1;
+  const int uv_w = w >> 1;
+  const int y_bit_depth =
+      band->rgb_bit_depth + GetPrecisionShift(band->rgb_bit_depth);
+  const int j0 = band->j_start - band->base_j;
+  fixed_y_t* best_y = band->best_y_base + (size_t)j0 * w;
+  fixed_y_t* target_y = band->target_y_base + (size_t)j0 * w;
+  fixed_t* best_uv = band->best_uv_base + (size_t)(j0 >> 1) * 3 * uv_w;
+  fixed_t* target_uv = band->target_uv_base + (size_t)(j0 >> 1) * 3 * uv_w;
+  const fixed_t* cur_uv = best_uv;
+  const fixed_t* prev_uv = (band->top_uv != NULL) ? band->top_uv : cur_uv;
+  uint64_t diff_y_sum = 0;
+  int j = band->j_start;
+
+  do {
+    fixed_y_t* const src1 = band->tmp_buffer + 0 * w;
+    fixed_y_t* const src2 = band->tmp_buffer + 3 * w;
+    {
+      const fixed_t* const next_uv =
+          (j + 2 < band->j_end) ? cur_uv + 3 * uv_w :
+          (band->bottom_uv != NULL) ? band->bottom_uv : cur_uv;
+      InterpolateTwoRows(best_y, prev_uv, cur_uv, next_uv, w,
+                         src1, src2, band->rgb_bit_depth);
+      prev_uv = cur_uv;
+      cur_uv = next_uv;
+    }
+
+    UpdateW(src1, band->best_rgb_y + 0 * w, w, band->rgb_bit_depth,
+            band->transfer_type);
+    UpdateW(src2, band->best_rgb_y + 1 * w, w, band->rgb_bit_depth,
+            band->transfer_type);
+    UpdateChroma(src1, src2, band->best_rgb_uv, uv_w, band->rgb_bit_depth,
+                 band->transfer_type);
+
+    // update two rows of Y and one row of RGB
+    diff_y_sum +=
+        SharpYuvUpdateY(target_y, band->best_rgb_y, best_y, 2 * w, y_bit_depth);
+    SharpYuvUpdateRGB(target_uv, band->best_rgb_uv, best_uv, 3 * uv_w);
+
+    best_y += 2 * w;
+    best_uv += 3 * uv_w;
+    target_y += 2 * w;
+    target_uv += 3 * uv_w;
+    j += 2;
+  } while (j < band->j_end);
+  band->diff_y_sum = diff_y_sum;
+}
+
+typedef void (*SharpYuvBandFunc)(SharpYuvBand* const band);
+
+#if defined(SHARPYUV_USE_THREAD)
+typedef struct {
+  SharpYuvBandFunc func;
+  SharpYuvBand* band;
+} SharpYuvJob;
+
+static void* BandThreadLoop(void* ptr) {
+  SharpYuvJob* const job = (SharpYuvJob*)ptr;
+  job->func(job->band);
+  return NULL;
+}
+#endif  // SHARPYUV_USE_THREAD
+
+// Calls 'func' on each of the 'num_bands' bands, concurrently if possible.
+static void ProcessBands(SharpYuvBandFunc func, SharpYuvBand* const bands,
+                         int num_bands) {
+#if defined(SHARPYUV_USE_THREAD)
+  pthread_t threads[MAX_THREADS];
+  SharpYuvJob jobs[MAX_THREADS];
+  int launched[MAX_THREADS];
+  int i;
+  assert(num_bands <= MAX_THREADS);
+  for (i = 1; i < num_bands; ++i) {
+    jobs[i].func = func;
+    jobs[i].band = &bands[i];
+    launched[i] = !pthread_create(&threads[i], NULL, BandThreadLoop, &jobs[i]);
+    // If the thread couldn't be created, the band is processed below instead.
+  }
+  func(&bands[0]);
+  for (i = 1; i < num_bands; ++i) {
+    if (launched[i]) {
+      pthread_join(threads[i], NULL);
+    } else {
+      func(&bands[i]);
+    }
+  }
+#else
+  int i;
+  for (i = 0; i < num_bands; ++i) func(&bands[i]);
+#endif  // SHARPYUV_USE_THREAD
+}
+
 static void* SafeMalloc(uint64_t nmemb, size_t size) {
   const uint64_t total_size = nmemb * (uint64_t)size;
   if (total_size != (size_t)total_size) return NULL;
@@ -307,129 +495,137 @@ static int DoSharpArgbToYuv(const uint8_t* r_ptr, const uint8_t* g_ptr,
                             int v_stride, int yuv_bit_depth, int width,
                             int height,
                             const SharpYuvConversionMatrix* yuv_matrix,
-                            SharpYuvTransferFunctionType transfer_type) {
+                            SharpYuvTransferFunctionType transfer_type,
+                            int num_threads, int low_memory) {
   // we expand the right/bottom border if needed
   const int w = (width + 1) & ~1;
   const int h = (height + 1) & ~1;
   const int uv_w = w >> 1;
   const int uv_h = h >> 1;
-  const int y_bit_depth = rgb_bit_depth + GetPrecisionShift(rgb_bit_depth);
-  uint64_t prev_diff_y_sum = ~0;
-  int j, iter;
+  // Number of row pairs output per strip, and held in the buffers.
+  const int strip_pairs = low_memory ? kStripPairs : uv_h;
+  const int overlap = low_memory ? kStripOverlap : 0;
+  const int buf_pairs =
+      (strip_pairs + 2 * overlap < uv_h) ? strip_pairs + 2 * overlap : uv_h;
+  // Split the row pairs in bands of at least kMinPairsPerBand pairs.
+  const int max_bands = (buf_pairs + kMinPairsPerBand - 1) / kMinPairsPerBand;
+  const int max_threads = (num_threads < 1) ? 1 :
+                          (num_threads > max_bands) ? max_bands : num_threads;
+  const int halo_size = (max_threads > 1) ? 2 * 3 * uv_w : 0;
+  int p0, p1, c0, c1;   // processed and output row pairs of the strip
+  int b, iter;
 
   // TODO(skal): allocate one big memory chunk. But for now, it's easier
   // for valgrind debugging to have several chunks.
-  fixed_y_t* const tmp_buffer = SAFE_ALLOC(w * 3, 2, fixed_y_t);   // scratch
-  fixed_y_t* const best_y_base = SAFE_ALLOC(w, h, fixed_y_t);
-  fixed_y_t* const target_y_base = SAFE_ALLOC(w, h, fixed_y_t);
-  fixed_y_t* const best_rgb_y = SAFE_ALLOC(w, 2, fixed_y_t);
-  fixed_t* const best_uv_base = SAFE_ALLOC(uv_w * 3, uv_h, fixed_t);
-  fixed_t* const target_uv_base = SAFE_ALLOC(uv_w * 3, uv_h, fixed_t);
-  fixed_t* const best_rgb_uv = SAFE_ALLOC(uv_w * 3, 1, fixed_t);
-  fixed_y_t* best_y = best_y_base;
-  fixed_y_t* target_y = target_y_base;
-  fixed_t* best_uv = best_uv_base;
-  fixed_t* target_uv = target_uv_base;
-  const uint64_t diff_y_threshold = (uint64_t)(3.0 * w * h);
-  int ok;
+  fixed_y_t* const tmp_buffer =    // scratch
+      SAFE_ALLOC(w * 3 * 2 + w * 2, max_threads, fixed_y_t);
+  fixed_y_t* const best_y_base = SAFE_ALLOC(w, 2 * buf_pairs, fixed_y_t);
+  fixed_y_t* const target_y_base = SAFE_ALLOC(w, 2 * buf_pairs, fixed_y_t);
+  fixed_t* const best_uv_base = SAFE_ALLOC(uv_w * 3, buf_pairs, fixed_t);
+  fixed_t* const target_uv_base = SAFE_ALLOC(uv_w * 3, buf_pairs, fixed_t);
+  fixed_t* const best_rgb_uv =
+      SAFE_ALLOC(uv_w * 3 + halo_size, max_threads, fixed_t);
+  SharpYuvBand bands[MAX_THREADS];
+  int ok = 1;
   assert(w > 0);
   assert(h > 0);
+  assert(max_threads >= 1 && max_threads <= MAX_THREADS);
 
   if (best_y_base == NULL || best_uv_base == NULL ||
       target_y_base == NULL || target_uv_base == NULL ||
-      best_rgb_y == NULL || best_rgb_uv == NULL ||
-      tmp_buffer == NULL) {
+      best_rgb_uv == NULL || tmp_buffer == NULL) {
     ok = 0;
     goto End;
   }
 
-  // Import RGB samples to W/RGB representation.
-  for (j = 0; j < height; j += 2) {
-    const int is_last_row = (j == height - 1);
-    fixed_y_t* const src1 = tmp_buffer + 0 * w;
-    fixed_y_t* const src2 = tmp_buffer + 3 * w;
-
-    // prepare two rows of input
-    ImportOneRow(r_ptr, g_ptr, b_ptr, rgb_step, rgb_bit_depth, width,
-                 src1);
-    if (!is_last_row) {
-      ImportOneRow(r_ptr + rgb_stride, g_ptr + rgb_stride, b_ptr + rgb_stride,
-                   rgb_step, rgb_bit_depth, width, src2);
-    } else {
-      memcpy(src2, src1, 3 * w * sizeof(*src2));
+  for (c0 = 0; c0 < uv_h; c0 = c1) {
+    uint64_t prev_diff_y_sum = ~0;
+    int num_bands;
+    uint64_t diff_y_threshold;
+    c1 = (c0 + strip_pairs < uv_h) ? c0 + strip_pairs : uv_h;
+    p0 = (c0 - overlap > 0) ? c0 - overlap : 0;
+    p1 = (c1 + overlap < uv_h) ? c1 + overlap : uv_h;
+    num_bands = (p1 - p0 + kMinPairsPerBand - 1) / kMinPairsPerBand;
+    if (num_bands > max_threads) num_bands = max_threads;
+    diff_y_threshold = (uint64_t)(3.0 * w * 2 * (p1 - p0));
+
+    for (b = 0; b < num_bands; ++b) {
+      SharpYuvBand* const band = &bands[b];
+      band->r_ptr = r_ptr;
+      band->g_ptr = g_ptr;
+      band->b_ptr = b_ptr;
+      band->rgb_step = rgb_step;
+      band->rgb_stride = rgb_stride;
+      band->rgb_bit_depth = rgb_bit_depth;
+      band->width = width;
+      band->height = height;
+      band->transfer_type = transfer_type;
+      band->base_j = 2 * p0;
+      band->best_y_base = best_y_base;
+      band->target_y_base = target_y_base;
+      band->best_uv_base = best_uv_base;
+      band->target_uv_base = target_uv_base;
+      band->j_start = 2 * (p0 + (int)((int64_t)(p1 - p0) * b / num_bands));
+      band->j_end = 2 * (p0 + (int)((int64_t)(p1 - p0) * (b + 1) / num_bands));
+      band->tmp_buffer = tmp_buffer + (size_t)b * (w * 3 * 2 + w * 2);
+      band->best_rgb_y = band->tmp_buffer + w * 3 * 2;
+      band->best_rgb_uv = best_rgb_uv + (size_t)b * (uv_w * 3 + halo_size);
+      band->top_uv = (b > 0) ? band->best_rgb_uv + uv_w * 3 : NULL;
+      band->bottom_uv =
+          (b < num_bands - 1) ? band->best_rgb_uv + uv_w * 3 * 2 : NULL;
+      band->diff_y_sum = 0;
     }
-    StoreGray(src1, best_y + 0, w);
-    StoreGray(src2, best_y + w, w);
 
-    UpdateW(src1, target_y, w, rgb_bit_depth, transfer_type);
-    UpdateW(src2, target_y + w, w, rgb_bit_depth, transfer_type);
-    UpdateChroma(src1, src2, target_uv, uv_w, rgb_bit_depth, transfer_type);
-    memcpy(best_uv, target_uv, 3 * uv_w * sizeof(*best_uv));
-    best_y += 2 * w;
-    best_uv += 3 * uv_w;
-    target_y += 2 * w;
-    target_uv += 3 * uv_w;
-    r_ptr += 2 * rgb_stride;
-    g_ptr += 2 * rgb_stride;
-    b_ptr += 2 * rgb_stride;
-  }
-
-  // Iterate and resolve clipping conflicts.
-  for (iter = 0; iter < kNumIterations; ++iter) {
-    const fixed_t* cur_uv = best_uv_base;
-    const fixed_t* prev_uv = best_uv_base;
-    uint64_t diff_y_sum = 0;
-
-    best_y = best_y_base;
-    best_uv = best_uv_base;
-    target_y = target_y_base;
-    target_uv = target_uv_base;
-    j = 0;
-    do {
-      fixed_y_t* const src1 = tmp_buffer + 0 * w;
-      fixed_y_t* const src2 = tmp_buffer + 3 * w;
-      {
-        const fixed_t* const next_uv = cur_uv + ((j < h - 2) ? 3 * uv_w : 0);
-        InterpolateTwoRows(best_y, prev_uv, cur_uv, next_uv, w,
-                           src1, src2, rgb_bit_depth);
-        prev_uv = cur_uv;
-        cur_uv = next_uv;
+    // Import RGB samples to W/RGB representation.
+    ProcessBands(ImportRows, bands, num_bands);
+
+    // Iterate and resolve clipping conflicts.
+    for (iter = 0; iter < kNumIterations; ++iter) {
+      uint64_t diff_y_sum = 0;
+      // The rows bordering the other bands are taken as they were at the end
+      // of the previous iteration.
+      for (b = 0; b < num_bands; ++b) {
+        const SharpYuvBand* const band = &bands[b];
+        if (band->top_uv != NULL) {
+          memcpy(band->top_uv,
+                 best_uv_base + (size_t)((band->j_start >> 1) - p0 - 1) * 3 *
+                                    uv_w,
+                 3 * uv_w * sizeof(*band->top_uv));
+        }
+        if (band->bottom_uv != NULL) {
+          memcpy(band->bottom_uv,
+                 best_uv_base + (size_t)((band->j_end >> 1) - p0) * 3 * uv_w,
+                 3 * uv_w * sizeof(*band->bottom_uv));
+        }
       }
+      ProcessBands(RefineRows, bands, num_bands);
+      for (b = 0; b < num_bands; ++b) diff_y_sum += bands[b].diff_y_sum;
 
-      UpdateW(src1, best_rgb_y + 0 * w, w, rgb_bit_depth, transfer_type);
-      UpdateW(src2, best_rgb_y + 1 * w, w, rgb_bit_depth, transfer_type);
-      UpdateChroma(src1, src2, best_rgb_uv, uv_w, rgb_bit_depth, transfer_type);
-
-      // update two rows of Y and one row of RGB
-      diff_y_sum +=
-          SharpYuvUpdateY(target_y, best_rgb_y, best_y, 2 * w, y_bit_depth);
-      SharpYuvUpdateRGB(target_uv, best_rgb_uv, best_uv, 3 * uv_w);
-
-      best_y += 2 * w;
-      best_uv += 3 * uv_w;
-      target_y += 2 * w;
-      target_uv += 3 * uv_w;
-      j += 2;
-    } while (j < h);
-    // test exit condition
-    if (iter > 0) {
-      if (diff_y_sum < diff_y_threshold) break;
-      if (diff_y_sum > prev_diff_y_sum) break;
+      // test exit condition
+      if (iter > 0) {
+        if (diff_y_sum < diff_y_threshold) break;
+        if (diff_y_sum > prev_diff_y_sum) break;
+      }
+      prev_diff_y_sum = diff_y_sum;
     }
-    prev_diff_y_sum = diff_y_sum;
-  }
 
-  // final reconstruction
-  ok = ConvertWRGBToYUV(best_y_base, best_uv_base, y_ptr, y_stride, u_ptr,
-                        u_stride, v_ptr, v_stride, rgb_bit_depth, yuv_bit_depth,
-                        width, height, yuv_matrix);
+    // final reconstruction of the output rows of the strip
+    ok = ConvertWRGBToYUV(
+        best_y_base + (size_t)(c0 - p0) * 2 * w,
+        best_uv_base + (size_t)(c0 - p0) * 3 * uv_w,
+        y_ptr + (ptrdiff_t)2 * c0 * y_stride, y_stride,
+        u_ptr + (ptrdiff_t)c0 * u_stride, u_stride,
+        v_ptr + (ptrdiff_t)c0 * v_stride, v_stride, rgb_bit_depth,
+        yuv_bit_depth, width, ((2 * c1 < height) ? 2 * c1 : height) - 2 * c0,
+        yuv_matrix);
+    if (!ok) break;
+  }
 
  End:
   free(best_y_base);
   free(best_uv_base);
   free(target_y_base);
   free(target_uv_base);
-  free(best_rgb_y);
   free(best_rgb_uv);
   free(tmp_buffer);
   return ok;
@@ -437,9 +633,7 @@ static int DoSharpArgbToYuv(const uint8_t* r_ptr, const uint8_t* g_ptr,
 
 #undef SAFE_ALLOC
 
-#if defined(WEBP_USE_THREAD) && !defined(_WIN32)
-#include <pthread.h>  // NOLINT
-
+#if defined(SHARPYUV_USE_THREAD)
 #define LOCK_ACCESS \
     static pthread_mutex_t sharpyuv_lock = PTHREAD_MUTEX_INITIALIZER; \
     if (pthread_mutex_lock(&sharpyuv_lock)) return
@@ -448,10 +642,10 @@ static int DoSharpArgbToYuv(const uint8_t* r_ptr, const uint8_t* g_ptr,
       (void)pthread_mutex_unlock(&sharpyuv_lock); \
       return;                                     \
     } while (0)
-#else  // !(defined(WEBP_USE_THREAD) && !defined(_WIN32))
+#else  // !SHARPYUV_USE_THREAD
 #define LOCK_ACCESS do {} while (0)
 #define UNLOCK_ACCESS_AND_RETURN return
-#endif  // defined(WEBP_USE_THREAD) && !defined(_WIN32)
+#endif  // SHARPYUV_USE_THREAD
 
 // Hidden exported init function.
 // By default SharpYuvConvert calls it with SharpYuvGetCPUInfo. If needed,
@@ -487,6 +681,8 @@ int SharpYuvConvert(const void* r_ptr, const void* g_ptr, const void* b_ptr,
   SharpYuvOptions options;
   options.yuv_matrix = yuv_matrix;
   options.transfer_type = kSharpYuvTransferFunctionSrgb;
+  options.num_threads = 1;
+  options.low_memory = 0;
   return SharpYuvConvertWithOptions(
       r_ptr, g_ptr, b_ptr, rgb_step, rgb_stride, rgb_bit_depth, y_ptr, y_stride,
       u_ptr, u_stride, v_ptr, v_stride, yuv_bit_depth, width, height, &options);
@@ -504,6 +700,8 @@ int SharpYuvOptionsInitInternal(const SharpYuvConversionMatrix* yuv_matrix,
   }
   options->yuv_matrix = yuv_matrix;
   options->transfer_type = kSharpYuvTransferFunctionSrgb;
+  options->num_threads = 1;
+  options->low_memory = 0;
   return 1;
 }
 
@@ -569,7 +767,8 @@ int SharpYuvConvertWithOptions(const void* r_ptr, const void* g_ptr,
       (const uint8_t*)r_ptr, (const uint8_t*)g_ptr, (const uint8_t*)b_ptr,
       rgb_step, rgb_stride, rgb_bit_depth, (uint8_t*)y_ptr, y_stride,
       (uint8_t*)u_ptr, u_stride, (uint8_t*)v_ptr, v_stride, yuv_bit_depth,
-      width, height, &scaled_matrix, transfer_type);
+      width, height, &scaled_matrix, transfer_type, options->num_threads,
+      options->low_memory);
 }
 
 //------------------------------------------------------------------------------
@@ -51,8 +51,8 @@ extern "C" {
 
 // SharpYUV API version following the convention from semver.org
 #define SHARPYUV_VERSION_MAJOR 0
-#define SHARPYUV_VERSION_MINOR 4
-#define SHARPYUV_VERSION_PATCH 1
+#define SHARPYUV_VERSION_MINOR 6
+#define SHARPYUV_VERSION_PATCH 0
 // Version as a uint32_t. The major number is the high 8 bits.
 // The minor number is the middle 8 bits. The patch number is the low 16 bits.
 #define SHARPYUV_MAKE_VERSION(MAJOR, MINOR, PATCH) \
@@ -151,6 +151,15 @@ struct SharpYuvOptions {
   // SharpYuvComputeConversionMatrix.
   const SharpYuvConversionMatrix* yuv_matrix;
   SharpYuvTransferFunctionType transfer_type;
+  // Number of threads to use. Values <= 1 mean the calling thread only. With
+  // more threads, the image is refined as independent horizontal bands, which
+  // can change the result slightly compared to the single-threaded one.
+  // Ignored if the library was built without thread support.
+  int num_threads;
+  // If set, the image is refined by overlapping horizontal strips so that the
+  // scratch memory is bounded by the width instead of the whole image. The
+  // result differs slightly from the default mode.
+  int low_memory;
 };
 
 // Internal, version-checked, entry point
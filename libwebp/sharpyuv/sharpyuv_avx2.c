@@ -0,0 +1,212 @@
+// Copyright 2025 Google Inc. All Rights Reserved.
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the COPYING file in the root of the source
+// tree. An additional intellectual property rights grant can be found
+// in the file PATENTS. All contributing project authors may
+// be found in the AUTHORS file in the root of the source tree.
+// -----------------------------------------------------------------------------
+//
+// Speed-critical functions for Sharp YUV, AVX2 version.
+
+#include "sharpyuv/sharpyuv_dsp.h"
+
+#if defined(WEBP_USE_AVX2)
+#include <stdlib.h>
+#include <immintrin.h>
+
+static uint16_t clip_AVX2(int v, int max) {
+  return (v < 0) ? 0 : (v > max) ? max : (uint16_t)v;
+}
+
+static uint64_t SharpYuvUpdateY_AVX2(const uint16_t* ref, const uint16_t* src,
+                                     uint16_t* dst, int len, int bit_depth) {
+  const int max_y = (1 << bit_depth) - 1;
+  uint64_t diff = 0;
+  uint32_t tmp[8];
+  int i;
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i max = _mm256_set1_epi16(max_y);
+  const __m256i one = _mm256_set1_epi16(1);
+  __m256i sum = zero;
+
+  for (i = 0; i + 16 <= len; i += 16) {
+    const __m256i A = _mm256_loadu_si256((const __m256i*)(ref + i));
+    const __m256i B = _mm256_loadu_si256((const __m256i*)(src + i));
+    const __m256i C = _mm256_loadu_si256((const __m256i*)(dst + i));
+    const __m256i D = _mm256_sub_epi16(A, B);       // diff_y
+    const __m256i E = _mm256_cmpgt_epi16(zero, D);  // sign (-1 or 0)
+    const __m256i F = _mm256_add_epi16(C, D);       // new_y
+    const __m256i G = _mm256_or_si256(E, one);      // -1 or 1
+    const __m256i H = _mm256_max_epi16(_mm256_min_epi16(F, max), zero);
+    const __m256i I = _mm256_madd_epi16(D, G);      // sum(abs(...))
+    _mm256_storeu_si256((__m256i*)(dst + i), H);
+    sum = _mm256_add_epi32(sum, I);
+  }
+  _mm256_storeu_si256((__m256i*)tmp, sum);
+  diff = (uint64_t)tmp[7] + tmp[6] + tmp[5] + tmp[4] +
+         tmp[3] + tmp[2] + tmp[1] + tmp[0];
+  for (; i < len; ++i) {
+    const int diff_y = ref[i] - src[i];
+    const int new_y = (int)dst[i] + diff_y;
+    dst[i] = clip_AVX2(new_y, max_y);
+    diff += (uint64_t)abs(diff_y);
+  }
+  return diff;
+}
+
+static void SharpYuvUpdateRGB_AVX2(const int16_t* ref, const int16_t* src,
+                                   int16_t* dst, int len) {
+  int i = 0;
+  for (i = 0; i + 16 <= len; i += 16) {
+    const __m256i A = _mm256_loadu_si256((const __m256i*)(ref + i));
+    const __m256i B = _mm256_loadu_si256((const __m256i*)(src + i));
+    const __m256i C = _mm256_loadu_si256((const __m256i*)(dst + i));
+    const __m256i D = _mm256_sub_epi16(A, B);   // diff_uv
+    const __m256i E = _mm256_add_epi16(C, D);   // new_uv
+    _mm256_storeu_si256((__m256i*)(dst + i), E);
+  }
+  for (; i < len; ++i) {
+    const int diff_uv = ref[i] - src[i];
+    dst[i] += diff_uv;
+  }
+}
+
+static void SharpYuvFilterRow16_AVX2(const int16_t* A, const int16_t* B,
+                                     int len, const uint16_t* best_y,
+                                     uint16_t* out, int bit_depth) {
+  const int max_y = (1 << bit_depth) - 1;
+  int i;
+  const __m256i kCst8 = _mm256_set1_epi16(8);
+  const __m256i max = _mm256_set1_epi16(max_y);
+  const __m256i zero = _mm256_setzero_si256();
+  for (i = 0; i + 16 <= len; i += 16) {
+    const __m256i a0 = _mm256_loadu_si256((const __m256i*)(A + i + 0));
+    const __m256i a1 = _mm256_loadu_si256((const __m256i*)(A + i + 1));
+    const __m256i b0 = _mm256_loadu_si256((const __m256i*)(B + i + 0));
+    const __m256i b1 = _mm256_loadu_si256((const __m256i*)(B + i + 1));
+    const __m256i a0b1 = _mm256_add_epi16(a0, b1);
+    const __m256i a1b0 = _mm256_add_epi16(a1, b0);
+    const __m256i a0a1b0b1 = _mm256_add_epi16(a0b1, a1b0);  // A0+A1+B0+B1
+    const __m256i a0a1b0b1_8 = _mm256_add_epi16(a0a1b0b1, kCst8);
+    const __m256i a0b1_2 = _mm256_add_epi16(a0b1, a0b1);    // 2*(A0+B1)
+    const __m256i a1b0_2 = _mm256_add_epi16(a1b0, a1b0);    // 2*(A1+B0)
+    const __m256i c0 =
+        _mm256_srai_epi16(_mm256_add_epi16(a0b1_2, a0a1b0b1_8), 3);
+    const __m256i c1 =
+        _mm256_srai_epi16(_mm256_add_epi16(a1b0_2, a0a1b0b1_8), 3);
+    const __m256i d0 = _mm256_add_epi16(c1, a0);
+    const __m256i d1 = _mm256_add_epi16(c0, a1);
+    const __m256i e0 = _mm256_srai_epi16(d0, 1);
+    const __m256i e1 = _mm256_srai_epi16(d1, 1);
+    // The unpacks work within each 128-bit lane: f0 holds pixels 0..3 and
+    // 8..11, f1 holds pixels 4..7 and 12..15. Restore the linear order.
+    const __m256i f0 = _mm256_unpacklo_epi16(e0, e1);
+    const __m256i f1 = _mm256_unpackhi_epi16(e0, e1);
+    const __m256i f2 = _mm256_permute2x128_si256(f0, f1, 0x20);
+    const __m256i f3 = _mm256_permute2x128_si256(f0, f1, 0x31);
+    const __m256i g0 =
+        _mm256_loadu_si256((const __m256i*)(best_y + 2 * i + 0));
+    const __m256i g1 =
+        _mm256_loadu_si256((const __m256i*)(best_y + 2 * i + 16));
+    const __m256i h0 = _mm256_add_epi16(g0, f2);
+    const __m256i h1 = _mm256_add_epi16(g1, f3);
+    const __m256i i0 = _mm256_max_epi16(_mm256_min_epi16(h0, max), zero);
+    const __m256i i1 = _mm256_max_epi16(_mm256_min_epi16(h1, max), zero);
+    _mm256_storeu_si256((__m256i*)(out + 2 * i + 0), i0);
+    _mm256_storeu_si256((__m256i*)(out + 2 * i + 16), i1);
+  }
+  for (; i < len; ++i) {
+    //   (9 * A0 + 3 * A1 + 3 * B0 + B1 + 8) >> 4 =
+    // = (8 * A0 + 2 * (A1 + B0) + (A0 + A1 + B0 + B1 + 8)) >> 4
+    // We reuse the common sub-expressions.
+    const int a0b1 = A[i + 0] + B[i + 1];
+    const int a1b0 = A[i + 1] + B[i + 0];
+    const int a0a1b0b1 = a0b1 + a1b0 + 8;
+    const int v0 = (8 * A[i + 0] + 2 * a1b0 + a0a1b0b1) >> 4;
+    const int v1 = (8 * A[i + 1] + 2 * a0b1 + a0a1b0b1) >> 4;
+    out[2 * i + 0] = clip_AVX2(best_y[2 * i + 0] + v0, max_y);
+    out[2 * i + 1] = clip_AVX2(best_y[2 * i + 1] + v1, max_y);
+  }
+}
+
+static WEBP_INLINE __m256i Load8s16To32(const int16_t* src) {
+  return _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i*)src));
+}
+
+static void SharpYuvFilterRow32_AVX2(const int16_t* A, const int16_t* B,
+                                     int len, const uint16_t* best_y,
+                                     uint16_t* out, int bit_depth) {
+  const int max_y = (1 << bit_depth) - 1;
+  int i;
+  const __m256i kCst8 = _mm256_set1_epi32(8);
+  const __m256i max = _mm256_set1_epi16(max_y);
+  const __m256i zero = _mm256_setzero_si256();
+  for (i = 0; i + 8 <= len; i += 8) {
+    const __m256i a0 = Load8s16To32(A + i + 0);
+    const __m256i a1 = Load8s16To32(A + i + 1);
+    const __m256i b0 = Load8s16To32(B + i + 0);
+    const __m256i b1 = Load8s16To32(B + i + 1);
+    const __m256i a0b1 = _mm256_add_epi32(a0, b1);
+    const __m256i a1b0 = _mm256_add_epi32(a1, b0);
+    const __m256i a0a1b0b1 = _mm256_add_epi32(a0b1, a1b0);  // A0+A1+B0+B1
+    const __m256i a0a1b0b1_8 = _mm256_add_epi32(a0a1b0b1, kCst8);
+    const __m256i a0b1_2 = _mm256_add_epi32(a0b1, a0b1);  // 2*(A0+B1)
+    const __m256i a1b0_2 = _mm256_add_epi32(a1b0, a1b0);  // 2*(A1+B0)
+    const __m256i c0 =
+        _mm256_srai_epi32(_mm256_add_epi32(a0b1_2, a0a1b0b1_8), 3);
+    const __m256i c1 =
+        _mm256_srai_epi32(_mm256_add_epi32(a1b0_2, a0a1b0b1_8), 3);
+    const __m256i d0 = _mm256_add_epi32(c1, a0);
+    const __m256i d1 = _mm256_add_epi32(c0, a1);
+    const __m256i e0 = _mm256_srai_epi32(d0, 1);
+    const __m256i e1 = _mm256_srai_epi32(d1, 1);
+    // Per-lane unpack followed by a per-lane pack leaves pixels 0..3 in the
+    // low lane and 4..7 in the high lane, i.e. already in linear order.
+    const __m256i f0 = _mm256_unpacklo_epi32(e0, e1);
+    const __m256i f1 = _mm256_unpackhi_epi32(e0, e1);
+    const __m256i g = _mm256_loadu_si256((const __m256i*)(best_y + 2 * i));
+    const __m256i h_16 = _mm256_add_epi16(g, _mm256_packs_epi32(f0, f1));
+    const __m256i final = _mm256_max_epi16(_mm256_min_epi16(h_16, max), zero);
+    _mm256_storeu_si256((__m256i*)(out + 2 * i + 0), final);
+  }
+  for (; i < len; ++i) {
+    //   (9 * A0 + 3 * A1 + 3 * B0 + B1 + 8) >> 4 =
+    // = (8 * A0 + 2 * (A1 + B0) + (A0 + A1 + B0 + B1 + 8)) >> 4
+    // We reuse the common sub-expressions.
+    const int a0b1 = A[i + 0] + B[i + 1];
+    const int a1b0 = A[i + 1] + B[i + 0];
+    const int a0a1b0b1 = a0b1 + a1b0 + 8;
+    const int v0 = (8 * A[i + 0] + 2 * a1b0 + a0a1b0b1) >> 4;
+    const int v1 = (8 * A[i + 1] + 2 * a0b1 + a0a1b0b1) >> 4;
+    out[2 * i + 0] = clip_AVX2(best_y[2 * i + 0] + v0, max_y);
+    out[2 * i + 1] = clip_AVX2(best_y[2 * i + 1] + v1, max_y);
+  }
+}
+
+static void SharpYuvFilterRow_AVX2(const int16_t* A, const int16_t* B, int len,
+                                   const uint16_t* best_y, uint16_t* out,
+                                   int bit_depth) {
+  if (bit_depth <= 10) {
+    SharpYuvFilterRow16_AVX2(A, B, len, best_y, out, bit_depth);
+  } else {
+    SharpYuvFilterRow32_AVX2(A, B, len, best_y, out, bit_depth);
+  }
+}
+
+//------------------------------------------------------------------------------
+
+extern void InitSharpYuvAVX2(void);
+
+WEBP_TSAN_IGNORE_FUNCTION void InitSharpYuvAVX2(void) {
+  SharpYuvUpdateY = SharpYuvUpdateY_AVX2;
+  SharpYuvUpdateRGB = SharpYuvUpdateRGB_AVX2;
+  SharpYuvFilterRow = SharpYuvFilterRow_AVX2;
+}
+#else  // !WEBP_USE_AVX2
+
+extern void InitSharpYuvAVX2(void);
+
+void InitSharpYuvAVX2(void) {}
+
+#endif  // WEBP_USE_AVX2
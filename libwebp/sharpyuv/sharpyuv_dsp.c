@@ -74,6 +74,7 @@ void (*SharpYuvFilterRow)(const int16_t* A, const int16_t* B, int len,
 
 extern VP8CPUInfo SharpYuvGetCPUInfo;
 extern void InitSharpYuvSSE2(void);
+extern void InitSharpYuvAVX2(void);
 extern void InitSharpYuvNEON(void);
 
 void SharpYuvInitDsp(void) {
@@ -89,6 +90,11 @@ void SharpYuvInitDsp(void) {
       InitSharpYuvSSE2();
     }
 #endif  // WEBP_HAVE_SSE2
+#if defined(WEBP_HAVE_AVX2)
+    if (SharpYuvGetCPUInfo(kAVX2)) {
+      InitSharpYuvAVX2();
+    }
+#endif  // WEBP_HAVE_AVX2
   }
 
 #if defined(WEBP_HAVE_NEON)
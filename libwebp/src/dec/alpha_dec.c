@@ -18,6 +18,7 @@
 #include "src/dec/vp8li_dec.h"
 #include "src/dsp/dsp.h"
 #include "src/utils/quant_levels_dec_utils.h"
+#include "src/utils/thread_utils.h"
 #include "src/utils/utils.h"
 #include "src/webp/format_constants.h"
 #include "src/webp/types.h"
@@ -148,25 +149,173 @@ WEBP_NODISCARD static int AllocateAlphaPlane(VP8Decoder* const dec,
   const int stride = io->width;
   const int height = io->crop_bottom;
   const uint64_t alpha_size = (uint64_t)stride * height;
-  assert(dec->alpha_plane_mem_ == NULL);
-  dec->alpha_plane_mem_ =
-      (uint8_t*)WebPSafeMalloc(alpha_size, sizeof(*dec->alpha_plane_));
-  if (dec->alpha_plane_mem_ == NULL) {
-    return VP8SetError(dec, VP8_STATUS_OUT_OF_MEMORY,
-                       "Alpha decoder initialization failed.");
+  if (dec->stats_ != NULL) dec->stats_->peak_memory += (size_t)alpha_size;
+  if (alpha_size > dec->alpha_plane_mem_size_) {
+    WebPSafeFree(dec->alpha_plane_mem_);
+    dec->alpha_plane_mem_size_ = 0;
+    dec->alpha_plane_mem_ =
+        (uint8_t*)WebPSafeMalloc(alpha_size, sizeof(*dec->alpha_plane_));
+    if (dec->alpha_plane_mem_ == NULL) {
+      return VP8SetError(dec, VP8_STATUS_OUT_OF_MEMORY,
+                         "Alpha decoder initialization failed.");
+    }
+    dec->alpha_plane_mem_size_ = (size_t)alpha_size;
   }
   dec->alpha_plane_ = dec->alpha_plane_mem_;
   dec->alpha_prev_line_ = NULL;
   return 1;
 }
 
-void WebPDeallocateAlphaMemory(VP8Decoder* const dec) {
+void WebPRecycleAlphaMemory(VP8Decoder* const dec) {
   assert(dec != NULL);
-  WebPSafeFree(dec->alpha_plane_mem_);
-  dec->alpha_plane_mem_ = NULL;
+  // The worker must be done with the decoder before it's deleted.
+  (void)WebPGetWorkerInterface()->Sync(&dec->alpha_worker_);
   dec->alpha_plane_ = NULL;
   ALPHDelete(dec->alph_dec_);
   dec->alph_dec_ = NULL;
+  WebPDequantizeLevelsDelete(dec->alpha_smoother_);
+  dec->alpha_smoother_ = NULL;
+}
+
+void WebPDeallocateAlphaMemory(VP8Decoder* const dec) {
+  assert(dec != NULL);
+  WebPGetWorkerInterface()->End(&dec->alpha_worker_);
+  WebPRecycleAlphaMemory(dec);
+  WebPSafeFree(dec->alpha_plane_mem_);
+  dec->alpha_plane_mem_ = NULL;
+  dec->alpha_plane_mem_size_ = 0;
+}
+
+WEBP_NODISCARD static int AlphaInitDecoder(VP8Decoder* const dec,
+                                           const VP8Io* const io) {
+  assert(dec->alph_dec_ == NULL);
+  dec->alph_dec_ = ALPHNew();
+  if (dec->alph_dec_ == NULL) {
+    return VP8SetError(dec, VP8_STATUS_OUT_OF_MEMORY,
+                       "Alpha decoder initialization failed.");
+  }
+  if (!AllocateAlphaPlane(dec, io)) return 0;
+  if (!ALPHInit(dec->alph_dec_, dec->alpha_data_, dec->alpha_data_size_,
+                io, dec->alpha_plane_)) {
+    VP8LDecoder* const vp8l_dec = dec->alph_dec_->vp8l_dec_;
+    return VP8SetError(dec,
+                       (vp8l_dec == NULL) ? VP8_STATUS_OUT_OF_MEMORY
+                                          : vp8l_dec->status_,
+                       "Alpha decoder initialization failed.");
+  }
+  // if we allowed use of alpha dithering, check whether it's needed at all
+  if (dec->alph_dec_->pre_processing_ != ALPHA_PREPROCESSED_LEVELS) {
+    dec->alpha_dithering_ = 0;   // disable dithering
+  }
+  return 1;
+}
+
+// Makes sure all alpha rows before 'last_row' are ready for output: decodes
+// them from row 'row' on and applies the dithering.
+WEBP_NODISCARD static int AlphaDecodeRows(VP8Decoder* const dec,
+                                          const VP8Io* const io,
+                                          int row, int last_row) {
+  const int width = io->width;
+  const int height = io->crop_bottom;
+  WebPStopwatch watch;
+
+  if (dec->stats_ != NULL) WebPStopwatchReset(&watch);
+  if (!dec->is_alpha_decoded_) {
+    int num_rows = last_row - row;
+    assert(dec->alph_dec_ != NULL);
+    if (dec->alph_dec_->pre_processing_ == ALPHA_PREPROCESSED_LEVELS) {
+      num_rows = height - row;     // decode everything in one pass
+    }
+    assert(row + num_rows <= height);
+    if (num_rows > 0 && !ALPHDecode(dec, row, num_rows)) return 0;
+
+    if (dec->is_alpha_decoded_) {   // finished?
+      ALPHDelete(dec->alph_dec_);
+      dec->alph_dec_ = NULL;
+      if (dec->alpha_dithering_ > 0) {
+        // The levels are analyzed over the whole plane, but the smoothing
+        // is only done on the rows being output.
+        uint8_t* const alpha = dec->alpha_plane_ + io->crop_top * width
+                             + io->crop_left;
+        dec->alpha_smoother_ =
+            WebPDequantizeLevelsNew(alpha,
+                                    io->crop_right - io->crop_left,
+                                    io->crop_bottom - io->crop_top,
+                                    width, dec->alpha_dithering_);
+        if (dec->alpha_smoother_ == NULL) return 0;
+      }
+    }
+  }
+
+  if (dec->alpha_smoother_ != NULL) {
+    WebPDequantizeLevelsRows(dec->alpha_smoother_, last_row - io->crop_top);
+    if (last_row >= height) {
+      WebPDequantizeLevelsDelete(dec->alpha_smoother_);
+      dec->alpha_smoother_ = NULL;
+    }
+  }
+  if (dec->stats_ != NULL) {
+    WebPDecStatsAddTime(dec->stats_, WEBP_DEC_STAGE_ALPHA, &watch);
+  }
+  return 1;
+}
+
+//------------------------------------------------------------------------------
+// Concurrent decoding.
+//
+// The alpha worker prepares the rows needed by the next VP8DecompressAlphaRows()
+// call while the color samples of the corresponding macroblock row are being
+// decoded. The output only blocks (in Sync()) when the worker is lagging.
+
+#define ALPHA_ROWS_AHEAD 16   // one macroblock row
+
+static int AlphaWorkerHook(void* arg1, void* arg2) {
+  VP8Decoder* const dec = (VP8Decoder*)arg1;
+  const VP8Io* const io = (const VP8Io*)arg2;
+  if (!AlphaDecodeRows(dec, io, dec->alpha_last_row_, dec->alpha_end_row_)) {
+    return 0;
+  }
+  dec->alpha_last_row_ = dec->alpha_end_row_;
+  return 1;
+}
+
+// Returns true if some rows still need decoding or dithering.
+static int AlphaHasPendingRows(const VP8Decoder* const dec) {
+  return !dec->is_alpha_decoded_ || dec->alpha_smoother_ != NULL;
+}
+
+static void AlphaLaunchRows(VP8Decoder* const dec, int last_row) {
+  const int height = ((const VP8Io*)dec->alpha_worker_.data2)->crop_bottom;
+  assert(AlphaHasPendingRows(dec));
+  dec->alpha_end_row_ = (last_row < height) ? last_row : height;
+  WebPGetWorkerInterface()->Launch(&dec->alpha_worker_);
+}
+
+int VP8StartAlphaDecoding(VP8Decoder* const dec, const VP8Io* const io) {
+  WebPWorker* const worker = &dec->alpha_worker_;
+  assert(dec != NULL && io != NULL);
+  if (!dec->alpha_async_ || dec->alpha_data_ == NULL) return 1;
+
+  if (!AlphaInitDecoder(dec, io)) {
+    WebPDeallocateAlphaMemory(dec);
+    return 0;
+  }
+  // Uncompressed alpha is cheap to unfilter: decode it in
+  // VP8DecompressAlphaRows().
+  if (dec->alph_dec_->method_ != ALPHA_LOSSLESS_COMPRESSION) {
+    dec->alpha_async_ = 0;
+    return 1;
+  }
+  if (!WebPGetWorkerInterface()->Reset(worker)) {
+    return VP8SetError(dec, VP8_STATUS_OUT_OF_MEMORY,
+                       "thread initialization failed.");
+  }
+  worker->hook = AlphaWorkerHook;
+  worker->data1 = dec;
+  worker->data2 = (void*)io;
+  dec->alpha_last_row_ = 0;
+  AlphaLaunchRows(dec, ALPHA_ROWS_AHEAD);
+  return 1;
 }
 
 //------------------------------------------------------------------------------
@@ -184,50 +333,27 @@ WEBP_NODISCARD const uint8_t* VP8DecompressAlphaRows(VP8Decoder* const dec,
     return NULL;
   }
 
-  if (!dec->is_alpha_decoded_) {
-    if (dec->alph_dec_ == NULL) {    // Initialize decoder.
-      dec->alph_dec_ = ALPHNew();
-      if (dec->alph_dec_ == NULL) {
-        VP8SetError(dec, VP8_STATUS_OUT_OF_MEMORY,
-                    "Alpha decoder initialization failed.");
-        return NULL;
-      }
-      if (!AllocateAlphaPlane(dec, io)) goto Error;
-      if (!ALPHInit(dec->alph_dec_, dec->alpha_data_, dec->alpha_data_size_,
-                    io, dec->alpha_plane_)) {
-        VP8LDecoder* const vp8l_dec = dec->alph_dec_->vp8l_dec_;
-        VP8SetError(dec,
-                    (vp8l_dec == NULL) ? VP8_STATUS_OUT_OF_MEMORY
-                                       : vp8l_dec->status_,
-                    "Alpha decoder initialization failed.");
+  if (dec->alpha_async_) {
+    const int last_row = row + num_rows;
+    // Wait for the rows prepared ahead, and catch up if needed.
+    if (!WebPGetWorkerInterface()->Sync(&dec->alpha_worker_)) goto Error;
+    if (dec->alpha_last_row_ < last_row) {
+      if (!AlphaDecodeRows(dec, io, dec->alpha_last_row_, last_row)) {
         goto Error;
       }
-      // if we allowed use of alpha dithering, check whether it's needed at all
-      if (dec->alph_dec_->pre_processing_ != ALPHA_PREPROCESSED_LEVELS) {
-        dec->alpha_dithering_ = 0;   // disable dithering
-      } else {
-        num_rows = height - row;     // decode everything in one pass
-      }
+      dec->alpha_last_row_ = last_row;
     }
-
-    assert(dec->alph_dec_ != NULL);
-    assert(row + num_rows <= height);
-    if (!ALPHDecode(dec, row, num_rows)) goto Error;
-
-    if (dec->is_alpha_decoded_) {   // finished?
-      ALPHDelete(dec->alph_dec_);
-      dec->alph_dec_ = NULL;
-      if (dec->alpha_dithering_ > 0) {
-        uint8_t* const alpha = dec->alpha_plane_ + io->crop_top * width
-                             + io->crop_left;
-        if (!WebPDequantizeLevels(alpha,
-                                  io->crop_right - io->crop_left,
-                                  io->crop_bottom - io->crop_top,
-                                  width, dec->alpha_dithering_)) {
-          goto Error;
-        }
-      }
+    if (AlphaHasPendingRows(dec)) {
+      // Prepare the next rows while these ones are being output. The decoder
+      // state belongs to the worker until the next Sync().
+      AlphaLaunchRows(dec, last_row + ALPHA_ROWS_AHEAD);
     }
+  } else if (AlphaHasPendingRows(dec)) {
+    if (dec->alph_dec_ == NULL && !dec->is_alpha_decoded_) {
+      // Initialize decoder.
+      if (!AlphaInitDecoder(dec, io)) goto Error;
+    }
+    if (!AlphaDecodeRows(dec, io, row, row + num_rows)) goto Error;
   }
 
   // Return a pointer to the current decoded row.
@@ -237,3 +363,5 @@ WEBP_NODISCARD const uint8_t* VP8DecompressAlphaRows(VP8Decoder* const dec,
   WebPDeallocateAlphaMemory(dec);
   return NULL;
 }
+
+#undef ALPHA_ROWS_AHEAD
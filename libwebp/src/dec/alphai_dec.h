@@ -45,6 +45,10 @@ struct ALPHDecoder {
 // Deallocate memory associated to dec->alpha_plane_ decoding
 void WebPDeallocateAlphaMemory(VP8Decoder* const dec);
 
+// Same, but keeps dec->alpha_plane_mem_ and the worker thread for the next
+// picture.
+void WebPRecycleAlphaMemory(VP8Decoder* const dec);
+
 //------------------------------------------------------------------------------
 
 #ifdef __cplusplus
@@ -24,7 +24,8 @@
 static const uint8_t kModeBpp[MODE_LAST] = {
   3, 4, 3, 4, 4, 2, 2,
   4, 4, 4, 2,    // pre-multiplied modes
-  1, 1 };
+  1, 1,          // planar yuv modes
+  1, 1 };        // semi-planar yuv modes
 
 // Check that webp_csp_mode is within the bounds of WEBP_CSP_MODE.
 // Convert to an integer to handle both the unsigned/signed enum cases
@@ -45,6 +46,30 @@ static VP8StatusCode CheckDecBuffer(const WebPDecBuffer* const buffer) {
   const int height = buffer->height;
   if (!IsValidColorspace(mode)) {
     ok = 0;
+  } else if (WebPIsSemiPlanarMode(mode)) {   // NV12 / NV21 checks
+    const WebPYUVABuffer* const buf = &buffer->u.YUVA;
+    const int uv_width  = (width  + 1) / 2;
+    const int uv_height = (height + 1) / 2;
+    const int y_stride = abs(buf->y_stride);
+    const int uv_stride = abs(buf->u_stride);
+    const uint64_t y_size = MIN_BUFFER_SIZE(width, height, y_stride);
+    // The last sample of a row sits one byte before the end of the row for
+    // the chroma component that is stored first.
+    const uint64_t uv_size =
+        MIN_BUFFER_SIZE(2 * uv_width - 1, uv_height, uv_stride);
+    ok &= (y_size <= buf->y_size);
+    ok &= (uv_size <= buf->u_size);
+    ok &= (uv_size <= buf->v_size);
+    ok &= (y_stride >= width);
+    ok &= (uv_stride >= 2 * uv_width);
+    ok &= (buf->u_stride == buf->v_stride);
+    ok &= (buf->y != NULL);
+    ok &= (buf->u != NULL);
+    ok &= (buf->v != NULL);
+    if (ok) {
+      ok &= (mode == MODE_NV12) ? (buf->v == buf->u + 1)
+                                : (buf->u == buf->v + 1);
+    }
   } else if (!WebPIsRGBMode(mode)) {   // YUV checks
     const WebPYUVABuffer* const buf = &buffer->u.YUVA;
     const int uv_width  = (width  + 1) / 2;
@@ -107,15 +132,22 @@ static VP8StatusCode AllocateBuffer(WebPDecBuffer* const buffer) {
     }
     stride = w * kModeBpp[mode];
     size = (uint64_t)stride * h;
-    if (!WebPIsRGBMode(mode)) {
-      uv_stride = (w + 1) / 2;
+    if (WebPIsSemiPlanarMode(mode)) {
+      // single interleaved chroma plane
+      uv_stride = 2 * ((w + 1) / 2);
       uv_size = (uint64_t)uv_stride * ((h + 1) / 2);
-      if (mode == MODE_YUVA) {
-        a_stride = w;
-        a_size = (uint64_t)a_stride * h;
+      total_size = size + uv_size;
+    } else {
+      if (!WebPIsRGBMode(mode)) {
+        uv_stride = (w + 1) / 2;
+        uv_size = (uint64_t)uv_stride * ((h + 1) / 2);
+        if (mode == MODE_YUVA) {
+          a_stride = w;
+          a_size = (uint64_t)a_stride * h;
+        }
       }
+      total_size = size + 2 * uv_size + a_size;
     }
-    total_size = size + 2 * uv_size + a_size;
 
     output = (uint8_t*)WebPSafeMalloc(total_size, sizeof(*output));
     if (output == NULL) {
@@ -123,7 +155,22 @@ static VP8StatusCode AllocateBuffer(WebPDecBuffer* const buffer) {
     }
     buffer->private_memory = output;
 
-    if (!WebPIsRGBMode(mode)) {   // YUVA initialization
+    if (WebPIsSemiPlanarMode(mode)) {   // NV12 / NV21 initialization
+      WebPYUVABuffer* const buf = &buffer->u.YUVA;
+      const int u_first = (mode == MODE_NV12);
+      buf->y = output;
+      buf->y_stride = stride;
+      buf->y_size = (size_t)size;
+      buf->u = output + size + (u_first ? 0 : 1);
+      buf->u_stride = uv_stride;
+      buf->u_size = (size_t)uv_size - (u_first ? 0 : 1);
+      buf->v = output + size + (u_first ? 1 : 0);
+      buf->v_stride = uv_stride;
+      buf->v_size = (size_t)uv_size - (u_first ? 1 : 0);
+      buf->a = NULL;
+      buf->a_stride = 0;
+      buf->a_size = 0;
+    } else if (!WebPIsRGBMode(mode)) {   // YUVA initialization
       WebPYUVABuffer* const buf = &buffer->u.YUVA;
       buf->y = output;
       buf->y_stride = stride;
@@ -287,10 +334,17 @@ VP8StatusCode WebPCopyDecBufferPixels(const WebPDecBuffer* const src_buf,
     const WebPYUVABuffer* const dst = &dst_buf->u.YUVA;
     WebPCopyPlane(src->y, src->y_stride, dst->y, dst->y_stride,
                   src_buf->width, src_buf->height);
-    WebPCopyPlane(src->u, src->u_stride, dst->u, dst->u_stride,
-                  (src_buf->width + 1) / 2, (src_buf->height + 1) / 2);
-    WebPCopyPlane(src->v, src->v_stride, dst->v, dst->v_stride,
-                  (src_buf->width + 1) / 2, (src_buf->height + 1) / 2);
+    if (WebPIsSemiPlanarMode(src_buf->colorspace)) {
+      const int u_first = (src_buf->colorspace == MODE_NV12);
+      WebPCopyPlane(u_first ? src->u : src->v, src->u_stride,
+                    u_first ? dst->u : dst->v, dst->u_stride,
+                    2 * ((src_buf->width + 1) / 2), (src_buf->height + 1) / 2);
+    } else {
+      WebPCopyPlane(src->u, src->u_stride, dst->u, dst->u_stride,
+                    (src_buf->width + 1) / 2, (src_buf->height + 1) / 2);
+      WebPCopyPlane(src->v, src->v_stride, dst->v, dst->v_stride,
+                    (src_buf->width + 1) / 2, (src_buf->height + 1) / 2);
+    }
     if (WebPIsAlphaMode(src_buf->colorspace)) {
       WebPCopyPlane(src->a, src->a_stride, dst->a, dst->a_stride,
                     src_buf->width, src_buf->height);
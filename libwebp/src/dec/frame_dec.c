@@ -416,9 +416,15 @@ static int FinishRow(void* arg1, void* arg2) {
   const int mb_y = ctx->mb_y_;
   const int is_first_row = (mb_y == 0);
   const int is_last_row = (mb_y >= dec->br_mb_y_ - 1);
+  WebPDecStats* const stats = dec->stats_;
+  WebPStopwatch watch;
 
+  if (stats != NULL) WebPStopwatchReset(&watch);
   if (dec->mt_method_ == 2) {
     ReconstructRow(dec, ctx);
+    if (stats != NULL) {
+      WebPDecStatsAddTime(stats, WEBP_DEC_STAGE_RECONSTRUCTION, &watch);
+    }
   }
 
   if (ctx->filter_row_) {
@@ -428,6 +434,7 @@ static int FinishRow(void* arg1, void* arg2) {
   if (dec->dither_) {
     DitherRow(dec);
   }
+  if (stats != NULL) WebPDecStatsAddTime(stats, WEBP_DEC_STAGE_FILTER, &watch);
 
   if (io->put != NULL) {
     int y_start = MACROBLOCK_VPOS(mb_y);
@@ -498,6 +505,19 @@ static int FinishRow(void* arg1, void* arg2) {
 
 //------------------------------------------------------------------------------
 
+// ReconstructRow(), with its timing recorded in the statistics if needed.
+static void ReconstructRowTimed(const VP8Decoder* const dec,
+                                const VP8ThreadContext* ctx) {
+  if (dec->stats_ != NULL) {
+    WebPStopwatch watch;
+    WebPStopwatchReset(&watch);
+    ReconstructRow(dec, ctx);
+    WebPDecStatsAddTime(dec->stats_, WEBP_DEC_STAGE_RECONSTRUCTION, &watch);
+  } else {
+    ReconstructRow(dec, ctx);
+  }
+}
+
 int VP8ProcessRow(VP8Decoder* const dec, VP8Io* const io) {
   int ok = 1;
   VP8ThreadContext* const ctx = &dec->thread_ctx_;
@@ -508,7 +528,7 @@ int VP8ProcessRow(VP8Decoder* const dec, VP8Io* const io) {
     // ctx->id_ and ctx->f_info_ are already set
     ctx->mb_y_ = dec->mb_y_;
     ctx->filter_row_ = filter_row;
-    ReconstructRow(dec, ctx);
+    ReconstructRowTimed(dec, ctx);
     ok = FinishRow(dec, io);
   } else {
     WebPWorker* const worker = &dec->worker_;
@@ -526,7 +546,7 @@ int VP8ProcessRow(VP8Decoder* const dec, VP8Io* const io) {
         dec->mb_data_ = tmp;
       } else {
         // perform reconstruction directly in main thread
-        ReconstructRow(dec, ctx);
+        ReconstructRowTimed(dec, ctx);
       }
       if (filter_row) {            // swap filter info
         VP8FInfo* const tmp = ctx->f_info_;
@@ -607,6 +627,12 @@ int VP8ExitCritical(VP8Decoder* const dec, VP8Io* const io) {
   if (io->teardown != NULL) {
     io->teardown(io);
   }
+  if (dec->stats_ != NULL) {
+    WebPDecStats* const stats = dec->stats_;
+    stats->num_macroblocks = dec->mb_w_ * dec->br_mb_y_;
+    stats->num_partitions = dec->num_parts_minus_one_ + 1;
+    stats->use_threads = (dec->mt_method_ > 0) || dec->alpha_async_;
+  }
   return ok;
 }
 
@@ -706,6 +732,7 @@ static int AllocateMemory(VP8Decoder* const dec) {
   uint8_t* mem;
 
   if (!CheckSizeOverflow(needed)) return 0;  // check for overflow
+  if (dec->stats_ != NULL) dec->stats_->peak_memory += (size_t)needed;
   if (needed > dec->mem_size_) {
     WebPSafeFree(dec->mem_);
     dec->mem_size_ = 0;
@@ -797,6 +824,7 @@ int VP8InitFrame(VP8Decoder* const dec, VP8Io* const io) {
   if (!AllocateMemory(dec)) return 0;
   InitIo(dec, io);
   VP8DspInit();  // Init critical function pointers and look-up tables.
+  if (!VP8StartAlphaDecoding(dec, io)) return 0;
   return 1;
 }
 
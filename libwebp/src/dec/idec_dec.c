@@ -52,6 +52,12 @@ typedef enum {
   MEM_MODE_MAP
 } MemBufferMode;
 
+// Release information of the input segments.
+typedef struct {
+  WebPIReleaseFunc release_;
+  void* user_data_;
+} SegmentOwner;
+
 // storage for partition #0 and partial data (in a rolling fashion)
 typedef struct {
   MemBufferMode mode_;  // Operation mode
@@ -62,6 +68,15 @@ typedef struct {
 
   size_t part0_size_;         // size of partition #0
   const uint8_t* part0_buf_;  // buffer to store partition #0
+
+  // In append mode, once the compressed pixel data is reached, incoming data
+  // is no longer gathered in buf_ but read in place, as a list of segments
+  // following buf_[start_, end_).
+  int use_segments_;          // true if segs_ is attached to the bit-reader
+  VP8InputSegments segs_;     // segments not yet fully read
+  SegmentOwner* owners_;      // release information for segs_.segments_[]
+  int segs_size_;             // allocated size of segs_.segments_ / owners_
+  size_t segs_total_;         // total number of bytes appended to segs_
 } MemBuffer;
 
 struct WebPIDecoder {
@@ -231,16 +246,110 @@ static void InitMemBuffer(MemBuffer* const mem) {
   mem->buf_size_   = 0;
   mem->part0_buf_  = NULL;
   mem->part0_size_ = 0;
+  mem->use_segments_ = 0;
+  mem->segs_.segments_ = NULL;
+  mem->segs_.first_ = 0;
+  mem->segs_.num_ = 0;
+  mem->owners_ = NULL;
+  mem->segs_size_ = 0;
+  mem->segs_total_ = 0;
+}
+
+// Releases the first 'num' segments of the list.
+static void ReleaseSegments(MemBuffer* const mem, int num) {
+  VP8InputSegments* const segs = &mem->segs_;
+  int i;
+  assert(num <= segs->num_);
+  if (num <= 0) return;
+  for (i = 0; i < num; ++i) {
+    const SegmentOwner* const owner = &mem->owners_[i];
+    if (owner->release_ != NULL) {
+      owner->release_(segs->segments_[i].buf_, segs->segments_[i].size_,
+                      owner->user_data_);
+    }
+  }
+  segs->num_ -= num;
+  segs->first_ += num;
+  memmove(segs->segments_, segs->segments_ + num,
+          segs->num_ * sizeof(*segs->segments_));
+  memmove(mem->owners_, mem->owners_ + num, segs->num_ * sizeof(*mem->owners_));
 }
 
 static void ClearMemBuffer(MemBuffer* const mem) {
   assert(mem);
   if (mem->mode_ == MEM_MODE_APPEND) {
+    ReleaseSegments(mem, mem->segs_.num_);
+    WebPSafeFree(mem->segs_.segments_);
+    WebPSafeFree(mem->owners_);
     WebPSafeFree(mem->buf_);
     WebPSafeFree((void*)mem->part0_buf_);
   }
 }
 
+// Appends a segment to the list. Returns false in case of memory error.
+WEBP_NODISCARD static int AddSegment(MemBuffer* const mem,
+                                     const uint8_t* const data,
+                                     size_t data_size,
+                                     WebPIReleaseFunc release,
+                                     void* user_data) {
+  VP8InputSegments* const segs = &mem->segs_;
+  assert(mem->use_segments_);
+  assert(data_size > 0);
+  if (segs->num_ == mem->segs_size_) {
+    const int new_size = (mem->segs_size_ == 0) ? 8 : 2 * mem->segs_size_;
+    VP8InputSegment* const new_segments = (VP8InputSegment*)WebPSafeMalloc(
+        new_size, sizeof(*new_segments));
+    SegmentOwner* const new_owners =
+        (SegmentOwner*)WebPSafeMalloc(new_size, sizeof(*new_owners));
+    if (new_segments == NULL || new_owners == NULL) {
+      WebPSafeFree(new_segments);
+      WebPSafeFree(new_owners);
+      return 0;
+    }
+    if (segs->num_ > 0) {
+      memcpy(new_segments, segs->segments_,
+             segs->num_ * sizeof(*new_segments));
+      memcpy(new_owners, mem->owners_, segs->num_ * sizeof(*new_owners));
+    }
+    WebPSafeFree(segs->segments_);
+    WebPSafeFree(mem->owners_);
+    segs->segments_ = new_segments;
+    mem->owners_ = new_owners;
+    mem->segs_size_ = new_size;
+  }
+  segs->segments_[segs->num_].buf_ = data;
+  segs->segments_[segs->num_].size_ = data_size;
+  mem->owners_[segs->num_].release_ = release;
+  mem->owners_[segs->num_].user_data_ = user_data;
+  ++segs->num_;
+  mem->segs_total_ += data_size;
+  return 1;
+}
+
+static void FreeSegmentCopy(const uint8_t* data, size_t data_size,
+                            void* user_data) {
+  (void)data_size;
+  (void)user_data;
+  WebPSafeFree((void*)data);
+}
+
+// Appends a private copy of 'data' to the segment list.
+WEBP_NODISCARD static int AddSegmentCopy(MemBuffer* const mem,
+                                         const uint8_t* const data,
+                                         size_t data_size) {
+  uint8_t* copy;
+  if (data_size == 0) return 1;
+  if (data_size > MAX_CHUNK_PAYLOAD) return 0;
+  copy = (uint8_t*)WebPSafeMalloc(1ULL, data_size);
+  if (copy == NULL) return 0;
+  memcpy(copy, data, data_size);
+  if (!AddSegment(mem, copy, data_size, FreeSegmentCopy, NULL)) {
+    WebPSafeFree(copy);
+    return 0;
+  }
+  return 1;
+}
+
 WEBP_NODISCARD static int CheckMemBufferMode(MemBuffer* const mem,
                                              MemBufferMode expected) {
   if (mem->mode_ == MEM_MODE_NONE) {
@@ -331,12 +440,17 @@ static VP8StatusCode DecodeWebPHeaders(WebPIDecoder* const idec) {
 
   idec->chunk_size_ = headers.compressed_size;
   idec->is_lossless_ = headers.is_lossless;
+  if (idec->params_.stats != NULL) {
+    idec->params_.stats->bytes_consumed =
+        headers.offset + headers.compressed_size;
+  }
   if (!idec->is_lossless_) {
     VP8Decoder* const dec = VP8New();
     if (dec == NULL) {
       return VP8_STATUS_OUT_OF_MEMORY;
     }
     dec->incremental_ = 1;
+    dec->stats_ = idec->params_.stats;
     idec->dec_ = dec;
     dec->alpha_data_ = headers.alpha_data;
     dec->alpha_data_size_ = headers.alpha_data_size;
@@ -410,11 +524,14 @@ static VP8StatusCode DecodePartition0(WebPIDecoder* const idec) {
   const WebPDecParams* const params = &idec->params_;
   WebPDecBuffer* const output = params->output;
 
+  WebPStopwatch watch;
+
   // Wait till we have enough data for the whole partition #0
   if (MemDataSize(&idec->mem_) < idec->mem_.part0_size_) {
     return VP8_STATUS_SUSPENDED;
   }
 
+  if (dec->stats_ != NULL) WebPStopwatchReset(&watch);
   if (!VP8GetHeaders(dec, io)) {
     const VP8StatusCode status = dec->status_;
     if (status == VP8_STATUS_SUSPENDED ||
@@ -425,6 +542,10 @@ static VP8StatusCode DecodePartition0(WebPIDecoder* const idec) {
     return IDecError(idec, status);
   }
 
+  if (dec->stats_ != NULL) {
+    WebPDecStatsAddTime(dec->stats_, WEBP_DEC_STAGE_HEADERS, &watch);
+  }
+
   // Allocate/Verify output buffer now
   dec->status_ = WebPAllocateDecBuffer(io->width, io->height, params->options,
                                        output);
@@ -456,16 +577,33 @@ static VP8StatusCode DecodePartition0(WebPIDecoder* const idec) {
   return VP8_STATUS_OK;
 }
 
+// Returns the number of bytes left to read by the token partition reader 'br'.
+static size_t TokenDataSize(const WebPIDecoder* const idec,
+                            const VP8BitReader* const br) {
+  const MemBuffer* const mem = &idec->mem_;
+  size_t size;
+  int i;
+  if (!mem->use_segments_) return MemDataSize(mem);
+  size = (size_t)(br->buf_end_ - br->buf_);
+  for (i = br->next_segment_ - mem->segs_.first_; i < mem->segs_.num_; ++i) {
+    size += mem->segs_.segments_[i].size_;
+  }
+  return size;
+}
+
 // Remaining partitions
 static VP8StatusCode DecodeRemaining(WebPIDecoder* const idec) {
   VP8Decoder* const dec = (VP8Decoder*)idec->dec_;
   VP8Io* const io = &idec->io_;
+  WebPDecStats* const stats = dec->stats_;
+  WebPStopwatch watch;
 
   // Make sure partition #0 has been read before, to set dec to ready_.
   if (!dec->ready_) {
     return IDecError(idec, VP8_STATUS_BITSTREAM_ERROR);
   }
   for (; dec->mb_y_ < dec->mb_h_; ++dec->mb_y_) {
+    if (stats != NULL) WebPStopwatchReset(&watch);
     if (idec->last_mb_y_ != dec->mb_y_) {
       if (!VP8ParseIntraModeRow(&dec->br_, dec)) {
         // note: normally, error shouldn't occur since we already have the whole
@@ -483,7 +621,7 @@ static VP8StatusCode DecodeRemaining(WebPIDecoder* const idec) {
       if (!VP8DecodeMB(dec, token_br)) {
         // We shouldn't fail when MAX_MB data was available
         if (dec->num_parts_minus_one_ == 0 &&
-            MemDataSize(&idec->mem_) > MAX_MB_SIZE) {
+            TokenDataSize(idec, &context.token_br_) > MAX_MB_SIZE) {
           return IDecError(idec, VP8_STATUS_BITSTREAM_ERROR);
         }
         // Synchronize the threads.
@@ -493,15 +631,22 @@ static VP8StatusCode DecodeRemaining(WebPIDecoder* const idec) {
           }
         }
         RestoreContext(&context, dec, token_br);
+        if (stats != NULL) {
+          WebPDecStatsAddTime(stats, WEBP_DEC_STAGE_ENTROPY, &watch);
+        }
         return VP8_STATUS_SUSPENDED;
       }
-      // Release buffer only if there is only one partition
-      if (dec->num_parts_minus_one_ == 0) {
+      // Release buffer only if there is only one partition, and it is still
+      // read from mem_.buf_ (and not from the segments).
+      if (dec->num_parts_minus_one_ == 0 && token_br->next_segment_ == 0) {
         idec->mem_.start_ = token_br->buf_ - idec->mem_.buf_;
         assert(idec->mem_.start_ <= idec->mem_.end_);
       }
     }
     VP8InitScanline(dec);   // Prepare for next scanline
+    if (stats != NULL) {
+      WebPDecStatsAddTime(stats, WEBP_DEC_STAGE_ENTROPY, &watch);
+    }
 
     // Reconstruct, filter and emit the row.
     if (!VP8ProcessRow(dec, io)) {
@@ -531,6 +676,7 @@ static VP8StatusCode DecodeVP8LHeader(WebPIDecoder* const idec) {
   const WebPDecParams* const params = &idec->params_;
   WebPDecBuffer* const output = params->output;
   size_t curr_size = MemDataSize(&idec->mem_);
+  WebPStopwatch watch;
   assert(idec->is_lossless_);
 
   // Wait until there's enough data for decoding header.
@@ -539,6 +685,7 @@ static VP8StatusCode DecodeVP8LHeader(WebPIDecoder* const idec) {
     return ErrorStatusLossless(idec, dec->status_);
   }
 
+  if (params->stats != NULL) WebPStopwatchReset(&watch);
   if (!VP8LDecodeHeader(dec, io)) {
     if (dec->status_ == VP8_STATUS_BITSTREAM_ERROR &&
         curr_size < idec->chunk_size_) {
@@ -546,6 +693,9 @@ static VP8StatusCode DecodeVP8LHeader(WebPIDecoder* const idec) {
     }
     return ErrorStatusLossless(idec, dec->status_);
   }
+  if (params->stats != NULL) {
+    WebPDecStatsAddTime(params->stats, WEBP_DEC_STAGE_HEADERS, &watch);
+  }
   // Allocate/verify output buffer now.
   dec->status_ = WebPAllocateDecBuffer(io->width, io->height, params->options,
                                        output);
@@ -559,7 +709,8 @@ static VP8StatusCode DecodeVP8LHeader(WebPIDecoder* const idec) {
 
 static VP8StatusCode DecodeVP8LData(WebPIDecoder* const idec) {
   VP8LDecoder* const dec = (VP8LDecoder*)idec->dec_;
-  const size_t curr_size = MemDataSize(&idec->mem_);
+  const size_t curr_size =
+      MemDataSize(&idec->mem_) + idec->mem_.segs_total_;
   assert(idec->is_lossless_);
 
   // Switch to incremental decoding if we don't have all the bytes available.
@@ -606,6 +757,46 @@ static VP8StatusCode IDecode(WebPIDecoder* idec) {
   return status;
 }
 
+// Once the compressed pixel data is reached in append mode, new input is read
+// in place as segments following mem_.buf_. This is not done for lossy images
+// with several token partitions, which are located using offsets within a
+// single buffer.
+static void UpdateSegments(WebPIDecoder* const idec) {
+  MemBuffer* const mem = &idec->mem_;
+  int in_use;   // absolute index of the first segment still needed
+  if (mem->mode_ != MEM_MODE_APPEND) return;
+  if (!mem->use_segments_) {
+    assert(mem->segs_.first_ == 0 && mem->segs_.num_ == 0);
+    if (idec->state_ == STATE_VP8L_DATA) {
+      VP8LDecoder* const dec = (VP8LDecoder*)idec->dec_;
+      VP8LBitReaderSetSegments(&dec->br_, &mem->segs_);
+      VP8LBitReaderSetSegments(&dec->saved_br_, &mem->segs_);
+      mem->use_segments_ = 1;
+    } else if (idec->state_ == STATE_VP8_DATA) {
+      VP8Decoder* const dec = (VP8Decoder*)idec->dec_;
+      if (dec->num_parts_minus_one_ == 0) {
+        VP8BitReaderSetSegments(&dec->parts_[0], &mem->segs_);
+        mem->use_segments_ = 1;
+      }
+    }
+    return;
+  }
+  // Release the segments the bit-readers are done with.
+  if (idec->state_ == STATE_DONE || idec->state_ == STATE_ERROR) {
+    in_use = mem->segs_.first_ + mem->segs_.num_;
+  } else if (idec->is_lossless_) {
+    const VP8LDecoder* const dec = (const VP8LDecoder*)idec->dec_;
+    in_use = dec->br_.next_segment_ - 1;
+    if (dec->incremental_ && dec->saved_br_.next_segment_ - 1 < in_use) {
+      in_use = dec->saved_br_.next_segment_ - 1;
+    }
+  } else {
+    const VP8Decoder* const dec = (const VP8Decoder*)idec->dec_;
+    in_use = dec->parts_[0].next_segment_ - 1;
+  }
+  ReleaseSegments(mem, in_use - mem->segs_.first_);
+}
+
 //------------------------------------------------------------------------------
 // Internal constructor
 
@@ -675,6 +866,10 @@ WebPIDecoder* WebPIDecode(const uint8_t* data, size_t data_size,
   // Finish initialization
   if (config != NULL) {
     idec->params_.options = &config->options;
+    idec->params_.stats = config->options.stats;
+    if (config->options.stats != NULL) {
+      memset(config->options.stats, 0, sizeof(*config->options.stats));
+    }
   }
   return idec;
 }
@@ -804,11 +999,48 @@ VP8StatusCode WebPIAppend(WebPIDecoder* idec,
   if (!CheckMemBufferMode(&idec->mem_, MEM_MODE_APPEND)) {
     return VP8_STATUS_INVALID_PARAM;
   }
-  // Append data to memory buffer
-  if (!AppendToMemBuffer(idec, data, data_size)) {
+  // Append data to memory buffer, or as a new segment
+  if (idec->mem_.use_segments_) {
+    if (!AddSegmentCopy(&idec->mem_, data, data_size)) {
+      return VP8_STATUS_OUT_OF_MEMORY;
+    }
+  } else if (!AppendToMemBuffer(idec, data, data_size)) {
     return VP8_STATUS_OUT_OF_MEMORY;
   }
-  return IDecode(idec);
+  status = IDecode(idec);
+  UpdateSegments(idec);
+  return status;
+}
+
+VP8StatusCode WebPIAppendSegment(WebPIDecoder* idec,
+                                 const uint8_t* data, size_t data_size,
+                                 WebPIReleaseFunc release, void* user_data) {
+  VP8StatusCode status = VP8_STATUS_INVALID_PARAM;
+  int in_place = 0;   // true if 'data' was added to the segment list
+  if (idec != NULL && data != NULL) {
+    MemBuffer* const mem = &idec->mem_;
+    status = IDecCheckStatus(idec);
+    if (status == VP8_STATUS_SUSPENDED) {
+      if (!CheckMemBufferMode(mem, MEM_MODE_APPEND)) {
+        status = VP8_STATUS_INVALID_PARAM;
+      } else if (!mem->use_segments_) {
+        // Headers and partition #0 are gathered in mem_.buf_.
+        if (!AppendToMemBuffer(idec, data, data_size)) {
+          status = VP8_STATUS_OUT_OF_MEMORY;
+        }
+      } else if (data_size > 0) {
+        in_place = (data_size <= MAX_CHUNK_PAYLOAD) &&
+                   AddSegment(mem, data, data_size, release, user_data);
+        if (!in_place) status = VP8_STATUS_OUT_OF_MEMORY;
+      }
+      if (status == VP8_STATUS_SUSPENDED) {
+        status = IDecode(idec);
+        UpdateSegments(idec);
+      }
+    }
+  }
+  if (!in_place && release != NULL) release(data, data_size, user_data);
+  return status;
 }
 
 VP8StatusCode WebPIUpdate(WebPIDecoder* idec,
@@ -19,6 +19,24 @@
 #include "src/dsp/yuv.h"
 #include "src/utils/utils.h"
 
+//------------------------------------------------------------------------------
+
+// Returns 'size' bytes of scratch memory, to be released by CustomTeardown().
+// With a decoding context, the memory is kept for the next picture.
+static void* AllocateScratch(WebPDecParams* const p, size_t size) {
+  WebPDecoderContext* const ctx = p->context;
+  if (p->stats != NULL) p->stats->peak_memory += size;
+  if (ctx == NULL) return WebPSafeMalloc(1ULL, size);
+  if (size > ctx->scratch_size) {
+    WebPSafeFree(ctx->scratch);
+    ctx->scratch_size = 0;
+    ctx->scratch = WebPSafeMalloc(1ULL, size);
+    if (ctx->scratch == NULL) return NULL;
+    ctx->scratch_size = size;
+  }
+  return ctx->scratch;
+}
+
 //------------------------------------------------------------------------------
 // Main YUV<->RGB conversion functions
 
@@ -38,6 +56,40 @@ static int EmitYUV(const VP8Io* const io, WebPDecParams* const p) {
   return io->mb_h;
 }
 
+void WebPInterleaveUV(const uint8_t* src0, const uint8_t* src1,
+                      uint8_t* dst, int len) {
+  int i;
+  for (i = 0; i < len; ++i) {
+    dst[2 * i + 0] = src0[i];
+    dst[2 * i + 1] = src1[i];
+  }
+}
+
+// Semi-planar output: the luma plane is copied, while the U/V samples are
+// interleaved straight into the chroma plane of the output buffer.
+static int EmitNV(const VP8Io* const io, WebPDecParams* const p) {
+  WebPDecBuffer* output = p->output;
+  const WebPYUVABuffer* const buf = &output->u.YUVA;
+  const int u_first = (output->colorspace == MODE_NV12);
+  const uint8_t* src0 = u_first ? io->u : io->v;
+  const uint8_t* src1 = u_first ? io->v : io->u;
+  uint8_t* const y_dst = buf->y + (size_t)io->mb_y * buf->y_stride;
+  uint8_t* uv_dst = (u_first ? buf->u : buf->v) +
+                    (size_t)(io->mb_y >> 1) * buf->u_stride;
+  const int mb_w = io->mb_w;
+  const int mb_h = io->mb_h;
+  const int uv_w = (mb_w + 1) / 2;
+  int uv_h = (mb_h + 1) / 2;
+  WebPCopyPlane(io->y, io->y_stride, y_dst, buf->y_stride, mb_w, mb_h);
+  while (uv_h-- > 0) {
+    WebPInterleaveUV(src0, src1, uv_dst, uv_w);
+    src0 += io->uv_stride;
+    src1 += io->uv_stride;
+    uv_dst += buf->u_stride;
+  }
+  return io->mb_h;
+}
+
 // Point-sampling U/V sampler.
 static int EmitSampledRGB(const VP8Io* const io, WebPDecParams* const p) {
   WebPDecBuffer* const output = p->output;
@@ -268,6 +320,45 @@ static int EmitRescaledYUV(const VP8Io* const io, WebPDecParams* const p) {
   return num_lines_out;
 }
 
+// The U/V rescalers export into their own scratch rows, which are then
+// interleaved into the semi-planar chroma plane.
+static void ExportNV(WebPDecParams* const p) {
+  const WebPYUVABuffer* const buf = &p->output->u.YUVA;
+  const int u_first = (p->output->colorspace == MODE_NV12);
+  const WebPRescaler* const scaler0 = u_first ? p->scaler_u : p->scaler_v;
+  const WebPRescaler* const scaler1 = u_first ? p->scaler_v : p->scaler_u;
+  uint8_t* const uv_dst = u_first ? buf->u : buf->v;
+  while (WebPRescalerHasPendingOutput(p->scaler_u)) {
+    const int uv_y = p->scaler_u->dst_y;
+    assert(p->scaler_u->y_accum == p->scaler_v->y_accum);
+    WebPRescalerExportRow(p->scaler_u);
+    WebPRescalerExportRow(p->scaler_v);
+    WebPInterleaveUV(scaler0->dst, scaler1->dst,
+                     uv_dst + (size_t)uv_y * buf->u_stride,
+                     p->scaler_u->dst_width);
+  }
+}
+
+static int EmitRescaledNV(const VP8Io* const io, WebPDecParams* const p) {
+  const int mb_h = io->mb_h;
+  const int uv_mb_h = (mb_h + 1) >> 1;
+  const int num_lines_out = Rescale(io->y, io->y_stride, mb_h, p->scaler_y);
+  int uv_j = 0;
+  while (uv_j < uv_mb_h) {
+    const int u_lines_in = WebPRescalerImport(
+        p->scaler_u, uv_mb_h - uv_j, io->u + (size_t)uv_j * io->uv_stride,
+        io->uv_stride);
+    const int v_lines_in = WebPRescalerImport(
+        p->scaler_v, uv_mb_h - uv_j, io->v + (size_t)uv_j * io->uv_stride,
+        io->uv_stride);
+    (void)v_lines_in;   // remove a gcc warning
+    assert(u_lines_in == v_lines_in);
+    uv_j += u_lines_in;
+    ExportNV(p);
+  }
+  return num_lines_out;
+}
+
 static int EmitRescaledAlphaYUV(const VP8Io* const io, WebPDecParams* const p,
                                 int expected_num_lines_out) {
   const WebPYUVABuffer* const buf = &p->output->u.YUVA;
@@ -291,6 +382,7 @@ static int EmitRescaledAlphaYUV(const VP8Io* const io, WebPDecParams* const p,
 
 static int InitYUVRescaler(const VP8Io* const io, WebPDecParams* const p) {
   const int has_alpha = WebPIsAlphaMode(p->output->colorspace);
+  const int is_nv = WebPIsSemiPlanarMode(p->output->colorspace);
   const WebPYUVABuffer* const buf = &p->output->u.YUVA;
   const int out_width  = io->scaled_width;
   const int out_height = io->scaled_height;
@@ -301,7 +393,10 @@ static int InitYUVRescaler(const VP8Io* const io, WebPDecParams* const p) {
   // scratch memory for luma rescaler
   const size_t work_size = 2 * (size_t)out_width;
   const size_t uv_work_size = 2 * uv_out_width;  // and for each u/v ones
+  // semi-planar output needs a private export row for each of u/v
+  const size_t uv_tmp_size = is_nv ? 2 * (size_t)uv_out_width : 0;
   uint64_t total_size;
+  uint8_t* uv_tmp;
   size_t rescaler_size;
   rescaler_t* work;
   WebPRescaler* scalers;
@@ -311,17 +406,20 @@ static int InitYUVRescaler(const VP8Io* const io, WebPDecParams* const p) {
   if (has_alpha) {
     total_size += (uint64_t)work_size * sizeof(*work);
   }
+  total_size += uv_tmp_size;
   rescaler_size = num_rescalers * sizeof(*p->scaler_y) + WEBP_ALIGN_CST;
   total_size += rescaler_size;
   if (!CheckSizeOverflow(total_size)) {
     return 0;
   }
 
-  p->memory = WebPSafeMalloc(1ULL, (size_t)total_size);
+  p->memory = AllocateScratch(p, (size_t)total_size);
   if (p->memory == NULL) {
     return 0;   // memory error
   }
   work = (rescaler_t*)p->memory;
+  uv_tmp = (uint8_t*)(work + work_size + 2 * uv_work_size +
+                      (has_alpha ? work_size : 0));
 
   scalers = (WebPRescaler*)WEBP_ALIGN(
       (const uint8_t*)work + total_size - rescaler_size);
@@ -334,14 +432,17 @@ static int InitYUVRescaler(const VP8Io* const io, WebPDecParams* const p) {
                         buf->y, out_width, out_height, buf->y_stride, 1,
                         work) ||
       !WebPRescalerInit(p->scaler_u, uv_in_width, uv_in_height,
-                        buf->u, uv_out_width, uv_out_height, buf->u_stride, 1,
+                        is_nv ? uv_tmp : buf->u, uv_out_width, uv_out_height,
+                        is_nv ? 0 : buf->u_stride, 1,
                         work + work_size) ||
       !WebPRescalerInit(p->scaler_v, uv_in_width, uv_in_height,
-                        buf->v, uv_out_width, uv_out_height, buf->v_stride, 1,
+                        is_nv ? uv_tmp + uv_out_width : buf->v,
+                        uv_out_width, uv_out_height,
+                        is_nv ? 0 : buf->v_stride, 1,
                         work + work_size + uv_work_size)) {
     return 0;
   }
-  p->emit = EmitRescaledYUV;
+  p->emit = is_nv ? EmitRescaledNV : EmitRescaledYUV;
 
   if (has_alpha) {
     if (!WebPRescalerInit(p->scaler_a, io->mb_w, io->mb_h,
@@ -509,7 +610,7 @@ static int InitRGBRescaler(const VP8Io* const io, WebPDecParams* const p) {
     return 0;
   }
 
-  p->memory = WebPSafeMalloc(1ULL, (size_t)total_size);
+  p->memory = AllocateScratch(p, (size_t)total_size);
   if (p->memory == NULL) {
     return 0;   // memory error
   }
@@ -592,7 +693,7 @@ static int CustomSetup(VP8Io* io) {
       if (io->fancy_upsampling) {
 #ifdef FANCY_UPSAMPLING
         const int uv_width = (io->mb_w + 1) >> 1;
-        p->memory = WebPSafeMalloc(1ULL, (size_t)(io->mb_w + 2 * uv_width));
+        p->memory = AllocateScratch(p, (size_t)(io->mb_w + 2 * uv_width));
         if (p->memory == NULL) {
           return 0;   // memory error.
         }
@@ -604,7 +705,7 @@ static int CustomSetup(VP8Io* io) {
 #endif
       }
     } else {
-      p->emit = EmitYUV;
+      p->emit = WebPIsSemiPlanarMode(colorspace) ? EmitNV : EmitYUV;
     }
     if (is_alpha) {  // need transparency output
       p->emit_alpha =
@@ -628,15 +729,22 @@ static int CustomPut(const VP8Io* io) {
   const int mb_w = io->mb_w;
   const int mb_h = io->mb_h;
   int num_lines_out;
+  WebPStopwatch watch;
   assert(!(io->mb_y & 1));
 
   if (mb_w <= 0 || mb_h <= 0) {
     return 0;
   }
+  if (p->stats != NULL) WebPStopwatchReset(&watch);
   num_lines_out = p->emit(io, p);
   if (p->emit_alpha != NULL) {
     p->emit_alpha(io, p, num_lines_out);
   }
+  if (p->stats != NULL) {
+    WebPDecStatsAddTime(p->stats, io->use_scaling ? WEBP_DEC_STAGE_RESCALE
+                                                  : WEBP_DEC_STAGE_EMIT,
+                        &watch);
+  }
   p->last_y += num_lines_out;
   return 1;
 }
@@ -645,7 +753,7 @@ static int CustomPut(const VP8Io* io) {
 
 static void CustomTeardown(const VP8Io* io) {
   WebPDecParams* const p = (WebPDecParams*)io->opaque;
-  WebPSafeFree(p->memory);
+  if (p->context == NULL) WebPSafeFree(p->memory);
   p->memory = NULL;
 }
 
@@ -59,6 +59,7 @@ VP8Decoder* VP8New(void) {
   if (dec != NULL) {
     SetOk(dec);
     WebPGetWorkerInterface()->Init(&dec->worker_);
+    WebPGetWorkerInterface()->Init(&dec->alpha_worker_);
     dec->ready_ = 0;
     dec->num_parts_minus_one_ = 0;
     InitGetCoeffs();
@@ -84,6 +85,28 @@ void VP8Delete(VP8Decoder* const dec) {
   }
 }
 
+void VP8Recycle(VP8Decoder* const dec) {
+  if (dec == NULL) return;
+  (void)WebPGetWorkerInterface()->Sync(&dec->worker_);
+  WebPRecycleAlphaMemory(dec);
+  // Reset the fields not re-initialized by VP8GetHeaders() and
+  // VP8EnterCritical(). 'mem_', 'alpha_plane_mem_' and the workers are kept.
+  SetOk(dec);
+  dec->ready_ = 0;
+  memset(&dec->br_, 0, sizeof(dec->br_));
+  dec->incremental_ = 0;
+  dec->mt_method_ = 0;
+  dec->num_parts_minus_one_ = 0;
+  dec->dither_ = 0;
+  memset(dec->dqm_, 0, sizeof(dec->dqm_));
+  dec->alpha_data_ = NULL;
+  dec->alpha_data_size_ = 0;
+  dec->is_alpha_decoded_ = 0;
+  dec->alpha_prev_line_ = NULL;
+  dec->alpha_dithering_ = 0;
+  dec->alpha_async_ = 0;
+}
+
 int VP8SetError(VP8Decoder* const dec,
                 VP8StatusCode error, const char* const msg) {
   // VP8_STATUS_SUSPENDED is only meaningful in incremental decoding.
@@ -644,10 +667,13 @@ void VP8InitScanline(VP8Decoder* const dec) {
 }
 
 static int ParseFrame(VP8Decoder* const dec, VP8Io* io) {
+  WebPDecStats* const stats = dec->stats_;
+  WebPStopwatch watch;
   for (dec->mb_y_ = 0; dec->mb_y_ < dec->br_mb_y_; ++dec->mb_y_) {
     // Parse bitstream for this row.
     VP8BitReader* const token_br =
         &dec->parts_[dec->mb_y_ & dec->num_parts_minus_one_];
+    if (stats != NULL) WebPStopwatchReset(&watch);
     if (!VP8ParseIntraModeRow(&dec->br_, dec)) {
       return VP8SetError(dec, VP8_STATUS_NOT_ENOUGH_DATA,
                          "Premature end-of-partition0 encountered.");
@@ -659,6 +685,9 @@ static int ParseFrame(VP8Decoder* const dec, VP8Io* io) {
       }
     }
     VP8InitScanline(dec);   // Prepare for next scanline
+    if (stats != NULL) {
+      WebPDecStatsAddTime(stats, WEBP_DEC_STAGE_ENTROPY, &watch);
+    }
 
     // Reconstruct, filter and emit the row.
     if (!VP8ProcessRow(dec, io)) {
@@ -152,6 +152,10 @@ void VP8Clear(VP8Decoder* const dec);
 // Destroy the decoder object.
 void VP8Delete(VP8Decoder* const dec);
 
+// Resets the decoder for a new picture, as VP8New() would. Contrary to
+// VP8Clear(), the scratch memory and the worker threads are kept.
+void VP8Recycle(VP8Decoder* const dec);
+
 //------------------------------------------------------------------------------
 // Miscellaneous VP8/VP8L bitstream probing functions.
 
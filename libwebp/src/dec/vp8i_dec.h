@@ -188,6 +188,7 @@ struct VP8Decoder {
   // Main data source
   VP8BitReader br_;
   int incremental_;  // if true, incremental decoding is expected
+  WebPDecStats* stats_;  // if not NULL, filled with statistics
 
   // headers
   VP8FrameHeader   frm_hdr_;
@@ -261,9 +262,17 @@ struct VP8Decoder {
   size_t alpha_data_size_;
   int is_alpha_decoded_;      // true if alpha_data_ is decoded in alpha_plane_
   uint8_t* alpha_plane_mem_;  // memory allocated for alpha_plane_
+  size_t alpha_plane_mem_size_;  // kept between pictures by VP8Recycle()
   uint8_t* alpha_plane_;      // output. Persistent, contains the whole data.
   const uint8_t* alpha_prev_line_;  // last decoded alpha row (or NULL)
   int alpha_dithering_;       // derived from decoding options (0=off, 100=full)
+  struct WebPSmoothParams* alpha_smoother_;  // alpha dithering in progress
+
+  // Concurrent alpha decoding
+  int alpha_async_;           // if true, rows are decoded on alpha_worker_
+  WebPWorker alpha_worker_;   // decodes alpha rows ahead of the output
+  int alpha_last_row_;        // rows before this one are decoded
+  int alpha_end_row_;         // last row targeted by the running alpha job
 };
 
 //------------------------------------------------------------------------------
@@ -309,6 +318,11 @@ WEBP_NODISCARD int VP8DecodeMB(VP8Decoder* const dec,
                                VP8BitReader* const token_br);
 
 // in alpha.c
+// Initializes the alpha decoder and starts decoding rows on
+// dec->alpha_worker_, if dec->alpha_async_ is set. To be called once the
+// cropping parameters of 'io' are known.
+WEBP_NODISCARD int VP8StartAlphaDecoding(VP8Decoder* const dec,
+                                         const VP8Io* const io);
 const uint8_t* VP8DecompressAlphaRows(VP8Decoder* const dec,
                                       const VP8Io* const io,
                                       int row, int num_rows);
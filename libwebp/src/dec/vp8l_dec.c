@@ -26,6 +26,11 @@
 
 #define NUM_ARGB_CACHE_ROWS          16
 
+// Largest backward-reference distance and length that the bitstream can
+// express (see GetCopyDistance() and PlaneCodeToDistance()).
+#define MAX_COPY_DISTANCE            (1 << 20)
+#define MAX_COPY_LENGTH              4096
+
 static const int kCodeLengthLiterals = 16;
 static const int kCodeLengthRepeatCode = 16;
 static const uint8_t kCodeLengthExtraBits[3] = { 2, 3, 7 };
@@ -450,6 +455,36 @@ static int ReadHuffmanCodes(VP8LDecoder* const dec, int xsize, int ysize,
   return ok;
 }
 
+// Allocates the root segment of 'huffman_tables', reusing the spare one if it
+// is large enough.
+static int AllocateHuffmanTables(VP8LDecoder* const dec, int size,
+                                 HuffmanTables* const huffman_tables) {
+  HuffmanTablesSegment* const root = &huffman_tables->root;
+  if (dec->huffman_spare_ == NULL || dec->huffman_spare_size_ < size) {
+    return VP8LHuffmanTablesAllocate(size, huffman_tables);
+  }
+  root->start = dec->huffman_spare_;
+  root->curr_table = root->start;
+  root->size = dec->huffman_spare_size_;
+  root->next = NULL;
+  huffman_tables->curr_segment = root;
+  dec->huffman_spare_ = NULL;
+  dec->huffman_spare_size_ = 0;
+  return 1;
+}
+
+// Moves the root segment of the current Huffman tables to the spare one, if
+// larger. The rest is left for ClearMetadata().
+static void KeepHuffmanTables(VP8LDecoder* const dec) {
+  HuffmanTablesSegment* const root = &dec->hdr_.huffman_tables_.root;
+  if (root->start != NULL && root->size > dec->huffman_spare_size_) {
+    WebPSafeFree(dec->huffman_spare_);
+    dec->huffman_spare_ = root->start;
+    dec->huffman_spare_size_ = root->size;
+    root->start = NULL;
+  }
+}
+
 int ReadHuffmanCodesHelper(int color_cache_bits, int num_htree_groups,
                            int num_htree_groups_max, const int* const mapping,
                            VP8LDecoder* const dec,
@@ -471,8 +506,8 @@ int ReadHuffmanCodesHelper(int color_cache_bits, int num_htree_groups,
   *htree_groups = VP8LHtreeGroupsNew(num_htree_groups);
 
   if (*htree_groups == NULL || code_lengths == NULL ||
-      !VP8LHuffmanTablesAllocate(num_htree_groups * table_size,
-                                 huffman_tables)) {
+      !AllocateHuffmanTables(dec, num_htree_groups * table_size,
+                             huffman_tables)) {
     VP8LSetError(dec, VP8_STATUS_OUT_OF_MEMORY);
     goto Error;
   }
@@ -576,6 +611,7 @@ static int AllocateAndInitRescaler(VP8LDecoder* const dec, VP8Io* const io) {
   if (memory == NULL) {
     return VP8LSetError(dec, VP8_STATUS_OUT_OF_MEMORY);
   }
+  if (dec->stats_ != NULL) dec->stats_->peak_memory += (size_t)memory_size;
   assert(dec->rescaler_memory == NULL);
   dec->rescaler_memory = memory;
 
@@ -661,6 +697,39 @@ static int EmitRows(WEBP_CSP_MODE colorspace,
 //------------------------------------------------------------------------------
 // Export to YUVA
 
+// Number of U/V samples converted at once for the semi-planar modes.
+#define NV_UV_CHUNK 64
+
+// Same as WebPConvertARGBToUV(), but for an interleaved chroma plane.
+static void ConvertToSemiPlanarUV(const uint32_t* src, int width, int y_pos,
+                                  const WebPDecBuffer* const output) {
+  const WebPYUVABuffer* const buf = &output->u.YUVA;
+  const int u_first = (output->colorspace == MODE_NV12);
+  const int do_store = !(y_pos & 1);
+  uint8_t* dst = (u_first ? buf->u : buf->v) + (y_pos >> 1) * buf->u_stride;
+  uint8_t tmp_u[NV_UV_CHUNK], tmp_v[NV_UV_CHUNK];
+  int x;
+  for (x = 0; x < width; x += 2 * NV_UV_CHUNK) {
+    const int w = (width - x < 2 * NV_UV_CHUNK) ? width - x : 2 * NV_UV_CHUNK;
+    const int uv_w = (w + 1) >> 1;
+    const uint8_t* const src0 = u_first ? tmp_u : tmp_v;
+    const uint8_t* const src1 = u_first ? tmp_v : tmp_u;
+    WebPConvertARGBToUV(src + x, tmp_u, tmp_v, w, 1);
+    if (do_store) {
+      WebPInterleaveUV(src0, src1, dst, uv_w);
+    } else {
+      // odd lines: average with previous values, as WebPConvertARGBToUV does
+      int i;
+      for (i = 0; i < uv_w; ++i) {
+        dst[2 * i + 0] = (dst[2 * i + 0] + src0[i] + 1) >> 1;
+        dst[2 * i + 1] = (dst[2 * i + 1] + src1[i] + 1) >> 1;
+      }
+    }
+    dst += 2 * uv_w;
+  }
+}
+#undef NV_UV_CHUNK
+
 static void ConvertToYUVA(const uint32_t* const src, int width, int y_pos,
                           const WebPDecBuffer* const output) {
   const WebPYUVABuffer* const buf = &output->u.YUVA;
@@ -669,7 +738,9 @@ static void ConvertToYUVA(const uint32_t* const src, int width, int y_pos,
   WebPConvertARGBToY(src, buf->y + y_pos * buf->y_stride, width);
 
   // then U/V planes
-  {
+  if (WebPIsSemiPlanarMode(output->colorspace)) {
+    ConvertToSemiPlanarUV(src, width, y_pos, output);
+  } else {
     uint8_t* const u = buf->u + (y_pos >> 1) * buf->u_stride;
     uint8_t* const v = buf->v + (y_pos >> 1) * buf->v_stride;
     // even lines: store values
@@ -808,7 +879,8 @@ static void ApplyInverseTransforms(VP8LDecoder* const dec,
 // Processes (transforms, scales & color-converts) the rows decoded after the
 // last call.
 static void ProcessRows(VP8LDecoder* const dec, int row) {
-  const uint32_t* const rows = dec->pixels_ + dec->width_ * dec->last_row_;
+  const uint32_t* const rows =
+      dec->pixels_ + (dec->width_ * dec->last_row_ - dec->window_start_);
   const int num_rows = row - dec->last_row_;
 
   assert(row <= dec->io_->crop_bottom);
@@ -819,7 +891,15 @@ static void ProcessRows(VP8LDecoder* const dec, int row) {
     VP8Io* const io = dec->io_;
     uint8_t* rows_data = (uint8_t*)dec->argb_cache_;
     const int in_stride = io->width * sizeof(uint32_t);  // in unit of RGBA
+    WebPDecStats* const stats = dec->stats_;
+    // The pixels were entropy-decoded since the last checkpoint.
+    if (stats != NULL) {
+      WebPDecStatsAddTime(stats, WEBP_DEC_STAGE_ENTROPY, &dec->watch_);
+    }
     ApplyInverseTransforms(dec, dec->last_row_, num_rows, rows);
+    if (stats != NULL) {
+      WebPDecStatsAddTime(stats, WEBP_DEC_STAGE_RECONSTRUCTION, &dec->watch_);
+    }
     if (!SetCropWindow(io, dec->last_row_, row, &rows_data, in_stride)) {
       // Nothing to output (this time).
     } else {
@@ -845,6 +925,11 @@ static void ProcessRows(VP8LDecoder* const dec, int row) {
       }
       assert(dec->last_out_row_ <= output->height);
     }
+    if (stats != NULL) {
+      WebPDecStatsAddTime(stats, io->use_scaling ? WEBP_DEC_STAGE_RESCALE
+                                                 : WEBP_DEC_STAGE_EMIT,
+                          &dec->watch_);
+    }
   }
 
   // Update 'last_row_'.
@@ -1134,6 +1219,46 @@ static void RestoreState(VP8LDecoder* const dec) {
   }
 }
 
+// Sets the end of the decodable area of 'data' for an image of 'num_pixels'
+// pixels, the last pixel to decode, and the position past which the sliding
+// window needs to be moved before decoding the next row.
+static void GetWindowBounds(const VP8LDecoder* const dec, uint32_t* const data,
+                            int num_pixels, int last_pixel,
+                            uint32_t** const end, uint32_t** const last,
+                            uint32_t** const slide) {
+  const int start = dec->window_start_;
+  if (dec->window_size_ > 0 && num_pixels - start > dec->window_size_) {
+    const int size = dec->window_size_;
+    *end = data + size;
+    *last = data + ((last_pixel - start < size) ? last_pixel - start : size);
+    // Room for the rest of a row plus a backward copy is kept, so that writes
+    // never go past the window between two checks.
+    *slide = data + size - dec->width_ - MAX_COPY_LENGTH;
+  } else {
+    *end = data + (num_pixels - start);
+    *last = data + (last_pixel - start);
+    *slide = *end;
+  }
+}
+
+// Moves the pixels that can still be referenced (by a backward copy, the
+// inverse transforms or a restart of the incremental decoding) to the
+// beginning of the sliding window. 'pos' is the current decoding position.
+// Returns the number of pixels the window advanced by.
+static int SlideWindow(VP8LDecoder* const dec, int pos) {
+  int keep = (dec->incremental_ ? dec->saved_last_pixel_ : pos) -
+             MAX_COPY_DISTANCE;
+  int shift;
+  if (keep > dec->width_ * dec->last_row_) keep = dec->width_ * dec->last_row_;
+  if (keep < dec->window_start_) keep = dec->window_start_;
+  shift = keep - dec->window_start_;
+  assert(pos - keep < dec->window_size_ - dec->width_ - MAX_COPY_LENGTH);
+  memmove(dec->pixels_, dec->pixels_ + shift,
+          (pos - keep) * sizeof(*dec->pixels_));
+  dec->window_start_ = keep;
+  return shift;
+}
+
 #define SYNC_EVERY_N_ROWS 8  // minimum number of rows between check-points
 static int DecodeImageData(VP8LDecoder* const dec, uint32_t* const data,
                            int width, int height, int last_row,
@@ -1142,25 +1267,28 @@ static int DecodeImageData(VP8LDecoder* const dec, uint32_t* const data,
   int col = dec->last_pixel_ % width;
   VP8LBitReader* const br = &dec->br_;
   VP8LMetadata* const hdr = &dec->hdr_;
-  uint32_t* src = data + dec->last_pixel_;
+  uint32_t* src = data + (dec->last_pixel_ - dec->window_start_);
   uint32_t* last_cached = src;
-  uint32_t* const src_end = data + width * height;     // End of data
-  uint32_t* const src_last = data + width * last_row;  // Last pixel to decode
+  uint32_t* src_end;     // End of data
+  uint32_t* src_last;    // Last pixel to decode
+  uint32_t* src_slide;   // Sliding window threshold
   const int len_code_limit = NUM_LITERAL_CODES + NUM_LENGTH_CODES;
   const int color_cache_limit = len_code_limit + hdr->color_cache_size_;
   int next_sync_row = dec->incremental_ ? row : 1 << 24;
   VP8LColorCache* const color_cache =
       (hdr->color_cache_size_ > 0) ? &hdr->color_cache_ : NULL;
   const int mask = hdr->huffman_mask_;
-  const HTreeGroup* htree_group =
-      (src < src_last) ? GetHtreeGroupForPos(hdr, col, row) : NULL;
+  const HTreeGroup* htree_group;
+  GetWindowBounds(dec, data, width * height, width * last_row,
+                  &src_end, &src_last, &src_slide);
+  htree_group = (src < src_last) ? GetHtreeGroupForPos(hdr, col, row) : NULL;
   assert(dec->last_row_ < last_row);
   assert(src_last <= src_end);
 
   while (src < src_last) {
     int code;
     if (row >= next_sync_row) {
-      SaveState(dec, (int)(src - data));
+      SaveState(dec, dec->window_start_ + (int)(src - data));
       next_sync_row = row + SYNC_EVERY_N_ROWS;
     }
     // Only update when changing tile. Note we could use this test:
@@ -1211,6 +1339,14 @@ static int DecodeImageData(VP8LDecoder* const dec, uint32_t* const data,
             VP8LColorCacheInsert(color_cache, *last_cached++);
           }
         }
+        if (src > src_slide) {
+          const int shift =
+              SlideWindow(dec, dec->window_start_ + (int)(src - data));
+          src -= shift;
+          last_cached = src;
+          GetWindowBounds(dec, data, width * height, width * last_row,
+                          &src_end, &src_last, &src_slide);
+        }
       }
     } else if (code < len_code_limit) {  // Backward reference
       int dist_code, dist;
@@ -1247,6 +1383,14 @@ static int DecodeImageData(VP8LDecoder* const dec, uint32_t* const data,
           VP8LColorCacheInsert(color_cache, *last_cached++);
         }
       }
+      if (src > src_slide) {
+        const int shift =
+            SlideWindow(dec, dec->window_start_ + (int)(src - data));
+        src -= shift;
+        last_cached = src;
+        GetWindowBounds(dec, data, width * height, width * last_row,
+                        &src_end, &src_last, &src_slide);
+      }
     } else if (code < color_cache_limit) {  // Color cache
       const int key = code - len_code_limit;
       assert(color_cache != NULL);
@@ -1280,7 +1424,8 @@ static int DecodeImageData(VP8LDecoder* const dec, uint32_t* const data,
       process_func(dec, row > last_row ? last_row : row);
     }
     dec->status_ = VP8_STATUS_OK;
-    dec->last_pixel_ = (int)(src - data);  // end-of-scan marker
+    // end-of-scan marker
+    dec->last_pixel_ = dec->window_start_ + (int)(src - data);
   } else {
     // if not incremental, and we are past the end of buffer (eos_=1), then this
     // is a real bitstream error.
@@ -1426,6 +1571,9 @@ static void VP8LClear(VP8LDecoder* const dec) {
 
   WebPSafeFree(dec->pixels_);
   dec->pixels_ = NULL;
+  dec->pixels_size_ = 0;
+  dec->window_start_ = 0;
+  dec->window_size_ = 0;
   for (i = 0; i < dec->next_transform_; ++i) {
     ClearTransform(&dec->transforms_[i]);
   }
@@ -1441,10 +1589,33 @@ static void VP8LClear(VP8LDecoder* const dec) {
 void VP8LDelete(VP8LDecoder* const dec) {
   if (dec != NULL) {
     VP8LClear(dec);
+    WebPSafeFree(dec->huffman_spare_);
     WebPSafeFree(dec);
   }
 }
 
+void VP8LRecycle(VP8LDecoder* const dec) {
+  uint32_t* pixels;
+  size_t pixels_size;
+  HuffmanCode* huffman_spare;
+  int huffman_spare_size;
+  if (dec == NULL) return;
+  KeepHuffmanTables(dec);
+  pixels = dec->pixels_;
+  pixels_size = dec->pixels_size_;
+  dec->pixels_ = NULL;
+  VP8LClear(dec);
+  huffman_spare = dec->huffman_spare_;
+  huffman_spare_size = dec->huffman_spare_size_;
+  memset(dec, 0, sizeof(*dec));
+  dec->status_ = VP8_STATUS_OK;
+  dec->state_ = READ_DIM;
+  dec->pixels_ = pixels;
+  dec->pixels_size_ = pixels_size;
+  dec->huffman_spare_ = huffman_spare;
+  dec->huffman_spare_size_ = huffman_spare_size;
+}
+
 static void UpdateDecoder(VP8LDecoder* const dec, int width, int height) {
   VP8LMetadata* const hdr = &dec->hdr_;
   const int num_bits = hdr->huffman_subsample_bits_;
@@ -1537,15 +1708,41 @@ static int DecodeImageStream(int xsize, int ysize,
       assert(is_level0);
     }
     dec->last_pixel_ = 0;  // Reset for future DECODE_DATA_FUNC() calls.
-    if (!is_level0) ClearMetadata(hdr);  // Clean up temporary data behind.
+    if (!is_level0) {  // Clean up temporary data behind.
+      KeepHuffmanTables(dec);
+      ClearMetadata(hdr);
+    }
   }
   return ok;
 }
 
 //------------------------------------------------------------------------------
 // Allocate internal buffers dec->pixels_ and dec->argb_cache_.
+
+// Makes 'dec->pixels_' hold at least 'nmemb * size' bytes, reusing the buffer
+// kept by VP8LRecycle() if possible.
+static int AllocatePixels(VP8LDecoder* const dec, uint64_t nmemb,
+                          size_t size) {
+  if (dec->pixels_ != NULL && nmemb * size <= dec->pixels_size_) return 1;
+  WebPSafeFree(dec->pixels_);
+  dec->pixels_size_ = 0;
+  dec->pixels_ = (uint32_t*)WebPSafeMalloc(nmemb, size);
+  if (dec->pixels_ == NULL) return 0;
+  dec->pixels_size_ = (size_t)(nmemb * size);
+  return 1;
+}
+
 static int AllocateInternalBuffers32b(VP8LDecoder* const dec, int final_width) {
-  const uint64_t num_pixels = (uint64_t)dec->width_ * dec->height_;
+  const uint64_t image_pixels = (uint64_t)dec->width_ * dec->height_;
+  // Size of the sliding window: twice the longest backward reference, so that
+  // pixels are moved at most about once, plus room for the rows waiting to be
+  // transformed and for the longest copy.
+  const uint64_t window_pixels =
+      2 * MAX_COPY_DISTANCE +
+      (uint64_t)dec->width_ * (NUM_ARGB_CACHE_ROWS + SYNC_EVERY_N_ROWS + 2) +
+      2 * MAX_COPY_LENGTH;
+  const uint64_t num_pixels =
+      (image_pixels > window_pixels) ? window_pixels : image_pixels;
   // Scratch buffer corresponding to top-prediction row for transforming the
   // first row in the row-blocks. Not needed for paletted alpha.
   const uint64_t cache_top_pixels = (uint16_t)final_width;
@@ -1555,20 +1752,25 @@ static int AllocateInternalBuffers32b(VP8LDecoder* const dec, int final_width) {
       num_pixels + cache_top_pixels + cache_pixels;
 
   assert(dec->width_ <= final_width);
-  dec->pixels_ = (uint32_t*)WebPSafeMalloc(total_num_pixels, sizeof(uint32_t));
-  if (dec->pixels_ == NULL) {
+  if (dec->stats_ != NULL) {
+    dec->stats_->peak_memory += (size_t)total_num_pixels * sizeof(uint32_t);
+  }
+  if (!AllocatePixels(dec, total_num_pixels, sizeof(uint32_t))) {
     dec->argb_cache_ = NULL;    // for soundness
     return VP8LSetError(dec, VP8_STATUS_OUT_OF_MEMORY);
   }
   dec->argb_cache_ = dec->pixels_ + num_pixels + cache_top_pixels;
+  dec->window_start_ = 0;
+  dec->window_size_ = (image_pixels > window_pixels) ? (int)window_pixels : 0;
   return 1;
 }
 
 static int AllocateInternalBuffers8b(VP8LDecoder* const dec) {
   const uint64_t total_num_pixels = (uint64_t)dec->width_ * dec->height_;
   dec->argb_cache_ = NULL;    // for soundness
-  dec->pixels_ = (uint32_t*)WebPSafeMalloc(total_num_pixels, sizeof(uint8_t));
-  if (dec->pixels_ == NULL) {
+  dec->window_start_ = 0;
+  dec->window_size_ = 0;
+  if (!AllocatePixels(dec, total_num_pixels, sizeof(uint8_t))) {
     return VP8LSetError(dec, VP8_STATUS_OUT_OF_MEMORY);
   }
   return 1;
@@ -1580,7 +1782,8 @@ static int AllocateInternalBuffers8b(VP8LDecoder* const dec) {
 static void ExtractAlphaRows(VP8LDecoder* const dec, int last_row) {
   int cur_row = dec->last_row_;
   int num_rows = last_row - cur_row;
-  const uint32_t* in = dec->pixels_ + dec->width_ * cur_row;
+  const uint32_t* in =
+      dec->pixels_ + (dec->width_ * cur_row - dec->window_start_);
 
   assert(last_row <= dec->io_->crop_bottom);
   while (num_rows > 0) {
@@ -1725,6 +1928,7 @@ int VP8LDecodeImage(VP8LDecoder* const dec) {
   if (dec->state_ != READ_DATA) {
     dec->output_ = params->output;
     assert(dec->output_ != NULL);
+    dec->stats_ = params->stats;
 
     if (!WebPIoInitFromOptions(params->options, io, MODE_BGRA)) {
       VP8LSetError(dec, VP8_STATUS_INVALID_PARAM);
@@ -1764,10 +1968,15 @@ int VP8LDecodeImage(VP8LDecoder* const dec) {
   }
 
   // Decode.
+  if (dec->stats_ != NULL) WebPStopwatchReset(&dec->watch_);
   if (!DecodeImageData(dec, dec->pixels_, dec->width_, dec->height_,
                        io->crop_bottom, ProcessRows)) {
     goto Err;
   }
+  if (dec->stats_ != NULL) {
+    WebPDecStatsAddTime(dec->stats_, WEBP_DEC_STAGE_ENTROPY, &dec->watch_);
+    dec->stats_->transforms = dec->transforms_seen_;
+  }
 
   params->last_y = dec->last_out_row_;
   return 1;
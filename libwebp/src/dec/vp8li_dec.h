@@ -66,6 +66,13 @@ struct VP8LDecoder {
   uint32_t*        pixels_;        // Internal data: either uint8_t* for alpha
                                    // or uint32_t* for BGRA.
   uint32_t*        argb_cache_;    // Scratch buffer for temporary BGRA storage.
+  size_t           pixels_size_;   // allocated size of 'pixels_', in bytes.
+  // For large images, 'pixels_' only holds a sliding window of 'window_size_'
+  // pixels, covering the longest backward reference plus the rows not yet
+  // transformed. 'window_start_' is the image position of pixels_[0].
+  // 'window_size_' is 0 when the whole image is kept.
+  int              window_start_;
+  int              window_size_;
 
   VP8LBitReader    br_;
   int              incremental_;   // if true, incremental decoding is expected
@@ -80,6 +87,9 @@ struct VP8LDecoder {
                                    // color-converted yet.
   int              last_out_row_;  // last row output so far.
 
+  WebPDecStats*    stats_;         // if not NULL, filled with statistics
+  WebPStopwatch    watch_;         // start of the current stage, for 'stats_'
+
   VP8LMetadata     hdr_;
 
   int              next_transform_;
@@ -89,6 +99,11 @@ struct VP8LDecoder {
 
   uint8_t*         rescaler_memory;  // Working memory for rescaling work.
   WebPRescaler*    rescaler;         // Common rescaler for all channels.
+
+  // Largest Huffman table segment released so far, reused by the next
+  // ReadHuffmanCodesHelper() call that fits in it.
+  HuffmanCode*     huffman_spare_;
+  int              huffman_spare_size_;
 };
 
 //------------------------------------------------------------------------------
@@ -124,6 +139,10 @@ WEBP_NODISCARD int VP8LDecodeImage(VP8LDecoder* const dec);
 // Clears and deallocate a lossless decoder instance.
 void VP8LDelete(VP8LDecoder* const dec);
 
+// Resets the decoder in its initial state for a new picture, as VP8LNew()
+// would, but keeps the pixel buffer and the Huffman tables memory.
+void VP8LRecycle(VP8LDecoder* const dec);
+
 // Helper function for reading the different Huffman codes and storing them in
 // 'huffman_tables' and 'htree_groups'.
 // If mapping is NULL 'num_htree_groups_max' must equal 'num_htree_groups'.
@@ -17,6 +17,7 @@
 #include "src/dec/vp8i_dec.h"
 #include "src/dec/vp8li_dec.h"
 #include "src/dec/webpi_dec.h"
+#include "src/utils/thread_utils.h"
 #include "src/utils/utils.h"
 #include "src/webp/mux_types.h"  // ALPHA_FLAG
 #include "src/webp/decode.h"
@@ -447,13 +448,29 @@ void WebPResetDecParams(WebPDecParams* const params) {
 // "Into" decoding variants
 
 // Main flow
+// Returns the decoders to use, either new ones or the ones kept in 'ctx'.
+static VP8Decoder* GetVP8Decoder(WebPDecoderContext* const ctx) {
+  if (ctx == NULL) return VP8New();
+  if (ctx->vp8 == NULL) ctx->vp8 = VP8New();
+  return ctx->vp8;
+}
+
+static VP8LDecoder* GetVP8LDecoder(WebPDecoderContext* const ctx) {
+  if (ctx == NULL) return VP8LNew();
+  if (ctx->vp8l == NULL) ctx->vp8l = VP8LNew();
+  return ctx->vp8l;
+}
+
 WEBP_NODISCARD static VP8StatusCode DecodeInto(const uint8_t* const data,
                                                size_t data_size,
                                                WebPDecParams* const params) {
   VP8StatusCode status;
   VP8Io io;
   WebPHeaderStructure headers;
+  WebPDecStats* const stats = params->stats;
+  WebPStopwatch watch;
 
+  if (stats != NULL) WebPStopwatchReset(&watch);
   headers.data = data;
   headers.data_size = data_size;
   headers.have_all_data = 1;
@@ -461,6 +478,9 @@ WEBP_NODISCARD static VP8StatusCode DecodeInto(const uint8_t* const data,
   if (status != VP8_STATUS_OK) {
     return status;
   }
+  if (stats != NULL) {
+    stats->bytes_consumed = headers.offset + headers.compressed_size;
+  }
 
   assert(params != NULL);
   if (!VP8InitIo(&io)) {
@@ -471,17 +491,21 @@ WEBP_NODISCARD static VP8StatusCode DecodeInto(const uint8_t* const data,
   WebPInitCustomIo(params, &io);  // Plug the I/O functions.
 
   if (!headers.is_lossless) {
-    VP8Decoder* const dec = VP8New();
+    VP8Decoder* const dec = GetVP8Decoder(params->context);
     if (dec == NULL) {
       return VP8_STATUS_OUT_OF_MEMORY;
     }
     dec->alpha_data_ = headers.alpha_data;
     dec->alpha_data_size_ = headers.alpha_data_size;
+    dec->stats_ = stats;
 
     // Decode bitstream header, update io->width/io->height.
     if (!VP8GetHeaders(dec, &io)) {
       status = dec->status_;   // An error occurred. Grab error status.
     } else {
+      if (stats != NULL) {
+        WebPDecStatsAddTime(stats, WEBP_DEC_STAGE_HEADERS, &watch);
+      }
       // Allocate/check output buffers.
       status = WebPAllocateDecBuffer(io.width, io.height, params->options,
                                      params->output);
@@ -489,21 +513,35 @@ WEBP_NODISCARD static VP8StatusCode DecodeInto(const uint8_t* const data,
         // This change must be done before calling VP8Decode()
         dec->mt_method_ = VP8GetThreadMethod(params->options, &headers,
                                              io.width, io.height);
+#if defined(WEBP_USE_THREAD)
+        // The alpha plane can be decoded concurrently too. This is not done
+        // for incremental decoding, where 'alpha_data_' can be relocated.
+        dec->alpha_async_ = (dec->alpha_data_ != NULL &&
+                             params->options != NULL &&
+                             params->options->use_threads);
+#endif
         VP8InitDithering(params->options, dec);
         if (!VP8Decode(dec, &io)) {
           status = dec->status_;
         }
       }
     }
-    VP8Delete(dec);
+    if (params->context != NULL) {
+      VP8Recycle(dec);
+    } else {
+      VP8Delete(dec);
+    }
   } else {
-    VP8LDecoder* const dec = VP8LNew();
+    VP8LDecoder* const dec = GetVP8LDecoder(params->context);
     if (dec == NULL) {
       return VP8_STATUS_OUT_OF_MEMORY;
     }
     if (!VP8LDecodeHeader(dec, &io)) {
       status = dec->status_;   // An error occurred. Grab error status.
     } else {
+      if (stats != NULL) {
+        WebPDecStatsAddTime(stats, WEBP_DEC_STAGE_HEADERS, &watch);
+      }
       // Allocate/check output buffers.
       status = WebPAllocateDecBuffer(io.width, io.height, params->options,
                                      params->output);
@@ -513,7 +551,11 @@ WEBP_NODISCARD static VP8StatusCode DecodeInto(const uint8_t* const data,
         }
       }
     }
-    VP8LDelete(dec);
+    if (params->context != NULL) {
+      VP8LRecycle(dec);
+    } else {
+      VP8LDelete(dec);
+    }
   }
 
   if (status != VP8_STATUS_OK) {
@@ -759,14 +801,18 @@ VP8StatusCode WebPGetFeaturesInternal(const uint8_t* data, size_t data_size,
   return GetFeatures(data, data_size, features);
 }
 
-VP8StatusCode WebPDecode(const uint8_t* data, size_t data_size,
-                         WebPDecoderConfig* config) {
+static VP8StatusCode DecodeConfig(WebPDecoderContext* const context,
+                                  const uint8_t* data, size_t data_size,
+                                  WebPDecoderConfig* config) {
   WebPDecParams params;
   VP8StatusCode status;
 
   if (config == NULL) {
     return VP8_STATUS_INVALID_PARAM;
   }
+  if (config->options.stats != NULL) {
+    memset(config->options.stats, 0, sizeof(*config->options.stats));
+  }
 
   status = GetFeatures(data, data_size, &config->input);
   if (status != VP8_STATUS_OK) {
@@ -779,6 +825,8 @@ VP8StatusCode WebPDecode(const uint8_t* data, size_t data_size,
   WebPResetDecParams(&params);
   params.options = &config->options;
   params.output = &config->output;
+  params.context = context;
+  params.stats = config->options.stats;
   if (WebPAvoidSlowMemory(params.output, &config->input)) {
     // decoding to slow memory: use a temporary in-mem buffer to decode into.
     WebPDecBuffer in_mem_buffer;
@@ -801,6 +849,173 @@ VP8StatusCode WebPDecode(const uint8_t* data, size_t data_size,
   return status;
 }
 
+VP8StatusCode WebPDecode(const uint8_t* data, size_t data_size,
+                         WebPDecoderConfig* config) {
+  return DecodeConfig(NULL, data, data_size, config);
+}
+
+//------------------------------------------------------------------------------
+// Reusable decoding context
+
+WebPDecoderContext* WebPDecoderContextNew(void) {
+  return (WebPDecoderContext*)WebPSafeCalloc(1ULL,
+                                             sizeof(WebPDecoderContext));
+}
+
+VP8StatusCode WebPDecodeWithContext(WebPDecoderContext* context,
+                                    const uint8_t* data, size_t data_size,
+                                    WebPDecoderConfig* config) {
+  if (context == NULL) return VP8_STATUS_INVALID_PARAM;
+  return DecodeConfig(context, data, data_size, config);
+}
+
+void WebPDecoderContextReset(WebPDecoderContext* context) {
+  if (context == NULL) return;
+  VP8Delete(context->vp8);
+  VP8LDelete(context->vp8l);
+  WebPSafeFree(context->scratch);
+  memset(context, 0, sizeof(*context));
+}
+
+void WebPDecoderContextDelete(WebPDecoderContext* context) {
+  WebPDecoderContextReset(context);
+  WebPSafeFree(context);
+}
+
+//------------------------------------------------------------------------------
+// Batch decoding
+
+#define BATCH_DEFAULT_NUM_THREADS 4
+#define BATCH_MAX_NUM_THREADS 64
+
+// Decoding thread of a batch. It claims the jobs of the current group one at
+// a time from the shared 'next_job' counter until 'last' is reached, so that
+// a few large pictures don't leave the other threads idle.
+typedef struct {
+  WebPWorker worker;
+  WebPDecoderContext context;
+  WebPDecodeJob* jobs;
+  WebPSharedCounter* next_job;
+  int last;
+} BatchThread;
+
+static int BatchThreadHook(void* arg1, void* arg2) {
+  BatchThread* const thread = (BatchThread*)arg1;
+  (void)arg2;
+  while (1) {
+    const int i = WebPSharedCounterNext(thread->next_job);
+    WebPDecodeJob* job;
+    if (i >= thread->last) break;
+    job = &thread->jobs[i];
+    job->status = DecodeConfig(&thread->context, job->data, job->data_size,
+                               job->config);
+  }
+  return 1;
+}
+
+int WebPDecodeBatchOptionsInitInternal(WebPDecodeBatchOptions* options,
+                                       int version) {
+  if (WEBP_ABI_IS_INCOMPATIBLE(version, WEBP_DECODER_ABI_VERSION)) {
+    return 0;   // version mismatch
+  }
+  if (options == NULL) return 0;
+  memset(options, 0, sizeof(*options));
+  return 1;
+}
+
+VP8StatusCode WebPDecodeBatch(WebPDecodeJob* jobs, int num_jobs,
+                              const WebPDecodeBatchOptions* options) {
+  const WebPWorkerInterface* const worker_interface =
+      WebPGetWorkerInterface();
+  VP8StatusCode status = VP8_STATUS_OK;
+  int num_threads = BATCH_DEFAULT_NUM_THREADS;
+  int group_size = num_jobs;
+  WebPSharedCounter next_job;
+  BatchThread* threads;
+  int first, i;
+
+  if (num_jobs < 0 || (jobs == NULL && num_jobs > 0)) {
+    return VP8_STATUS_INVALID_PARAM;
+  }
+  if (options != NULL) {
+    if (options->num_threads < 0 || options->max_in_flight < 0) {
+      return VP8_STATUS_INVALID_PARAM;
+    }
+    if (options->num_threads > 0) num_threads = options->num_threads;
+    if (options->max_in_flight > 0 && options->max_in_flight < num_jobs) {
+      group_size = options->max_in_flight;
+    }
+  }
+  if (num_jobs == 0) return VP8_STATUS_OK;
+  if (num_threads > group_size) num_threads = group_size;
+  if (num_threads > BATCH_MAX_NUM_THREADS) {
+    num_threads = BATCH_MAX_NUM_THREADS;
+  }
+
+  if (!WebPSharedCounterInit(&next_job, 0)) return VP8_STATUS_OUT_OF_MEMORY;
+  threads = (BatchThread*)WebPSafeCalloc((uint64_t)num_threads,
+                                         sizeof(*threads));
+  if (threads == NULL) {
+    WebPSharedCounterClear(&next_job);
+    return VP8_STATUS_OUT_OF_MEMORY;
+  }
+  for (i = 0; i < num_threads; ++i) {
+    worker_interface->Init(&threads[i].worker);
+    threads[i].worker.hook = BatchThreadHook;
+    threads[i].worker.data1 = &threads[i];
+    threads[i].worker.data2 = NULL;
+    threads[i].jobs = jobs;
+    threads[i].next_job = &next_job;
+  }
+  // The first thread is the calling one. If a side thread can't be started,
+  // its jobs are decoded there as well.
+  for (i = 1; i < num_threads; ++i) {
+    if (!worker_interface->Reset(&threads[i].worker)) {
+      num_threads = i;
+      break;
+    }
+  }
+
+  for (first = 0; first < num_jobs; first += group_size) {
+    const int last =
+        (num_jobs - first < group_size) ? num_jobs : first + group_size;
+    next_job.value = first;   // no thread is running at this point
+    for (i = 0; i < num_threads; ++i) threads[i].last = last;
+    for (i = 1; i < num_threads; ++i) {
+      worker_interface->Launch(&threads[i].worker);
+    }
+    worker_interface->Execute(&threads[0].worker);
+    for (i = 1; i < num_threads; ++i) {
+      (void)worker_interface->Sync(&threads[i].worker);
+    }
+    if (options != NULL && options->hook != NULL) {
+      for (i = first; i < last; ++i) {
+        if (!options->hook(&jobs[i], options->user_data)) {
+          status = VP8_STATUS_USER_ABORT;
+          break;
+        }
+      }
+      if (status != VP8_STATUS_OK) break;
+    }
+  }
+  if (status != VP8_STATUS_OK) {
+    for (i = first + group_size; i < num_jobs; ++i) {
+      jobs[i].status = VP8_STATUS_USER_ABORT;
+    }
+  }
+
+  for (i = 0; i < num_threads; ++i) {
+    worker_interface->End(&threads[i].worker);
+    WebPDecoderContextReset(&threads[i].context);
+  }
+  WebPSafeFree(threads);
+  WebPSharedCounterClear(&next_job);
+  return status;
+}
+
+#undef BATCH_MAX_NUM_THREADS
+#undef BATCH_DEFAULT_NUM_THREADS
+
 //------------------------------------------------------------------------------
 // Cropping and rescaling.
 
@@ -19,6 +19,7 @@ extern "C" {
 #endif
 
 #include "src/utils/rescaler_utils.h"
+#include "src/utils/stopwatch_utils.h"
 #include "src/dec/vp8_dec.h"
 #include "src/webp/decode.h"
 
@@ -46,11 +47,30 @@ struct WebPDecParams {
   OutputFunc emit;               // output RGB or YUV samples
   OutputAlphaFunc emit_alpha;    // output alpha channel
   OutputRowFunc emit_alpha_row;  // output one line of rescaled alpha values
+
+  WebPDecoderContext* context;   // if not NULL, provides reusable resources
+  WebPDecStats* stats;           // if not NULL, filled with statistics
+};
+
+// Resources kept from one WebPDecodeWithContext() call to the next.
+struct WebPDecoderContext {
+  VP8Decoder* vp8;               // lossy decoder, created on first use
+  struct VP8LDecoder* vp8l;      // lossless decoder, created on first use
+  void* scratch;                 // output scratch memory ('memory' above)
+  size_t scratch_size;
 };
 
 // Should be called first, before any use of the WebPDecParams object.
 void WebPResetDecParams(WebPDecParams* const params);
 
+// Adds the time elapsed since the last reset of 'watch' to the 'stage'
+// timings of 'stats', and restarts 'watch'.
+static WEBP_INLINE void WebPDecStatsAddTime(WebPDecStats* const stats,
+                                            WEBP_DEC_STAGE stage,
+                                            WebPStopwatch* const watch) {
+  WebPStopwatchAdd(watch, &stats->wall_time[stage], &stats->cpu_time[stage]);
+}
+
 //------------------------------------------------------------------------------
 // Header parsing helpers
 
@@ -82,6 +102,12 @@ VP8StatusCode WebPParseHeaders(WebPHeaderStructure* const headers);
 int WebPCheckCropDimensions(int image_width, int image_height,
                             int x, int y, int w, int h);
 
+// Writes 'len' pairs of samples from 'src0' and 'src1' into 'dst', interleaved
+// as in a semi-planar (NV12 / NV21) chroma row: dst[2 * i] = src0[i] and
+// dst[2 * i + 1] = src1[i].
+void WebPInterleaveUV(const uint8_t* src0, const uint8_t* src1,
+                      uint8_t* dst, int len);
+
 // Initializes VP8Io with custom setup, io and teardown functions. The default
 // hooks will use the supplied 'params' as io->opaque handle.
 void WebPInitCustomIo(WebPDecParams* const params, VP8Io* const io);
@@ -17,6 +17,7 @@
 #include <assert.h>
 #include <string.h>
 
+#include "src/dsp/dsp.h"
 #include "src/utils/utils.h"
 #include "src/webp/decode.h"
 #include "src/webp/demux.h"
@@ -24,34 +25,24 @@
 
 #define NUM_CHANNELS 4
 
-// Channel extraction from a uint32_t representation of a uint8_t RGBA/BGRA
-// buffer.
-#ifdef WORDS_BIGENDIAN
-#define CHANNEL_SHIFT(i) (24 - (i) * 8)
-#else
-#define CHANNEL_SHIFT(i) ((i) * 8)
-#endif
-
-typedef void (*BlendRowFunc)(uint32_t* const, const uint32_t* const, int);
-static void BlendPixelRowNonPremult(uint32_t* const src,
-                                    const uint32_t* const dst, int num_pixels);
-static void BlendPixelRowPremult(uint32_t* const src, const uint32_t* const dst,
-                                 int num_pixels);
-
 struct WebPAnimDecoder {
   WebPDemuxer* demux_;             // Demuxer created from given WebP bitstream.
   WebPDecoderConfig config_;       // Decoder config.
-  // Note: we use a pointer to a function blending multiple pixels at a time to
-  // allow possible inlining of per-pixel blending function.
-  BlendRowFunc blend_func_;        // Pointer to the chose blend row function.
+  // Note: we use a pointer to a function blending multiple pixels at a time,
+  // as provided by the DSP layer (WebPInitAlphaProcessing()).
+  WebPBlendRowFunc blend_func_;    // Pointer to the chosen blend row function.
   WebPAnimInfo info_;              // Global info about the animation.
   uint8_t* curr_frame_;            // Current canvas (not disposed).
-  uint8_t* prev_frame_disposed_;   // Previous canvas (properly disposed).
+  uint8_t* prev_frame_disposed_;   // Pixels of the previous canvas (properly
+                                   // disposed) under the current frame, when
+                                   // they are needed for blending.
   int prev_frame_timestamp_;       // Previous frame timestamp (milliseconds).
   WebPIterator prev_iter_;         // Iterator object for previous frame.
   int prev_frame_was_keyframe_;    // True if previous frame was a keyframe.
   int next_frame_;                 // Index of the next frame to be decoded
                                    // (starting from 1).
+  WebPAnimRect dirty_rect_;        // Area of curr_frame_ changed by the last
+                                   // call to WebPAnimDecoderGetNext().
 };
 
 static void DefaultDecoderOptions(WebPAnimDecoderOptions* const dec_options) {
@@ -81,9 +72,8 @@ WEBP_NODISCARD static int ApplyDecoderOptions(
       mode != MODE_rgbA && mode != MODE_bgrA) {
     return 0;
   }
-  dec->blend_func_ = (mode == MODE_RGBA || mode == MODE_BGRA)
-                         ? &BlendPixelRowNonPremult
-                         : &BlendPixelRowPremult;
+  dec->blend_func_ =
+      WebPGetBlendRowFunc(!(mode == MODE_RGBA || mode == MODE_BGRA));
   if (!WebPInitDecoderConfig(config)) {
     return 0;
   }
@@ -182,14 +172,41 @@ static void ZeroFillFrameRect(uint8_t* buf, int buf_stride, int x_offset,
   }
 }
 
-// Copy width * height pixels from 'src' to 'dst'.
-WEBP_NODISCARD static int CopyCanvas(const uint8_t* src, uint8_t* dst,
-                                     uint32_t width, uint32_t height) {
-  const uint64_t size = (uint64_t)width * height * NUM_CHANNELS;
-  if (!CheckSizeOverflow(size)) return 0;
-  assert(src != NULL && dst != NULL);
-  memcpy(dst, src, (size_t)size);
-  return 1;
+// Copy the given frame rectangle from 'src' to 'dst'.
+static void CopyFrameRect(const uint8_t* src, uint8_t* dst, int buf_stride,
+                          int x_offset, int y_offset, int width, int height) {
+  const size_t offset =
+      (size_t)y_offset * buf_stride + (size_t)x_offset * NUM_CHANNELS;
+  int j;
+  assert(width * NUM_CHANNELS <= buf_stride);
+  src += offset;
+  dst += offset;
+  for (j = 0; j < height; ++j) {
+    memcpy(dst, src, width * NUM_CHANNELS);
+    src += buf_stride;
+    dst += buf_stride;
+  }
+}
+
+// Sets 'rect' to the bounding box of 'rect' and the given frame rectangle.
+static void UnionRect(WebPAnimRect* const rect, int x_offset, int y_offset,
+                      int width, int height) {
+  if (rect->width == 0 || rect->height == 0) {
+    rect->x_offset = x_offset;
+    rect->y_offset = y_offset;
+    rect->width = width;
+    rect->height = height;
+  } else {
+    const int x_end = rect->x_offset + rect->width;
+    const int y_end = rect->y_offset + rect->height;
+    const int new_x_end = (x_offset + width > x_end) ? x_offset + width : x_end;
+    const int new_y_end =
+        (y_offset + height > y_end) ? y_offset + height : y_end;
+    if (x_offset < rect->x_offset) rect->x_offset = x_offset;
+    if (y_offset < rect->y_offset) rect->y_offset = y_offset;
+    rect->width = new_x_end - rect->x_offset;
+    rect->height = new_y_end - rect->y_offset;
+  }
 }
 
 // Returns true if the current frame is a key-frame.
@@ -212,87 +229,6 @@ static int IsKeyFrame(const WebPIterator* const curr,
 }
 
 
-// Blend a single channel of 'src' over 'dst', given their alpha channel values.
-// 'src' and 'dst' are assumed to be NOT pre-multiplied by alpha.
-static uint8_t BlendChannelNonPremult(uint32_t src, uint8_t src_a,
-                                      uint32_t dst, uint8_t dst_a,
-                                      uint32_t scale, int shift) {
-  const uint8_t src_channel = (src >> shift) & 0xff;
-  const uint8_t dst_channel = (dst >> shift) & 0xff;
-  const uint32_t blend_unscaled = src_channel * src_a + dst_channel * dst_a;
-  assert(blend_unscaled < (1ULL << 32) / scale);
-  return (blend_unscaled * scale) >> CHANNEL_SHIFT(3);
-}
-
-// Blend 'src' over 'dst' assuming they are NOT pre-multiplied by alpha.
-static uint32_t BlendPixelNonPremult(uint32_t src, uint32_t dst) {
-  const uint8_t src_a = (src >> CHANNEL_SHIFT(3)) & 0xff;
-
-  if (src_a == 0) {
-    return dst;
-  } else {
-    const uint8_t dst_a = (dst >> CHANNEL_SHIFT(3)) & 0xff;
-    // This is the approximate integer arithmetic for the actual formula:
-    // dst_factor_a = (dst_a * (255 - src_a)) / 255.
-    const uint8_t dst_factor_a = (dst_a * (256 - src_a)) >> 8;
-    const uint8_t blend_a = src_a + dst_factor_a;
-    const uint32_t scale = (1UL << 24) / blend_a;
-
-    const uint8_t blend_r = BlendChannelNonPremult(
-        src, src_a, dst, dst_factor_a, scale, CHANNEL_SHIFT(0));
-    const uint8_t blend_g = BlendChannelNonPremult(
-        src, src_a, dst, dst_factor_a, scale, CHANNEL_SHIFT(1));
-    const uint8_t blend_b = BlendChannelNonPremult(
-        src, src_a, dst, dst_factor_a, scale, CHANNEL_SHIFT(2));
-    assert(src_a + dst_factor_a < 256);
-
-    return ((uint32_t)blend_r << CHANNEL_SHIFT(0)) |
-           ((uint32_t)blend_g << CHANNEL_SHIFT(1)) |
-           ((uint32_t)blend_b << CHANNEL_SHIFT(2)) |
-           ((uint32_t)blend_a << CHANNEL_SHIFT(3));
-  }
-}
-
-// Blend 'num_pixels' in 'src' over 'dst' assuming they are NOT pre-multiplied
-// by alpha.
-static void BlendPixelRowNonPremult(uint32_t* const src,
-                                    const uint32_t* const dst, int num_pixels) {
-  int i;
-  for (i = 0; i < num_pixels; ++i) {
-    const uint8_t src_alpha = (src[i] >> CHANNEL_SHIFT(3)) & 0xff;
-    if (src_alpha != 0xff) {
-      src[i] = BlendPixelNonPremult(src[i], dst[i]);
-    }
-  }
-}
-
-// Individually multiply each channel in 'pix' by 'scale'.
-static WEBP_INLINE uint32_t ChannelwiseMultiply(uint32_t pix, uint32_t scale) {
-  uint32_t mask = 0x00FF00FF;
-  uint32_t rb = ((pix & mask) * scale) >> 8;
-  uint32_t ag = ((pix >> 8) & mask) * scale;
-  return (rb & mask) | (ag & ~mask);
-}
-
-// Blend 'src' over 'dst' assuming they are pre-multiplied by alpha.
-static uint32_t BlendPixelPremult(uint32_t src, uint32_t dst) {
-  const uint8_t src_a = (src >> CHANNEL_SHIFT(3)) & 0xff;
-  return src + ChannelwiseMultiply(dst, 256 - src_a);
-}
-
-// Blend 'num_pixels' in 'src' over 'dst' assuming they are pre-multiplied by
-// alpha.
-static void BlendPixelRowPremult(uint32_t* const src, const uint32_t* const dst,
-                                 int num_pixels) {
-  int i;
-  for (i = 0; i < num_pixels; ++i) {
-    const uint8_t src_alpha = (src[i] >> CHANNEL_SHIFT(3)) & 0xff;
-    if (src_alpha != 0xff) {
-      src[i] = BlendPixelPremult(src[i], dst[i]);
-    }
-  }
-}
-
 // Returns two ranges (<left, width> pairs) at row 'canvas_y', that belong to
 // 'src' but not 'dst'. A point range is empty if the corresponding width is 0.
 static void FindBlendRangeAtRow(const WebPIterator* const src,
@@ -332,8 +268,10 @@ int WebPAnimDecoderGetNext(WebPAnimDecoder* dec,
   uint32_t width;
   uint32_t height;
   int is_key_frame;
+  int need_blend;
   int timestamp;
-  BlendRowFunc blend_row;
+  WebPBlendRowFunc blend_row;
+  WebPAnimRect dirty_rect;
 
   if (dec == NULL || buf_ptr == NULL || timestamp_ptr == NULL) return 0;
   if (!WebPAnimDecoderHasMoreFrames(dec)) return 0;
@@ -348,19 +286,43 @@ int WebPAnimDecoderGetNext(WebPAnimDecoder* dec,
   }
   timestamp = dec->prev_frame_timestamp_ + iter.duration;
 
-  // Initialize.
+  // Initialize. 'curr_frame_' still holds the previous canvas: only the areas
+  // of the previous and current frames need to be updated, instead of copying
+  // the whole canvas from a disposed version of it.
   is_key_frame = IsKeyFrame(&iter, &dec->prev_iter_,
                             dec->prev_frame_was_keyframe_, width, height);
-  if (is_key_frame) {
-    if (!ZeroFillCanvas(dec->curr_frame_, width, height)) {
+  need_blend = (iter.frame_num > 1 && iter.blend_method == WEBP_MUX_BLEND &&
+                !is_key_frame);
+  memset(&dirty_rect, 0, sizeof(dirty_rect));
+  if (iter.frame_num == 1) {
+    // The canvas content is undefined.
+    if (!IsFullFrame(iter.width, iter.height, width, height) &&
+        !ZeroFillCanvas(dec->curr_frame_, width, height)) {
       goto Error;
     }
-  } else {
-    if (!CopyCanvas(dec->prev_frame_disposed_, dec->curr_frame_,
-                    width, height)) {
-      goto Error;
+    UnionRect(&dirty_rect, 0, 0, width, height);
+  } else if (!is_key_frame ||
+             !IsFullFrame(iter.width, iter.height, width, height)) {
+    // Dispose the previous frame. For a key-frame, this clears the canvas:
+    // either the disposed previous frame covered it, or the previous frame was
+    // a key-frame, with transparent pixels outside of its rectangle.
+    if (dec->prev_iter_.dispose_method == WEBP_MUX_DISPOSE_BACKGROUND) {
+      ZeroFillFrameRect(dec->curr_frame_, width * NUM_CHANNELS,
+                        dec->prev_iter_.x_offset, dec->prev_iter_.y_offset,
+                        dec->prev_iter_.width, dec->prev_iter_.height);
+      UnionRect(&dirty_rect, dec->prev_iter_.x_offset,
+                dec->prev_iter_.y_offset, dec->prev_iter_.width,
+                dec->prev_iter_.height);
+    }
+    // Save the disposed pixels that are about to be overwritten.
+    if (need_blend) {
+      CopyFrameRect(dec->curr_frame_, dec->prev_frame_disposed_,
+                    width * NUM_CHANNELS, iter.x_offset, iter.y_offset,
+                    iter.width, iter.height);
     }
   }
+  UnionRect(&dirty_rect, iter.x_offset, iter.y_offset, iter.width,
+            iter.height);
 
   // Decode.
   {
@@ -386,8 +348,7 @@ int WebPAnimDecoderGetNext(WebPAnimDecoder* dec,
   // transparent (i.e. alpha < 255). However, the value of each of these
   // pixels should have been determined by blending it against the value of
   // that pixel in the previous frame if blending method of is WEBP_MUX_BLEND.
-  if (iter.frame_num > 1 && iter.blend_method == WEBP_MUX_BLEND &&
-      !is_key_frame) {
+  if (need_blend) {
     if (dec->prev_iter_.dispose_method == WEBP_MUX_DISPOSE_NONE) {
       int y;
       // Blend transparent pixels with pixels in previous canvas.
@@ -428,14 +389,7 @@ int WebPAnimDecoderGetNext(WebPAnimDecoder* dec,
   WebPDemuxReleaseIterator(&dec->prev_iter_);
   dec->prev_iter_ = iter;
   dec->prev_frame_was_keyframe_ = is_key_frame;
-  if (!CopyCanvas(dec->curr_frame_, dec->prev_frame_disposed_, width, height)) {
-    goto Error;
-  }
-  if (dec->prev_iter_.dispose_method == WEBP_MUX_DISPOSE_BACKGROUND) {
-    ZeroFillFrameRect(dec->prev_frame_disposed_, width * NUM_CHANNELS,
-                      dec->prev_iter_.x_offset, dec->prev_iter_.y_offset,
-                      dec->prev_iter_.width, dec->prev_iter_.height);
-  }
+  dec->dirty_rect_ = dirty_rect;
   ++dec->next_frame_;
 
   // All OK, fill in the values.
@@ -460,9 +414,17 @@ void WebPAnimDecoderReset(WebPAnimDecoder* dec) {
     memset(&dec->prev_iter_, 0, sizeof(dec->prev_iter_));
     dec->prev_frame_was_keyframe_ = 0;
     dec->next_frame_ = 1;
+    memset(&dec->dirty_rect_, 0, sizeof(dec->dirty_rect_));
   }
 }
 
+int WebPAnimDecoderGetDirtyRect(const WebPAnimDecoder* dec,
+                                WebPAnimRect* rect) {
+  if (dec == NULL || rect == NULL) return 0;
+  *rect = dec->dirty_rect_;
+  return (rect->width > 0 && rect->height > 0);
+}
+
 const WebPDemuxer* WebPAnimDecoderGetDemuxer(const WebPAnimDecoder* dec) {
   if (dec == NULL) return NULL;
   return dec->demux_;
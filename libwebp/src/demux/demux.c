@@ -58,6 +58,14 @@ typedef struct Chunk {
   struct Chunk* next_;
 } Chunk;
 
+// All the chunks sharing the same fourcc, in order.
+typedef struct {
+  uint8_t fourcc_[TAG_SIZE];
+  int num_chunks_;
+  int max_chunks_;
+  const Chunk** chunks_;
+} ChunkType;
+
 struct WebPDemuxer {
   MemBuffer mem_;
   WebPDemuxState state_;
@@ -69,8 +77,13 @@ struct WebPDemuxer {
   int num_frames_;
   Frame* frames_;
   Frame** frames_tail_;
+  Frame** frame_index_;  // frames_ as an array, indexed by frame_num - 1
+  int max_frames_;       // allocated size of frame_index_
   Chunk* chunks_;  // non-image chunks
   Chunk** chunks_tail_;
+  ChunkType* chunk_types_;  // chunks_, grouped by fourcc
+  int num_chunk_types_;
+  int max_chunk_types_;
 };
 
 typedef enum {
@@ -174,17 +187,72 @@ static WEBP_INLINE uint32_t ReadLE32(MemBuffer* const mem) {
 // -----------------------------------------------------------------------------
 // Secondary chunk parsing
 
-static void AddChunk(WebPDemuxer* const dmux, Chunk* const chunk) {
+// Makes sure '*array' can hold at least 'num' elements of 'elem_size' bytes,
+// '*max' being its current capacity. Returns false in case of memory error.
+static int GrowArray(void** const array, int* const max, int num,
+                     size_t elem_size) {
+  if (num > *max) {
+    const int new_max = (*max > 0) ? 2 * *max : 4;
+    void* const new_array = WebPSafeMalloc(new_max, elem_size);
+    if (new_array == NULL) return 0;
+    if (*max > 0) memcpy(new_array, *array, *max * elem_size);
+    WebPSafeFree(*array);
+    *array = new_array;
+    *max = new_max;
+  }
+  return 1;
+}
+
+// Returns the chunks with the given fourcc, or NULL if there are none.
+static const ChunkType* FindChunkType(const WebPDemuxer* const dmux,
+                                      const char fourcc[4]) {
+  int i;
+  for (i = 0; i < dmux->num_chunk_types_; ++i) {
+    const ChunkType* const type = &dmux->chunk_types_[i];
+    if (!memcmp(type->fourcc_, fourcc, TAG_SIZE)) return type;
+  }
+  return NULL;
+}
+
+// Returns true on success, false otherwise.
+static int AddChunk(WebPDemuxer* const dmux, Chunk* const chunk) {
+  const char* const fourcc =
+      (const char*)dmux->mem_.buf_ + chunk->data_.offset_;
+  ChunkType* type = (ChunkType*)FindChunkType(dmux, fourcc);
+  if (type == NULL) {
+    if (!GrowArray((void**)&dmux->chunk_types_, &dmux->max_chunk_types_,
+                   dmux->num_chunk_types_ + 1, sizeof(*type))) {
+      return 0;
+    }
+    type = &dmux->chunk_types_[dmux->num_chunk_types_++];
+    memcpy(type->fourcc_, fourcc, TAG_SIZE);
+    type->num_chunks_ = 0;
+    type->max_chunks_ = 0;
+    type->chunks_ = NULL;
+  }
+  if (!GrowArray((void**)&type->chunks_, &type->max_chunks_,
+                 type->num_chunks_ + 1, sizeof(*type->chunks_))) {
+    return 0;
+  }
+  type->chunks_[type->num_chunks_++] = chunk;
+
   *dmux->chunks_tail_ = chunk;
   chunk->next_ = NULL;
   dmux->chunks_tail_ = &chunk->next_;
+  return 1;
 }
 
-// Add a frame to the end of the list, ensuring the last frame is complete.
+// Add a frame to the end of the list, ensuring the last frame is complete,
+// and update the frame count.
 // Returns true on success, false otherwise.
 static int AddFrame(WebPDemuxer* const dmux, Frame* const frame) {
   const Frame* const last_frame = *dmux->frames_tail_;
   if (last_frame != NULL && !last_frame->complete_) return 0;
+  if (!GrowArray((void**)&dmux->frame_index_, &dmux->max_frames_,
+                 dmux->num_frames_ + 1, sizeof(*dmux->frame_index_))) {
+    return 0;
+  }
+  dmux->frame_index_[dmux->num_frames_++] = frame;
 
   *dmux->frames_tail_ = frame;
   frame->next_ = NULL;
@@ -344,11 +412,7 @@ static ParseStatus ParseAnimationFrame(
   }
   if (status != PARSE_ERROR && is_animation && frame->frame_num_ > 0) {
     added_frame = AddFrame(dmux, frame);
-    if (added_frame) {
-      ++dmux->num_frames_;
-    } else {
-      status = PARSE_ERROR;
-    }
+    if (!added_frame) status = PARSE_ERROR;
   }
 
   if (!added_frame) WebPSafeFree(frame);
@@ -366,7 +430,10 @@ static int StoreChunk(WebPDemuxer* const dmux,
 
   chunk->data_.offset_ = start_offset;
   chunk->data_.size_ = size;
-  AddChunk(dmux, chunk);
+  if (!AddChunk(dmux, chunk)) {
+    WebPSafeFree(chunk);
+    return 0;
+  }
   return 1;
 }
 
@@ -436,7 +503,6 @@ static ParseStatus ParseSingleImage(WebPDemuxer* const dmux) {
       status = PARSE_ERROR;  // last frame was left incomplete
     } else {
       image_added = 1;
-      dmux->num_frames_ = 1;
     }
   }
 
@@ -690,7 +756,7 @@ static ParseStatus CreateRawImageDemuxer(MemBuffer* const mem,
     dmux->canvas_width_ = frame->width_;
     dmux->canvas_height_ = frame->height_;
     dmux->feature_flags_ |= frame->has_alpha_ ? ALPHA_FLAG : 0;
-    dmux->num_frames_ = 1;
+    assert(dmux->num_frames_ == 1);
     assert(IsValidSimpleFormat(dmux));
     *demuxer = dmux;
     return PARSE_OK;
@@ -764,6 +830,7 @@ WebPDemuxer* WebPDemuxInternal(const WebPData* data, int allow_partial,
 void WebPDemuxDelete(WebPDemuxer* dmux) {
   Chunk* c;
   Frame* f;
+  int i;
   if (dmux == NULL) return;
 
   for (f = dmux->frames_; f != NULL;) {
@@ -776,6 +843,11 @@ void WebPDemuxDelete(WebPDemuxer* dmux) {
     c = c->next_;
     WebPSafeFree(cur_chunk);
   }
+  for (i = 0; i < dmux->num_chunk_types_; ++i) {
+    WebPSafeFree((void*)dmux->chunk_types_[i].chunks_);
+  }
+  WebPSafeFree(dmux->chunk_types_);
+  WebPSafeFree(dmux->frame_index_);
   WebPSafeFree(dmux);
 }
 
@@ -800,9 +872,9 @@ uint32_t WebPDemuxGetI(const WebPDemuxer* dmux, WebPFormatFeature feature) {
 
 static const Frame* GetFrame(const WebPDemuxer* const dmux, int frame_num) {
   const Frame* f;
-  for (f = dmux->frames_; f != NULL; f = f->next_) {
-    if (frame_num == f->frame_num_) break;
-  }
+  if (frame_num < 1 || frame_num > dmux->num_frames_) return NULL;
+  f = dmux->frame_index_[frame_num - 1];
+  assert(f->frame_num_ == frame_num);
   return f;
 }
 
@@ -895,43 +967,21 @@ void WebPDemuxReleaseIterator(WebPIterator* iter) {
 // -----------------------------------------------------------------------------
 // Chunk iteration
 
-static int ChunkCount(const WebPDemuxer* const dmux, const char fourcc[4]) {
-  const uint8_t* const mem_buf = dmux->mem_.buf_;
-  const Chunk* c;
-  int count = 0;
-  for (c = dmux->chunks_; c != NULL; c = c->next_) {
-    const uint8_t* const header = mem_buf + c->data_.offset_;
-    if (!memcmp(header, fourcc, TAG_SIZE)) ++count;
-  }
-  return count;
-}
-
-static const Chunk* GetChunk(const WebPDemuxer* const dmux,
-                             const char fourcc[4], int chunk_num) {
-  const uint8_t* const mem_buf = dmux->mem_.buf_;
-  const Chunk* c;
-  int count = 0;
-  for (c = dmux->chunks_; c != NULL; c = c->next_) {
-    const uint8_t* const header = mem_buf + c->data_.offset_;
-    if (!memcmp(header, fourcc, TAG_SIZE)) ++count;
-    if (count == chunk_num) break;
-  }
-  return c;
-}
-
 static int SetChunk(const char fourcc[4], int chunk_num,
                     WebPChunkIterator* const iter) {
   const WebPDemuxer* const dmux = (WebPDemuxer*)iter->private_;
+  const ChunkType* type;
   int count;
 
   if (dmux == NULL || fourcc == NULL || chunk_num < 0) return 0;
-  count = ChunkCount(dmux, fourcc);
+  type = FindChunkType(dmux, fourcc);
+  count = (type != NULL) ? type->num_chunks_ : 0;
   if (count == 0) return 0;
   if (chunk_num == 0) chunk_num = count;
 
   if (chunk_num <= count) {
     const uint8_t* const mem_buf = dmux->mem_.buf_;
-    const Chunk* const chunk = GetChunk(dmux, fourcc, chunk_num);
+    const Chunk* const chunk = type->chunks_[chunk_num - 1];
     iter->chunk.bytes = mem_buf + chunk->data_.offset_ + CHUNK_HEADER_SIZE;
     iter->chunk.size  = chunk->data_.size_ - CHUNK_HEADER_SIZE;
     iter->num_chunks  = count;
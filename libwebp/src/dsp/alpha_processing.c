@@ -368,6 +368,96 @@ static void AlphaReplace_C(uint32_t* src, int length, uint32_t color) {
   for (x = 0; x < length; ++x) if ((src[x] >> 24) == 0) src[x] = color;
 }
 
+//------------------------------------------------------------------------------
+// Blending of rgba/bgra rows, used for animation compositing.
+
+// Channel extraction from a uint32_t representation of a uint8_t RGBA/BGRA
+// buffer.
+#ifdef WORDS_BIGENDIAN
+#define CHANNEL_SHIFT(i) (24 - (i) * 8)
+#else
+#define CHANNEL_SHIFT(i) ((i) * 8)
+#endif
+
+// Blend a single channel of 'src' over 'dst', given their alpha channel values.
+// 'src' and 'dst' are assumed to be NOT pre-multiplied by alpha.
+static uint8_t BlendChannelNonPremult(uint32_t src, uint8_t src_a,
+                                      uint32_t dst, uint8_t dst_a,
+                                      uint32_t scale, int shift) {
+  const uint8_t src_channel = (src >> shift) & 0xff;
+  const uint8_t dst_channel = (dst >> shift) & 0xff;
+  const uint32_t blend_unscaled = src_channel * src_a + dst_channel * dst_a;
+  assert(blend_unscaled < (1ULL << 32) / scale);
+  return (blend_unscaled * scale) >> CHANNEL_SHIFT(3);
+}
+
+// Blend 'src' over 'dst' assuming they are NOT pre-multiplied by alpha.
+static uint32_t BlendPixelNonPremult(uint32_t src, uint32_t dst) {
+  const uint8_t src_a = (src >> CHANNEL_SHIFT(3)) & 0xff;
+
+  if (src_a == 0) {
+    return dst;
+  } else {
+    const uint8_t dst_a = (dst >> CHANNEL_SHIFT(3)) & 0xff;
+    // This is the approximate integer arithmetic for the actual formula:
+    // dst_factor_a = (dst_a * (255 - src_a)) / 255.
+    const uint8_t dst_factor_a = (dst_a * (256 - src_a)) >> 8;
+    const uint8_t blend_a = src_a + dst_factor_a;
+    const uint32_t scale = (1UL << 24) / blend_a;
+
+    const uint8_t blend_r = BlendChannelNonPremult(
+        src, src_a, dst, dst_factor_a, scale, CHANNEL_SHIFT(0));
+    const uint8_t blend_g = BlendChannelNonPremult(
+        src, src_a, dst, dst_factor_a, scale, CHANNEL_SHIFT(1));
+    const uint8_t blend_b = BlendChannelNonPremult(
+        src, src_a, dst, dst_factor_a, scale, CHANNEL_SHIFT(2));
+    assert(src_a + dst_factor_a < 256);
+
+    return ((uint32_t)blend_r << CHANNEL_SHIFT(0)) |
+           ((uint32_t)blend_g << CHANNEL_SHIFT(1)) |
+           ((uint32_t)blend_b << CHANNEL_SHIFT(2)) |
+           ((uint32_t)blend_a << CHANNEL_SHIFT(3));
+  }
+}
+
+void WebPBlendPixelRowNonPremult_C(uint32_t* const src,
+                                   const uint32_t* const dst, int num_pixels) {
+  int i;
+  for (i = 0; i < num_pixels; ++i) {
+    const uint8_t src_alpha = (src[i] >> CHANNEL_SHIFT(3)) & 0xff;
+    if (src_alpha != 0xff) {
+      src[i] = BlendPixelNonPremult(src[i], dst[i]);
+    }
+  }
+}
+
+// Individually multiply each channel in 'pix' by 'scale'.
+static WEBP_INLINE uint32_t ChannelwiseMultiply(uint32_t pix, uint32_t scale) {
+  uint32_t mask = 0x00FF00FF;
+  uint32_t rb = ((pix & mask) * scale) >> 8;
+  uint32_t ag = ((pix >> 8) & mask) * scale;
+  return (rb & mask) | (ag & ~mask);
+}
+
+// Blend 'src' over 'dst' assuming they are pre-multiplied by alpha.
+static uint32_t BlendPixelPremult(uint32_t src, uint32_t dst) {
+  const uint8_t src_a = (src >> CHANNEL_SHIFT(3)) & 0xff;
+  return src + ChannelwiseMultiply(dst, 256 - src_a);
+}
+
+void WebPBlendPixelRowPremult_C(uint32_t* const src,
+                                const uint32_t* const dst, int num_pixels) {
+  int i;
+  for (i = 0; i < num_pixels; ++i) {
+    const uint8_t src_alpha = (src[i] >> CHANNEL_SHIFT(3)) & 0xff;
+    if (src_alpha != 0xff) {
+      src[i] = BlendPixelPremult(src[i], dst[i]);
+    }
+  }
+}
+
+#undef CHANNEL_SHIFT
+
 //------------------------------------------------------------------------------
 // Simple channel manipulations.
 
@@ -421,6 +511,8 @@ void (*WebPPackRGB)(const uint8_t* WEBP_RESTRICT r,
 int (*WebPHasAlpha8b)(const uint8_t* src, int length);
 int (*WebPHasAlpha32b)(const uint8_t* src, int length);
 void (*WebPAlphaReplace)(uint32_t* src, int length, uint32_t color);
+WebPBlendRowFunc WebPBlendPixelRowNonPremult;
+WebPBlendRowFunc WebPBlendPixelRowPremult;
 
 //------------------------------------------------------------------------------
 // Init function
@@ -451,6 +543,8 @@ WEBP_DSP_INIT_FUNC(WebPInitAlphaProcessing) {
   WebPHasAlpha8b = HasAlpha8b_C;
   WebPHasAlpha32b = HasAlpha32b_C;
   WebPAlphaReplace = AlphaReplace_C;
+  WebPBlendPixelRowNonPremult = WebPBlendPixelRowNonPremult_C;
+  WebPBlendPixelRowPremult = WebPBlendPixelRowPremult_C;
 
   // If defined, use CPUInfo() to overwrite some pointers with faster versions.
   if (VP8GetCPUInfo != NULL) {
@@ -493,4 +587,11 @@ WEBP_DSP_INIT_FUNC(WebPInitAlphaProcessing) {
   assert(WebPHasAlpha8b != NULL);
   assert(WebPHasAlpha32b != NULL);
   assert(WebPAlphaReplace != NULL);
+  assert(WebPBlendPixelRowNonPremult != NULL);
+  assert(WebPBlendPixelRowPremult != NULL);
+}
+
+WebPBlendRowFunc WebPGetBlendRowFunc(int premultiplied) {
+  WebPInitAlphaProcessing();
+  return premultiplied ? WebPBlendPixelRowPremult : WebPBlendPixelRowNonPremult;
 }
@@ -175,6 +175,119 @@ static void ExtractGreen_NEON(const uint32_t* WEBP_RESTRICT argb,
   for (; i < size; ++i) alpha[i] = (argb[i] >> 8) & 0xff;
 }
 
+//------------------------------------------------------------------------------
+// Blending of rows
+
+// Returns (1 << 24) / a[i], for values a[i] in [1, 255]. The refined reciprocal
+// estimate is within one of the truncated quotient, which the remainder then
+// fixes up.
+static WEBP_INLINE uint32x4_t BlendScale_NEON(const uint32x4_t a) {
+  const float32x4_t a_f = vcvtq_f32_u32(a);
+  const int32x4_t one = vdupq_n_s32(1 << 24);
+  const int32x4_t zero = vdupq_n_s32(0);
+  float32x4_t inv = vrecpeq_f32(a_f);
+  uint32x4_t q;
+  int k;
+  inv = vmulq_f32(vrecpsq_f32(a_f, inv), inv);
+  inv = vmulq_f32(vrecpsq_f32(a_f, inv), inv);
+  q = vcvtq_u32_f32(vmulq_n_f32(inv, (float)(1 << 24)));
+  for (k = 0; k < 2; ++k) {  // Bring the remainder within [0, a).
+    const int32x4_t r =
+        vsubq_s32(one, vreinterpretq_s32_u32(vmulq_u32(q, a)));
+    q = vaddq_u32(q, vcltq_s32(r, zero));  // -1 if negative
+    q = vsubq_u32(q, vcgeq_s32(r, vreinterpretq_s32_u32(a)));  // +1 if >= a
+  }
+  return q;
+}
+
+// Blends one channel of 8 pixels, as BlendChannelNonPremult() does.
+static WEBP_INLINE uint8x8_t BlendChannelNonPremult_NEON(
+    const uint8x8_t src, const uint8x8_t src_a,
+    const uint8x8_t dst, const uint8x8_t dst_a,
+    const uint32x4_t scale_lo, const uint32x4_t scale_hi) {
+  // Both products and their sum fit in 16b.
+  const uint16x8_t unscaled = vmlal_u8(vmull_u8(src, src_a), dst, dst_a);
+  const uint32x4_t lo = vmulq_u32(vmovl_u16(vget_low_u16(unscaled)), scale_lo);
+  const uint32x4_t hi = vmulq_u32(vmovl_u16(vget_high_u16(unscaled)), scale_hi);
+  return vshrn_n_u16(vcombine_u16(vshrn_n_u32(lo, 16), vshrn_n_u32(hi, 16)), 8);
+}
+
+static void BlendPixelRowNonPremult_NEON(uint32_t* const src,
+                                         const uint32_t* const dst,
+                                         int num_pixels) {
+  const uint8x8_t zero = vdup_n_u8(0);
+  const uint8x8_t all_0xff = vdup_n_u8(0xff);
+  int i;
+  for (i = 0; i + 8 <= num_pixels; i += 8) {
+    uint8x8x4_t A = vld4_u8((const uint8_t*)(src + i));
+    const uint8x8_t src_a = A.val[3];
+    if (vget_lane_u64(vreinterpret_u64_u8(src_a), 0) == ~0ULL) {
+      continue;  // Nothing to blend.
+    }
+    {
+      const uint8x8x4_t B = vld4_u8((const uint8_t*)(dst + i));
+      const uint8x8_t is_opaque = vceq_u8(src_a, all_0xff);
+      const uint8x8_t is_transparent = vceq_u8(src_a, zero);
+      // dst_factor_a = (dst_a * (256 - src_a)) >> 8, as in the C version.
+      const uint8x8_t dst_factor_a = vshrn_n_u16(
+          vmlsl_u8(vshll_n_u8(B.val[3], 8), B.val[3], src_a), 8);
+      const uint8x8_t blend_a = vadd_u8(src_a, dst_factor_a);
+      const uint16x8_t blend_a_16 = vmovl_u8(blend_a);
+      // Lanes with blend_a == 0 are transparent ones, not used below.
+      const uint32x4_t scale_lo =
+          BlendScale_NEON(vmovl_u16(vget_low_u16(blend_a_16)));
+      const uint32x4_t scale_hi =
+          BlendScale_NEON(vmovl_u16(vget_high_u16(blend_a_16)));
+      int c;
+      for (c = 0; c < 3; ++c) {
+        const uint8x8_t blended = BlendChannelNonPremult_NEON(
+            A.val[c], src_a, B.val[c], dst_factor_a, scale_lo, scale_hi);
+        // Keep opaque pixels, and use 'dst' under transparent ones.
+        A.val[c] = vbsl_u8(is_transparent, B.val[c],
+                           vbsl_u8(is_opaque, A.val[c], blended));
+      }
+      // blend_a is already 0xff for opaque pixels and dst_a for transparent
+      // ones.
+      A.val[3] = blend_a;
+      vst4_u8((uint8_t*)(src + i), A);
+    }
+  }
+  if (i < num_pixels) {
+    WebPBlendPixelRowNonPremult_C(src + i, dst + i, num_pixels - i);
+  }
+}
+
+static void BlendPixelRowPremult_NEON(uint32_t* const src,
+                                      const uint32_t* const dst,
+                                      int num_pixels) {
+  const uint32x4_t k256 = vdupq_n_u32(256);
+  int i;
+  for (i = 0; i + 4 <= num_pixels; i += 4) {
+    const uint32x4_t A = vld1q_u32(src + i);
+    const uint32x2_t m = vand_u32(vget_low_u32(A), vget_high_u32(A));
+    if ((vget_lane_u32(m, 0) & vget_lane_u32(m, 1)) >= 0xff000000u) {
+      continue;  // Nothing to blend.
+    }
+    {
+      const uint8x16_t B = vreinterpretq_u8_u32(vld1q_u32(dst + i));
+      // 'scale' = 256 - src_a, spread over the 4 channels of each pixel. Opaque
+      // pixels get a null product, as in ChannelwiseMultiply().
+      const uint32x4_t scale0 = vsubq_u32(k256, vshrq_n_u32(A, 24));
+      const uint16x8_t scale1 =
+          vreinterpretq_u16_u32(vorrq_u32(scale0, vshlq_n_u32(scale0, 16)));
+      const uint16x8x2_t scale = vzipq_u16(scale1, scale1);
+      const uint16x8_t lo = vmulq_u16(vmovl_u8(vget_low_u8(B)), scale.val[0]);
+      const uint16x8_t hi = vmulq_u16(vmovl_u8(vget_high_u8(B)), scale.val[1]);
+      const uint8x16_t prod =
+          vcombine_u8(vshrn_n_u16(lo, 8), vshrn_n_u16(hi, 8));
+      vst1q_u32(src + i, vaddq_u32(A, vreinterpretq_u32_u8(prod)));
+    }
+  }
+  if (i < num_pixels) {
+    WebPBlendPixelRowPremult_C(src + i, dst + i, num_pixels - i);
+  }
+}
+
 //------------------------------------------------------------------------------
 
 extern void WebPInitAlphaProcessingNEON(void);
@@ -185,6 +298,8 @@ WEBP_TSAN_IGNORE_FUNCTION void WebPInitAlphaProcessingNEON(void) {
   WebPDispatchAlphaToGreen = DispatchAlphaToGreen_NEON;
   WebPExtractAlpha = ExtractAlpha_NEON;
   WebPExtractGreen = ExtractGreen_NEON;
+  WebPBlendPixelRowNonPremult = BlendPixelRowNonPremult_NEON;
+  WebPBlendPixelRowPremult = BlendPixelRowPremult_NEON;
 }
 
 #else  // !WEBP_USE_NEON
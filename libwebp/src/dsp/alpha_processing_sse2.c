@@ -327,6 +327,128 @@ static void AlphaReplace_SSE2(uint32_t* src, int length, uint32_t color) {
   for (; i < length; ++i) if ((src[i] >> 24) == 0) src[i] = color;
 }
 
+// -----------------------------------------------------------------------------
+// Blending of rows
+
+// Returns the 32b products a[i] * b[i], for products fitting in 32b.
+static WEBP_INLINE __m128i Mul32_SSE2(const __m128i a, const __m128i b) {
+  const __m128i even = _mm_mul_epu32(a, b);
+  const __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32),
+                                    _mm_srli_epi64(b, 32));
+  const __m128i even_lo = _mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0));
+  const __m128i odd_lo = _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0));
+  return _mm_unpacklo_epi32(even_lo, odd_lo);
+}
+
+// Returns (1 << 24) / a[i], for 32b values a[i] in [1, 255]. Double precision
+// keeps the truncated quotient exact.
+static WEBP_INLINE __m128i BlendScale_SSE2(const __m128i a) {
+  const __m128d one = _mm_set1_pd((double)(1 << 24));
+  const __m128d a_lo = _mm_cvtepi32_pd(a);
+  const __m128d a_hi = _mm_cvtepi32_pd(_mm_unpackhi_epi64(a, a));
+  const __m128i q_lo = _mm_cvttpd_epi32(_mm_div_pd(one, a_lo));
+  const __m128i q_hi = _mm_cvttpd_epi32(_mm_div_pd(one, a_hi));
+  return _mm_unpacklo_epi64(q_lo, q_hi);
+}
+
+// Blends one channel, shifted down by 'shift' bits, of 4 pixels.
+#define BLEND_CHANNEL_NON_PREMULT(SRC, DST, SRC_A, DST_A, SCALE, SHIFT, OUT) \
+  do {                                                                        \
+    const __m128i mask = _mm_set1_epi32(0xff);                                \
+    const __m128i s = _mm_and_si128(_mm_srli_epi32((SRC), (SHIFT)), mask);    \
+    const __m128i d = _mm_and_si128(_mm_srli_epi32((DST), (SHIFT)), mask);    \
+    /* Both products and their sum fit in 16b. */                             \
+    const __m128i unscaled = _mm_add_epi16(_mm_mullo_epi16(s, (SRC_A)),       \
+                                           _mm_mullo_epi16(d, (DST_A)));      \
+    (OUT) = _mm_srli_epi32(Mul32_SSE2(unscaled, (SCALE)), 24);                \
+  } while (0)
+
+static void BlendPixelRowNonPremult_SSE2(uint32_t* const src,
+                                         const uint32_t* const dst,
+                                         int num_pixels) {
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i k256 = _mm_set1_epi32(256);
+  const __m128i all_0xff = _mm_set1_epi32(0xff);
+  int i;
+  for (i = 0; i + 4 <= num_pixels; i += 4) {
+    const __m128i A = _mm_loadu_si128((const __m128i*)&src[i]);
+    const __m128i src_a = _mm_srli_epi32(A, 24);
+    const __m128i is_opaque = _mm_cmpeq_epi32(src_a, all_0xff);
+    const __m128i is_transparent = _mm_cmpeq_epi32(src_a, zero);
+    const int opaque_mask = _mm_movemask_epi8(is_opaque);
+    if (opaque_mask == 0xffff) continue;  // Nothing to blend.
+    {
+      const __m128i B = _mm_loadu_si128((const __m128i*)&dst[i]);
+      if (_mm_movemask_epi8(is_transparent) == 0xffff) {
+        _mm_storeu_si128((__m128i*)&src[i], B);
+        continue;
+      }
+      {
+        const __m128i dst_a = _mm_srli_epi32(B, 24);
+        // dst_factor_a = (dst_a * (256 - src_a)) >> 8, as in the C version.
+        const __m128i dst_factor_a = _mm_srli_epi32(
+            _mm_mullo_epi16(dst_a, _mm_sub_epi32(k256, src_a)), 8);
+        const __m128i blend_a = _mm_add_epi32(src_a, dst_factor_a);
+        // Lanes with blend_a == 0 are transparent ones, not used below.
+        const __m128i scale = BlendScale_SSE2(blend_a);
+        __m128i r, g, b, out;
+        BLEND_CHANNEL_NON_PREMULT(A, B, src_a, dst_factor_a, scale, 0, r);
+        BLEND_CHANNEL_NON_PREMULT(A, B, src_a, dst_factor_a, scale, 8, g);
+        BLEND_CHANNEL_NON_PREMULT(A, B, src_a, dst_factor_a, scale, 16, b);
+        out = _mm_or_si128(_mm_or_si128(r, _mm_slli_epi32(g, 8)),
+                           _mm_or_si128(_mm_slli_epi32(b, 16),
+                                        _mm_slli_epi32(blend_a, 24)));
+        // Keep opaque pixels, and use 'dst' under transparent ones.
+        out = _mm_or_si128(_mm_and_si128(is_opaque, A),
+                           _mm_andnot_si128(is_opaque, out));
+        out = _mm_or_si128(_mm_and_si128(is_transparent, B),
+                           _mm_andnot_si128(is_transparent, out));
+        _mm_storeu_si128((__m128i*)&src[i], out);
+      }
+    }
+  }
+  if (i < num_pixels) {
+    WebPBlendPixelRowNonPremult_C(src + i, dst + i, num_pixels - i);
+  }
+}
+#undef BLEND_CHANNEL_NON_PREMULT
+
+static void BlendPixelRowPremult_SSE2(uint32_t* const src,
+                                      const uint32_t* const dst,
+                                      int num_pixels) {
+  const __m128i k256 = _mm_set1_epi32(256);
+  const __m128i all_0xff = _mm_set1_epi32(0xff);
+  const __m128i mask_rb = _mm_set1_epi32(0x00ff00ff);
+  const __m128i mask_ag = _mm_set1_epi32((int)0xff00ff00u);
+  int i;
+  for (i = 0; i + 4 <= num_pixels; i += 4) {
+    const __m128i A = _mm_loadu_si128((const __m128i*)&src[i]);
+    const __m128i src_a = _mm_srli_epi32(A, 24);
+    const __m128i is_opaque = _mm_cmpeq_epi32(src_a, all_0xff);
+    if (_mm_movemask_epi8(is_opaque) == 0xffff) continue;  // Nothing to blend.
+    {
+      const __m128i B = _mm_loadu_si128((const __m128i*)&dst[i]);
+      // 'scale' = 256 - src_a, replicated in both 16b halves. Each channel is
+      // multiplied in its own 16b lane, as in ChannelwiseMultiply().
+      const __m128i scale0 = _mm_sub_epi32(k256, src_a);
+      const __m128i scale = _mm_or_si128(scale0, _mm_slli_epi32(scale0, 16));
+      const __m128i rb = _mm_and_si128(
+          _mm_srli_epi16(_mm_mullo_epi16(_mm_and_si128(B, mask_rb), scale), 8),
+          mask_rb);
+      const __m128i ag = _mm_and_si128(
+          _mm_mullo_epi16(_mm_and_si128(_mm_srli_epi32(B, 8), mask_rb), scale),
+          mask_ag);
+      const __m128i blended = _mm_add_epi32(A, _mm_or_si128(rb, ag));
+      const __m128i out = _mm_or_si128(_mm_and_si128(is_opaque, A),
+                                       _mm_andnot_si128(is_opaque, blended));
+      _mm_storeu_si128((__m128i*)&src[i], out);
+    }
+  }
+  if (i < num_pixels) {
+    WebPBlendPixelRowPremult_C(src + i, dst + i, num_pixels - i);
+  }
+}
+
 // -----------------------------------------------------------------------------
 // Apply alpha value to rows
 
@@ -399,6 +521,8 @@ WEBP_TSAN_IGNORE_FUNCTION void WebPInitAlphaProcessingSSE2(void) {
   WebPHasAlpha8b = HasAlpha8b_SSE2;
   WebPHasAlpha32b = HasAlpha32b_SSE2;
   WebPAlphaReplace = AlphaReplace_SSE2;
+  WebPBlendPixelRowNonPremult = BlendPixelRowNonPremult_SSE2;
+  WebPBlendPixelRowPremult = BlendPixelRowPremult_SSE2;
 }
 
 #else  // !WEBP_USE_SSE2
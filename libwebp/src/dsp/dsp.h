@@ -498,6 +498,25 @@ extern int (*WebPHasAlpha32b)(const uint8_t* src, int length);
 // replaces transparent values in src[] by 'color'.
 extern void (*WebPAlphaReplace)(uint32_t* src, int length, uint32_t color);
 
+// Blend 'num_pixels' rgba or bgra pixels of 'src' over 'dst', in place in
+// 'src'. Pixels are NOT pre-multiplied by alpha (RGBA/BGRA modes) or
+// pre-multiplied (rgbA/bgrA modes) respectively. Opaque 'src' pixels are left
+// untouched.
+typedef void (*WebPBlendRowFunc)(uint32_t* const src,
+                                 const uint32_t* const dst, int num_pixels);
+extern WebPBlendRowFunc WebPBlendPixelRowNonPremult;
+extern WebPBlendRowFunc WebPBlendPixelRowPremult;
+
+// Returns WebPBlendPixelRowPremult if 'premultiplied' is true, and
+// WebPBlendPixelRowNonPremult otherwise, initializing them if needed.
+WEBP_EXTERN WebPBlendRowFunc WebPGetBlendRowFunc(int premultiplied);
+
+// Plain-C versions, used as fallback by some implementations.
+void WebPBlendPixelRowNonPremult_C(uint32_t* const src,
+                                   const uint32_t* const dst, int num_pixels);
+void WebPBlendPixelRowPremult_C(uint32_t* const src,
+                                const uint32_t* const dst, int num_pixels);
+
 // To be called first before using the above.
 void WebPInitAlphaProcessing(void);
 
@@ -534,6 +553,29 @@ extern WebPFilterFunc WebPFilters[WEBP_FILTER_LAST];
 // (assuming rows upto 'row - 1' are already reconstructed).
 extern WebPUnfilterFunc WebPUnfilters[WEBP_FILTER_LAST];
 
+// Gradient smoothing of quantized alpha levels (see
+// utils/quant_levels_dec_utils.c). All sums are modulo 16 bits.
+// Vertical accumulation: cur[x] is replaced by top[x] + src[0] + ... + src[x]
+// and out[x] receives the difference between the new and old cur[x] values.
+typedef void (*WebPSmoothVFilterFunc)(const uint8_t* WEBP_RESTRICT src,
+                                      const uint16_t* WEBP_RESTRICT top,
+                                      uint16_t* WEBP_RESTRICT cur,
+                                      uint16_t* WEBP_RESTRICT out, int width);
+extern WebPSmoothVFilterFunc WebPSmoothLevelsVFilter;
+// Horizontal difference: out[x] = ((plus[x] - minus[x]) * scale) >> 16,
+// with 'scale' < 65536. 'plus' and 'minus' can point to the same row.
+typedef void (*WebPSmoothHFilterFunc)(const uint16_t* plus,
+                                      const uint16_t* minus, uint32_t scale,
+                                      uint16_t* WEBP_RESTRICT out, int len);
+extern WebPSmoothHFilterFunc WebPSmoothLevelsHFilter;
+// Replaces each dst[x] value strictly within ]min, max[ by
+// clip(dst[x] + correction[average[x] - 4 * dst[x]]).
+typedef void (*WebPSmoothApplyFunc)(const uint16_t* WEBP_RESTRICT average,
+                                    const int16_t* WEBP_RESTRICT correction,
+                                    int min, int max,
+                                    uint8_t* WEBP_RESTRICT dst, int width);
+extern WebPSmoothApplyFunc WebPSmoothLevelsApply;
+
 // To be called first before using the above.
 void VP8FiltersInit(void);
 
@@ -203,11 +203,56 @@ static void GradientUnfilter_C(const uint8_t* prev, const uint8_t* in,
   }
 }
 
+//------------------------------------------------------------------------------
+// Gradient smoothing
+
+static void SmoothVFilter_C(const uint8_t* WEBP_RESTRICT src,
+                            const uint16_t* WEBP_RESTRICT top,
+                            uint16_t* WEBP_RESTRICT cur,
+                            uint16_t* WEBP_RESTRICT out, int width) {
+  uint16_t sum = 0;               // all arithmetic is modulo 16bit
+  int x;
+  for (x = 0; x < width; ++x) {
+    uint16_t new_value;
+    sum += src[x];
+    new_value = top[x] + sum;
+    out[x] = new_value - cur[x];
+    cur[x] = new_value;
+  }
+}
+
+static void SmoothHFilter_C(const uint16_t* plus, const uint16_t* minus,
+                            uint32_t scale, uint16_t* WEBP_RESTRICT out,
+                            int len) {
+  int x;
+  for (x = 0; x < len; ++x) {
+    const uint16_t delta = plus[x] - minus[x];
+    out[x] = (delta * scale) >> 16;
+  }
+}
+
+static void SmoothApply_C(const uint16_t* WEBP_RESTRICT average,
+                          const int16_t* WEBP_RESTRICT correction,
+                          int min, int max,
+                          uint8_t* WEBP_RESTRICT dst, int width) {
+  int x;
+  for (x = 0; x < width; ++x) {
+    const int v = dst[x];
+    if (v < max && v > min) {
+      const int c = v + correction[average[x] - (v << 2)];
+      dst[x] = (c < 0) ? 0u : (c > 255) ? 255u : (uint8_t)c;
+    }
+  }
+}
+
 //------------------------------------------------------------------------------
 // Init function
 
 WebPFilterFunc WebPFilters[WEBP_FILTER_LAST];
 WebPUnfilterFunc WebPUnfilters[WEBP_FILTER_LAST];
+WebPSmoothVFilterFunc WebPSmoothLevelsVFilter;
+WebPSmoothHFilterFunc WebPSmoothLevelsHFilter;
+WebPSmoothApplyFunc WebPSmoothLevelsApply;
 
 extern VP8CPUInfo VP8GetCPUInfo;
 extern void VP8FiltersInitMIPSdspR2(void);
@@ -230,6 +275,10 @@ WEBP_DSP_INIT_FUNC(VP8FiltersInit) {
   WebPFilters[WEBP_FILTER_GRADIENT] = GradientFilter_C;
 #endif
 
+  WebPSmoothLevelsVFilter = SmoothVFilter_C;
+  WebPSmoothLevelsHFilter = SmoothHFilter_C;
+  WebPSmoothLevelsApply = SmoothApply_C;
+
   if (VP8GetCPUInfo != NULL) {
 #if defined(WEBP_HAVE_SSE2)
     if (VP8GetCPUInfo(kSSE2)) {
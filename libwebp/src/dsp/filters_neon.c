@@ -282,6 +282,89 @@ static void GradientUnfilter_NEON(const uint8_t* prev, const uint8_t* in,
 
 #endif   // USE_GRADIENT_UNFILTER
 
+//------------------------------------------------------------------------------
+// Gradient smoothing
+
+static void SmoothVFilter_NEON(const uint8_t* WEBP_RESTRICT src,
+                               const uint16_t* WEBP_RESTRICT top,
+                               uint16_t* WEBP_RESTRICT cur,
+                               uint16_t* WEBP_RESTRICT out, int width) {
+  const uint16x8_t zero = vdupq_n_u16(0);
+  uint16_t last = 0;      // running sum, all arithmetic is modulo 16bit
+  int x;
+  for (x = 0; x + 8 <= width; x += 8) {
+    const uint16x8_t A = vmovl_u8(vld1_u8(src + x));
+    // prefix sums of the 8 values
+    const uint16x8_t B = vaddq_u16(A, vextq_u16(zero, A, 7));
+    const uint16x8_t C = vaddq_u16(B, vextq_u16(zero, B, 6));
+    const uint16x8_t D = vaddq_u16(C, vextq_u16(zero, C, 4));
+    const uint16x8_t E = vaddq_u16(D, vdupq_n_u16(last));
+    const uint16x8_t new_value = vaddq_u16(vld1q_u16(top + x), E);
+    vst1q_u16(out + x, vsubq_u16(new_value, vld1q_u16(cur + x)));
+    vst1q_u16(cur + x, new_value);
+    last = vgetq_lane_u16(E, 7);
+  }
+  for (; x < width; ++x) {
+    uint16_t new_value;
+    last += src[x];
+    new_value = top[x] + last;
+    out[x] = new_value - cur[x];
+    cur[x] = new_value;
+  }
+}
+
+static void SmoothHFilter_NEON(const uint16_t* plus, const uint16_t* minus,
+                               uint32_t scale, uint16_t* WEBP_RESTRICT out,
+                               int len) {
+  const uint16_t mult = (uint16_t)scale;
+  int x;
+  assert(scale < (1u << 16));
+  for (x = 0; x + 8 <= len; x += 8) {
+    const uint16x8_t delta = vsubq_u16(vld1q_u16(plus + x),
+                                       vld1q_u16(minus + x));
+    const uint32x4_t lo = vmull_n_u16(vget_low_u16(delta), mult);
+    const uint32x4_t hi = vmull_n_u16(vget_high_u16(delta), mult);
+    vst1q_u16(out + x, vcombine_u16(vshrn_n_u32(lo, 16), vshrn_n_u32(hi, 16)));
+  }
+  for (; x < len; ++x) {
+    const uint16_t delta = plus[x] - minus[x];
+    out[x] = (delta * scale) >> 16;
+  }
+}
+
+static void SmoothApply_NEON(const uint16_t* WEBP_RESTRICT average,
+                             const int16_t* WEBP_RESTRICT correction,
+                             int min, int max,
+                             uint8_t* WEBP_RESTRICT dst, int width) {
+  const uint8x16_t min_v = vdupq_n_u8((uint8_t)min);
+  const uint8x16_t max_v = vdupq_n_u8((uint8_t)max);
+  int x = 0;
+  assert(min >= 0 && max <= 255);
+  while (x < width) {
+    int end = x + 16;
+    if (end <= width) {
+      // Skip the groups of 16 values that are all out of ]min, max[.
+      const uint8x16_t v = vld1q_u8(dst + x);
+      const uint8x16_t inside =
+          vandq_u8(vcgtq_u8(v, min_v), vcltq_u8(v, max_v));
+      const uint64x2_t inside64 = vreinterpretq_u64_u8(inside);
+      if ((vgetq_lane_u64(inside64, 0) | vgetq_lane_u64(inside64, 1)) == 0) {
+        x = end;
+        continue;
+      }
+    } else {
+      end = width;
+    }
+    for (; x < end; ++x) {
+      const int v = dst[x];
+      if (v < max && v > min) {
+        const int c = v + correction[average[x] - (v << 2)];
+        dst[x] = (c < 0) ? 0u : (c > 255) ? 255u : (uint8_t)c;
+      }
+    }
+  }
+}
+
 //------------------------------------------------------------------------------
 // Entry point
 
@@ -297,6 +380,10 @@ WEBP_TSAN_IGNORE_FUNCTION void VP8FiltersInitNEON(void) {
   WebPFilters[WEBP_FILTER_HORIZONTAL] = HorizontalFilter_NEON;
   WebPFilters[WEBP_FILTER_VERTICAL] = VerticalFilter_NEON;
   WebPFilters[WEBP_FILTER_GRADIENT] = GradientFilter_NEON;
+
+  WebPSmoothLevelsVFilter = SmoothVFilter_NEON;
+  WebPSmoothLevelsHFilter = SmoothHFilter_NEON;
+  WebPSmoothLevelsApply = SmoothApply_NEON;
 }
 
 #else  // !WEBP_USE_NEON
@@ -294,6 +294,94 @@ static void GradientUnfilter_SSE2(const uint8_t* prev, const uint8_t* in,
   }
 }
 
+//------------------------------------------------------------------------------
+// Gradient smoothing
+
+static void SmoothVFilter_SSE2(const uint8_t* WEBP_RESTRICT src,
+                               const uint16_t* WEBP_RESTRICT top,
+                               uint16_t* WEBP_RESTRICT cur,
+                               uint16_t* WEBP_RESTRICT out, int width) {
+  const __m128i zero = _mm_setzero_si128();
+  __m128i sum = zero;     // running sum, broadcast to all lanes
+  uint16_t last;
+  int x;
+  for (x = 0; x + 8 <= width; x += 8) {
+    const __m128i A = _mm_loadl_epi64((const __m128i*)&src[x]);
+    const __m128i B = _mm_unpacklo_epi8(A, zero);
+    // prefix sums of the 8 values
+    const __m128i C = _mm_add_epi16(B, _mm_slli_si128(B, 2));
+    const __m128i D = _mm_add_epi16(C, _mm_slli_si128(C, 4));
+    const __m128i E = _mm_add_epi16(D, _mm_slli_si128(D, 8));
+    const __m128i F = _mm_add_epi16(E, sum);
+    const __m128i G = _mm_loadu_si128((const __m128i*)&top[x]);
+    const __m128i H = _mm_loadu_si128((const __m128i*)&cur[x]);
+    const __m128i new_value = _mm_add_epi16(G, F);
+    _mm_storeu_si128((__m128i*)&out[x], _mm_sub_epi16(new_value, H));
+    _mm_storeu_si128((__m128i*)&cur[x], new_value);
+    sum = _mm_shufflehi_epi16(F, _MM_SHUFFLE(3, 3, 3, 3));
+    sum = _mm_unpackhi_epi64(sum, sum);
+  }
+  last = (uint16_t)_mm_cvtsi128_si32(sum);
+  for (; x < width; ++x) {
+    uint16_t new_value;
+    last += src[x];
+    new_value = top[x] + last;
+    out[x] = new_value - cur[x];
+    cur[x] = new_value;
+  }
+}
+
+static void SmoothHFilter_SSE2(const uint16_t* plus, const uint16_t* minus,
+                               uint32_t scale, uint16_t* WEBP_RESTRICT out,
+                               int len) {
+  const __m128i mult = _mm_set1_epi16((short)scale);
+  int x;
+  assert(scale < (1u << 16));
+  for (x = 0; x + 8 <= len; x += 8) {
+    const __m128i A = _mm_loadu_si128((const __m128i*)&plus[x]);
+    const __m128i B = _mm_loadu_si128((const __m128i*)&minus[x]);
+    const __m128i delta = _mm_sub_epi16(A, B);
+    _mm_storeu_si128((__m128i*)&out[x], _mm_mulhi_epu16(delta, mult));
+  }
+  for (; x < len; ++x) {
+    const uint16_t delta = plus[x] - minus[x];
+    out[x] = (delta * scale) >> 16;
+  }
+}
+
+static void SmoothApply_SSE2(const uint16_t* WEBP_RESTRICT average,
+                             const int16_t* WEBP_RESTRICT correction,
+                             int min, int max,
+                             uint8_t* WEBP_RESTRICT dst, int width) {
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i min_v = _mm_set1_epi8((char)min);
+  const __m128i max_v = _mm_set1_epi8((char)max);
+  int x = 0;
+  assert(min >= 0 && max <= 255);
+  while (x < width) {
+    int end = x + 16;
+    if (end <= width) {
+      // Skip the groups of 16 values that are all out of ]min, max[.
+      const __m128i v = _mm_loadu_si128((const __m128i*)&dst[x]);
+      const __m128i below = _mm_cmpeq_epi8(_mm_subs_epu8(v, min_v), zero);
+      const __m128i above = _mm_cmpeq_epi8(_mm_subs_epu8(max_v, v), zero);
+      if (_mm_movemask_epi8(_mm_or_si128(below, above)) == 0xffff) {
+        x = end;
+        continue;
+      }
+    } else {
+      end = width;
+    }
+    for (; x < end; ++x) {
+      const int v = dst[x];
+      if (v < max && v > min) {
+        const int c = v + correction[average[x] - (v << 2)];
+        dst[x] = (c < 0) ? 0u : (c > 255) ? 255u : (uint8_t)c;
+      }
+    }
+  }
+}
+
 //------------------------------------------------------------------------------
 // Entry point
 
@@ -312,6 +400,10 @@ WEBP_TSAN_IGNORE_FUNCTION void VP8FiltersInitSSE2(void) {
   WebPFilters[WEBP_FILTER_HORIZONTAL] = HorizontalFilter_SSE2;
   WebPFilters[WEBP_FILTER_VERTICAL] = VerticalFilter_SSE2;
   WebPFilters[WEBP_FILTER_GRADIENT] = GradientFilter_SSE2;
+
+  WebPSmoothLevelsVFilter = SmoothVFilter_SSE2;
+  WebPSmoothLevelsHFilter = SmoothHFilter_SSE2;
+  WebPSmoothLevelsApply = SmoothApply_SSE2;
 }
 
 #else  // !WEBP_USE_SSE2
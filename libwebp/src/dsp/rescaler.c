@@ -200,6 +200,7 @@ WebPRescalerExportRowFunc WebPRescalerExportRowShrink;
 
 extern VP8CPUInfo VP8GetCPUInfo;
 extern void WebPRescalerDspInitSSE2(void);
+extern void WebPRescalerDspInitAVX2(void);
 extern void WebPRescalerDspInitMIPS32(void);
 extern void WebPRescalerDspInitMIPSdspR2(void);
 extern void WebPRescalerDspInitMSA(void);
@@ -221,6 +222,11 @@ WEBP_DSP_INIT_FUNC(WebPRescalerDspInit) {
       WebPRescalerDspInitSSE2();
     }
 #endif
+#if defined(WEBP_HAVE_AVX2)
+    if (VP8GetCPUInfo(kAVX2)) {
+      WebPRescalerDspInitAVX2();
+    }
+#endif
 #if defined(WEBP_USE_MIPS32)
     if (VP8GetCPUInfo(kMIPS32)) {
       WebPRescalerDspInitMIPS32();
@@ -0,0 +1,215 @@
+// Copyright 2025 Google Inc. All Rights Reserved.
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the COPYING file in the root of the source
+// tree. An additional intellectual property rights grant can be found
+// in the file PATENTS. All contributing project authors may
+// be found in the AUTHORS file in the root of the source tree.
+// -----------------------------------------------------------------------------
+//
+// AVX2 Rescaling functions
+
+#include "src/dsp/dsp.h"
+
+#if defined(WEBP_USE_AVX2) && !defined(WEBP_REDUCE_SIZE)
+#include <immintrin.h>
+
+#include <assert.h>
+#include "src/utils/rescaler_utils.h"
+#include "src/utils/utils.h"
+
+//------------------------------------------------------------------------------
+// Row export
+
+#define ROUNDER (WEBP_RESCALER_ONE >> 1)
+#define MULT_FIX(x, y) (((uint64_t)(x) * (y) + ROUNDER) >> WEBP_RESCALER_RFIX)
+#define MULT_FIX_FLOOR(x, y) (((uint64_t)(x) * (y)) >> WEBP_RESCALER_RFIX)
+
+// Returns ((A * mult + ROUNDER) >> WEBP_RESCALER_RFIX) for the eight 32b
+// values of A. The even and odd lanes are multiplied separately.
+static WEBP_INLINE __m256i MultFix_AVX2(const __m256i A, const __m256i mult) {
+  const __m256i rounder = _mm256_set1_epi64x(ROUNDER);
+  const __m256i mask = _mm256_set1_epi64x((int64_t)0xffffffff00000000ULL);
+  const __m256i B0 = _mm256_mul_epu32(A, mult);
+  const __m256i B1 = _mm256_mul_epu32(_mm256_srli_epi64(A, 32), mult);
+  const __m256i C0 = _mm256_add_epi64(B0, rounder);
+  const __m256i C1 = _mm256_add_epi64(B1, rounder);
+  const __m256i D0 = _mm256_srli_epi64(C0, WEBP_RESCALER_RFIX);
+#if (WEBP_RESCALER_RFIX < 32)
+  const __m256i D1 =
+      _mm256_and_si256(_mm256_slli_epi64(C1, 32 - WEBP_RESCALER_RFIX), mask);
+#else
+  const __m256i D1 = _mm256_and_si256(C1, mask);
+#endif
+  return _mm256_or_si256(D0, D1);
+}
+
+// Returns (A * mult) >> WEBP_RESCALER_RFIX, without rounding.
+static WEBP_INLINE __m256i MultFixFloor_AVX2(const __m256i A,
+                                             const __m256i mult) {
+  const __m256i mask = _mm256_set1_epi64x((int64_t)0xffffffff00000000ULL);
+  const __m256i B0 = _mm256_mul_epu32(A, mult);
+  const __m256i B1 = _mm256_mul_epu32(_mm256_srli_epi64(A, 32), mult);
+  const __m256i D0 = _mm256_srli_epi64(B0, WEBP_RESCALER_RFIX);
+#if (WEBP_RESCALER_RFIX < 32)
+  const __m256i D1 =
+      _mm256_and_si256(_mm256_slli_epi64(B1, 32 - WEBP_RESCALER_RFIX), mask);
+#else
+  const __m256i D1 = _mm256_and_si256(B1, mask);
+#endif
+  return _mm256_or_si256(D0, D1);
+}
+
+// Packs the sixteen 32b values of A0 and A1 into bytes, with saturation.
+static WEBP_INLINE void StoreSixteen_AVX2(const __m256i A0, const __m256i A1,
+                                          uint8_t* const dst) {
+  const __m256i B = _mm256_packs_epi32(A0, A1);  // lanes are interleaved
+  const __m256i C = _mm256_permute4x64_epi64(B, 0xd8);
+  const __m128i D = _mm_packus_epi16(_mm256_castsi256_si128(C),
+                                     _mm256_extracti128_si256(C, 1));
+  _mm_storeu_si128((__m128i*)dst, D);
+}
+
+static void RescalerExportRowExpand_AVX2(WebPRescaler* const wrk) {
+  int x_out;
+  uint8_t* const dst = wrk->dst;
+  rescaler_t* const irow = wrk->irow;
+  const int x_out_max = wrk->dst_width * wrk->num_channels;
+  const rescaler_t* const frow = wrk->frow;
+  const __m256i mult = _mm256_set1_epi64x(wrk->fy_scale);
+
+  assert(!WebPRescalerOutputDone(wrk));
+  assert(wrk->y_accum <= 0 && wrk->y_sub + wrk->y_accum >= 0);
+  assert(wrk->y_expand);
+  if (wrk->y_accum == 0) {
+    for (x_out = 0; x_out + 16 <= x_out_max; x_out += 16) {
+      const __m256i A0 = _mm256_loadu_si256((const __m256i*)(frow + x_out));
+      const __m256i A1 =
+          _mm256_loadu_si256((const __m256i*)(frow + x_out + 8));
+      StoreSixteen_AVX2(MultFix_AVX2(A0, mult), MultFix_AVX2(A1, mult),
+                        dst + x_out);
+    }
+    for (; x_out < x_out_max; ++x_out) {
+      const uint32_t J = frow[x_out];
+      const int v = (int)MULT_FIX(J, wrk->fy_scale);
+      dst[x_out] = (v > 255) ? 255u : (uint8_t)v;
+    }
+  } else {
+    const uint32_t B = WEBP_RESCALER_FRAC(-wrk->y_accum, wrk->y_sub);
+    const uint32_t A = (uint32_t)(WEBP_RESCALER_ONE - B);
+    const __m256i mA = _mm256_set1_epi64x(A);
+    const __m256i mB = _mm256_set1_epi64x(B);
+    const __m256i rounder = _mm256_set1_epi64x(ROUNDER);
+    const __m256i mask = _mm256_set1_epi64x((int64_t)0xffffffff00000000ULL);
+    __m256i J[2];
+    for (x_out = 0; x_out + 16 <= x_out_max; x_out += 16) {
+      int k;
+      for (k = 0; k < 2; ++k) {
+        // J = (A * frow + B * irow + ROUNDER) >> WEBP_RESCALER_RFIX
+        const __m256i F = _mm256_loadu_si256(
+            (const __m256i*)(frow + x_out + 8 * k));
+        const __m256i I = _mm256_loadu_si256(
+            (const __m256i*)(irow + x_out + 8 * k));
+        const __m256i C0 = _mm256_add_epi64(_mm256_mul_epu32(F, mA),
+                                            _mm256_mul_epu32(I, mB));
+        const __m256i C1 = _mm256_add_epi64(
+            _mm256_mul_epu32(_mm256_srli_epi64(F, 32), mA),
+            _mm256_mul_epu32(_mm256_srli_epi64(I, 32), mB));
+        const __m256i D0 =
+            _mm256_srli_epi64(_mm256_add_epi64(C0, rounder),
+                              WEBP_RESCALER_RFIX);
+        const __m256i D1 =
+            _mm256_add_epi64(C1, rounder);
+#if (WEBP_RESCALER_RFIX < 32)
+        const __m256i E1 = _mm256_and_si256(
+            _mm256_slli_epi64(D1, 32 - WEBP_RESCALER_RFIX), mask);
+#else
+        const __m256i E1 = _mm256_and_si256(D1, mask);
+#endif
+        J[k] = MultFix_AVX2(_mm256_or_si256(D0, E1), mult);
+      }
+      StoreSixteen_AVX2(J[0], J[1], dst + x_out);
+    }
+    for (; x_out < x_out_max; ++x_out) {
+      const uint64_t I = (uint64_t)A * frow[x_out]
+                       + (uint64_t)B * irow[x_out];
+      const uint32_t Jx = (uint32_t)((I + ROUNDER) >> WEBP_RESCALER_RFIX);
+      const int v = (int)MULT_FIX(Jx, wrk->fy_scale);
+      dst[x_out] = (v > 255) ? 255u : (uint8_t)v;
+    }
+  }
+}
+
+static void RescalerExportRowShrink_AVX2(WebPRescaler* const wrk) {
+  int x_out;
+  uint8_t* const dst = wrk->dst;
+  rescaler_t* const irow = wrk->irow;
+  const int x_out_max = wrk->dst_width * wrk->num_channels;
+  const rescaler_t* const frow = wrk->frow;
+  const uint32_t yscale = wrk->fy_scale * (-wrk->y_accum);
+  assert(!WebPRescalerOutputDone(wrk));
+  assert(wrk->y_accum <= 0);
+  assert(!wrk->y_expand);
+  if (yscale) {
+    const int scale_xy = wrk->fxy_scale;
+    const __m256i mult_xy = _mm256_set1_epi64x(scale_xy);
+    const __m256i mult_y = _mm256_set1_epi64x(yscale);
+    __m256i V[2];
+    for (x_out = 0; x_out + 16 <= x_out_max; x_out += 16) {
+      int k;
+      for (k = 0; k < 2; ++k) {
+        rescaler_t* const I = irow + x_out + 8 * k;
+        const __m256i A = _mm256_loadu_si256((const __m256i*)I);
+        const __m256i B =
+            _mm256_loadu_si256((const __m256i*)(frow + x_out + 8 * k));
+        const __m256i frac = MultFixFloor_AVX2(B, mult_y);
+        V[k] = MultFix_AVX2(_mm256_sub_epi32(A, frac), mult_xy);
+        _mm256_storeu_si256((__m256i*)I, frac);  // new fractional start
+      }
+      StoreSixteen_AVX2(V[0], V[1], dst + x_out);
+    }
+    for (; x_out < x_out_max; ++x_out) {
+      const uint32_t frac = (int)MULT_FIX_FLOOR(frow[x_out], yscale);
+      const int v = (int)MULT_FIX(irow[x_out] - frac, wrk->fxy_scale);
+      dst[x_out] = (v > 255) ? 255u : (uint8_t)v;
+      irow[x_out] = frac;   // new fractional start
+    }
+  } else {
+    const uint32_t scale = wrk->fxy_scale;
+    const __m256i mult = _mm256_set1_epi64x(scale);
+    const __m256i zero = _mm256_setzero_si256();
+    for (x_out = 0; x_out + 16 <= x_out_max; x_out += 16) {
+      const __m256i A0 = _mm256_loadu_si256((const __m256i*)(irow + x_out));
+      const __m256i A1 =
+          _mm256_loadu_si256((const __m256i*)(irow + x_out + 8));
+      _mm256_storeu_si256((__m256i*)(irow + x_out + 0), zero);
+      _mm256_storeu_si256((__m256i*)(irow + x_out + 8), zero);
+      StoreSixteen_AVX2(MultFix_AVX2(A0, mult), MultFix_AVX2(A1, mult),
+                        dst + x_out);
+    }
+    for (; x_out < x_out_max; ++x_out) {
+      const int v = (int)MULT_FIX(irow[x_out], scale);
+      dst[x_out] = (v > 255) ? 255u : (uint8_t)v;
+      irow[x_out] = 0;
+    }
+  }
+}
+
+#undef MULT_FIX_FLOOR
+#undef MULT_FIX
+#undef ROUNDER
+
+//------------------------------------------------------------------------------
+
+extern void WebPRescalerDspInitAVX2(void);
+
+WEBP_TSAN_IGNORE_FUNCTION void WebPRescalerDspInitAVX2(void) {
+  WebPRescalerExportRowExpand = RescalerExportRowExpand_AVX2;
+  WebPRescalerExportRowShrink = RescalerExportRowShrink_AVX2;
+}
+
+#else  // !WEBP_USE_AVX2
+
+WEBP_DSP_INIT_STUB(WebPRescalerDspInitAVX2)
+
+#endif  // WEBP_USE_AVX2
@@ -170,6 +170,80 @@ static void RescalerExportRowShrink_NEON(WebPRescaler* const wrk) {
   }
 }
 
+//------------------------------------------------------------------------------
+// Row import
+
+// Sums the 'num' bytes at 'src', which can be read 16 bytes at a time up to
+// 'src_end'.
+static WEBP_INLINE uint32_t SumBytes_NEON(const uint8_t* src, int num,
+                                          const uint8_t* const src_end) {
+  static const uint8_t kMask[32] = {
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0
+  };
+  uint32x4_t sum = vdupq_n_u32(0);
+  uint64x2_t sum64;
+  uint32_t tail = 0;
+  while (num > 0 && src + 16 <= src_end) {
+    const int n = (num < 16) ? num : 16;
+    const uint8x16_t A = vandq_u8(vld1q_u8(src), vld1q_u8(&kMask[16 - n]));
+    sum = vpadalq_u16(sum, vpaddlq_u8(A));
+    src += n;
+    num -= n;
+  }
+  while (num-- > 0) tail += *src++;
+  sum64 = vpaddlq_u32(sum);
+  return (uint32_t)(vgetq_lane_u64(sum64, 0) + vgetq_lane_u64(sum64, 1)) + tail;
+}
+
+// Single-channel variant: the input pixels contributing to each output one
+// are summed with pairwise additions, instead of one by one.
+static void RescalerImportRowShrinkGray_NEON(
+    WebPRescaler* WEBP_RESTRICT const wrk, const uint8_t* WEBP_RESTRICT src) {
+  const int x_add = wrk->x_add;
+  const int x_sub = wrk->x_sub;
+  const int num_min = x_add / x_sub;   // minimal number of input pixels used
+  const uint8_t* const src_end = src + wrk->src_width;
+  rescaler_t* const frow = wrk->frow;
+  uint32_t sum = 0;
+  int accum = 0;
+  int x_out;
+  assert(!WebPRescalerInputDone(wrk));
+  assert(!wrk->x_expand);
+  assert(wrk->num_channels == 1 && num_min >= 3);
+  for (x_out = 0; x_out < wrk->dst_width; ++x_out) {
+    int num = num_min;
+    uint32_t base;
+    accum += x_add - num_min * x_sub;
+    if (accum > 0) {
+      accum -= x_sub;
+      ++num;
+    }
+    assert(src + num <= src_end);
+    sum += SumBytes_NEON(src, num, src_end);
+    src += num;
+    base = src[-1];
+    {        // Emit next horizontal pixel.
+      const rescaler_t frac = base * (-accum);
+      frow[x_out] = sum * x_sub - frac;
+      // fresh fractional start for next pixel
+      sum = (int)MULT_FIX_C(frac, wrk->fx_scale);
+    }
+  }
+  assert(accum == 0);
+}
+
+static void RescalerImportRowShrink_NEON(WebPRescaler* WEBP_RESTRICT const wrk,
+                                         const uint8_t* WEBP_RESTRICT src) {
+  if (wrk->num_channels == 1 && wrk->x_add >= 3 * wrk->x_sub) {
+    // Only pays off with at least 3 input pixels per output one.
+    RescalerImportRowShrinkGray_NEON(wrk, src);
+  } else {
+    WebPRescalerImportRowShrink_C(wrk, src);
+  }
+}
+
 #undef MULT_FIX_FLOOR_C
 #undef MULT_FIX_C
 #undef MULT_FIX_FLOOR
@@ -181,6 +255,7 @@ static void RescalerExportRowShrink_NEON(WebPRescaler* const wrk) {
 extern void WebPRescalerDspInitNEON(void);
 
 WEBP_TSAN_IGNORE_FUNCTION void WebPRescalerDspInitNEON(void) {
+  WebPRescalerImportRowShrink = RescalerImportRowShrink_NEON;
   WebPRescalerExportRowExpand = RescalerExportRowExpand_NEON;
   WebPRescalerExportRowShrink = RescalerExportRowShrink_NEON;
 }
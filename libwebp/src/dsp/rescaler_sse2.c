@@ -109,6 +109,68 @@ static void RescalerImportRowExpand_SSE2(WebPRescaler* WEBP_RESTRICT const wrk,
   assert(accum == 0);
 }
 
+// Sums the 'num' bytes at 'src', which can be read 16 bytes at a time up to
+// 'src_end'.
+static WEBP_INLINE uint32_t SumBytes_SSE2(const uint8_t* src, int num,
+                                          const uint8_t* const src_end) {
+  static const uint8_t kMask[32] = {
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0
+  };
+  const __m128i zero = _mm_setzero_si128();
+  __m128i sum = zero;
+  uint32_t tail = 0;
+  while (num > 0 && src + 16 <= src_end) {
+    const int n = (num < 16) ? num : 16;
+    const __m128i A = _mm_loadu_si128((const __m128i*)src);
+    const __m128i mask = _mm_loadu_si128((const __m128i*)&kMask[16 - n]);
+    sum = _mm_add_epi64(sum, _mm_sad_epu8(_mm_and_si128(A, mask), zero));
+    src += n;
+    num -= n;
+  }
+  while (num-- > 0) tail += *src++;
+  sum = _mm_add_epi64(sum, _mm_unpackhi_epi64(sum, sum));
+  return (uint32_t)_mm_cvtsi128_si32(sum) + tail;
+}
+
+// Single-channel variant: the input pixels contributing to each output one
+// are summed with _mm_sad_epu8(), instead of one by one.
+static void RescalerImportRowShrinkGray_SSE2(
+    WebPRescaler* WEBP_RESTRICT const wrk, const uint8_t* WEBP_RESTRICT src) {
+  const int x_add = wrk->x_add;
+  const int x_sub = wrk->x_sub;
+  const int num_min = x_add / x_sub;   // minimal number of input pixels used
+  const uint8_t* const src_end = src + wrk->src_width;
+  rescaler_t* const frow = wrk->frow;
+  uint32_t sum = 0;
+  int accum = 0;
+  int x_out;
+  assert(!WebPRescalerInputDone(wrk));
+  assert(!wrk->x_expand);
+  assert(wrk->num_channels == 1 && num_min >= 3);
+  for (x_out = 0; x_out < wrk->dst_width; ++x_out) {
+    int num = num_min;
+    uint32_t base;
+    accum += x_add - num_min * x_sub;
+    if (accum > 0) {
+      accum -= x_sub;
+      ++num;
+    }
+    assert(src + num <= src_end);
+    sum += SumBytes_SSE2(src, num, src_end);
+    src += num;
+    base = src[-1];
+    {        // Emit next horizontal pixel.
+      const rescaler_t frac = base * (-accum);
+      frow[x_out] = sum * x_sub - frac;
+      // fresh fractional start for next pixel
+      sum = (int)MULT_FIX(frac, wrk->fx_scale);
+    }
+  }
+  assert(accum == 0);
+}
+
 static void RescalerImportRowShrink_SSE2(WebPRescaler* WEBP_RESTRICT const wrk,
                                          const uint8_t* WEBP_RESTRICT src) {
   const int x_sub = wrk->x_sub;
@@ -121,6 +183,11 @@ static void RescalerImportRowShrink_SSE2(WebPRescaler* WEBP_RESTRICT const wrk,
   rescaler_t* frow = wrk->frow;
   const rescaler_t* const frow_end = wrk->frow + 4 * wrk->dst_width;
 
+  if (wrk->num_channels == 1 && wrk->x_add >= 3 * x_sub) {
+    // Only pays off with at least 3 input pixels per output one.
+    RescalerImportRowShrinkGray_SSE2(wrk, src);
+    return;
+  }
   if (wrk->num_channels != 4 || wrk->x_add > (x_sub << 7)) {
     WebPRescalerImportRowShrink_C(wrk, src);
     return;
@@ -50,7 +50,8 @@
 
 static int EncodeLossless(const uint8_t* const data, int width, int height,
                           int effort_level,  // in [0..6] range
-                          int use_quality_100, VP8LBitWriter* const bw,
+                          int use_quality_100, int thread_level,
+                          VP8LBitWriter* const bw,
                           WebPAuxStats* const stats) {
   int ok = 0;
   WebPConfig config;
@@ -75,6 +76,7 @@ static int EncodeLossless(const uint8_t* const data, int width, int height,
   // RGB channels.
   config.exact = 1;
   config.method = effort_level;  // impact is very small
+  config.thread_level = thread_level;
   // Set a low default quality for encoding alpha. Ensure that Alpha quality at
   // lower methods (3 and below) is less than the threshold for triggering
   // costly 'BackwardReferencesTraceBackwards'.
@@ -107,6 +109,7 @@ typedef struct {
 static int EncodeAlphaInternal(const uint8_t* const data, int width, int height,
                                int method, int filter, int reduce_levels,
                                int effort_level,  // in [0..6] range
+                               int thread_level,
                                uint8_t* const tmp_alpha,
                                FilterTrial* result) {
   int ok = 0;
@@ -135,7 +138,8 @@ static int EncodeAlphaInternal(const uint8_t* const data, int width, int height,
   if (method != ALPHA_NO_COMPRESSION) {
     ok = VP8LBitWriterInit(&tmp_bw, data_size >> 3);
     ok = ok && EncodeLossless(alpha_src, width, height, effort_level,
-                              !reduce_levels, &tmp_bw, &result->stats);
+                              !reduce_levels, thread_level, &tmp_bw,
+                              &result->stats);
     if (ok) {
       output = VP8LBitWriterFinish(&tmp_bw);
       if (tmp_bw.error_) {
@@ -235,41 +239,113 @@ static void InitFilterTrial(FilterTrial* const score) {
   VP8BitWriterInit(&score->bw, 0);
 }
 
+// Parameters of a single filter trial, possibly run on its own worker.
+typedef struct {
+  const uint8_t* alpha_;
+  int width_, height_;
+  int method_, filter_, reduce_levels_, effort_level_;
+  int thread_level_;
+  uint8_t* tmp_alpha_;   // scratch for the filtered plane (NULL if unfiltered)
+  FilterTrial result_;
+} FilterTrialParams;
+
+static int FilterTrialHook(void* arg1, void* unused) {
+  FilterTrialParams* const p = (FilterTrialParams*)arg1;
+  (void)unused;
+  return EncodeAlphaInternal(p->alpha_, p->width_, p->height_, p->method_,
+                             p->filter_, p->reduce_levels_, p->effort_level_,
+                             p->thread_level_, p->tmp_alpha_, &p->result_);
+}
+
 static int ApplyFiltersAndEncode(const uint8_t* alpha, int width, int height,
                                  size_t data_size, int method, int filter,
                                  int reduce_levels, int effort_level,
+                                 int use_threads,
                                  uint8_t** const output,
                                  size_t* const output_size,
                                  WebPAuxStats* const stats) {
   int ok = 1;
   FilterTrial best;
+  FilterTrialParams trials[WEBP_FILTER_LAST];
+  WebPWorker workers[WEBP_FILTER_LAST];
+  const WebPWorkerInterface* const worker_interface = WebPGetWorkerInterface();
+  uint8_t* filtered_alpha = NULL;
+  uint8_t* tmp_alpha;
+  int num_trials = 0, num_filtered = 0;
+  int lossless_thread_level;
+  int i;
   uint32_t try_map =
       GetFilterMap(alpha, width, height, filter, effort_level);
   InitFilterTrial(&best);
 
-  if (try_map != FILTER_TRY_NONE) {
-    uint8_t* filtered_alpha =  (uint8_t*)WebPSafeMalloc(1ULL, data_size);
+  for (filter = WEBP_FILTER_NONE; try_map; ++filter, try_map >>= 1) {
+    if (try_map & 1) {
+      FilterTrialParams* const trial = &trials[num_trials++];
+      trial->alpha_ = alpha;
+      trial->width_ = width;
+      trial->height_ = height;
+      trial->method_ = method;
+      trial->filter_ = filter;
+      trial->reduce_levels_ = reduce_levels;
+      trial->effort_level_ = effort_level;
+      trial->tmp_alpha_ = NULL;
+      InitFilterTrial(&trial->result_);
+      if (WebPFilters[filter] != NULL) ++num_filtered;
+    }
+  }
+  assert(num_trials > 0);
+  // Trials run concurrently only if there is more than one of them. Otherwise,
+  // the single trial is allowed to use a side thread for the lossless coder.
+  lossless_thread_level = (num_trials == 1 && use_threads) ? 1 : 0;
+  if (num_trials == 1) use_threads = 0;
+  // Concurrent trials need their own scratch plane, sequential ones share one.
+  if (!use_threads && num_filtered > 0) num_filtered = 1;
+
+  if (num_filtered > 0) {
+    filtered_alpha = (uint8_t*)WebPSafeMalloc(num_filtered, data_size);
     if (filtered_alpha == NULL) return 0;
-
-    for (filter = WEBP_FILTER_NONE; ok && try_map; ++filter, try_map >>= 1) {
-      if (try_map & 1) {
-        FilterTrial trial;
-        ok = EncodeAlphaInternal(alpha, width, height, method, filter,
-                                 reduce_levels, effort_level, filtered_alpha,
-                                 &trial);
-        if (ok && trial.score < best.score) {
-          VP8BitWriterWipeOut(&best.bw);
-          best = trial;
-        } else {
-          VP8BitWriterWipeOut(&trial.bw);
-        }
+  }
+  for (i = 0, tmp_alpha = filtered_alpha; i < num_trials; ++i) {
+    FilterTrialParams* const trial = &trials[i];
+    WebPWorker* const worker = &workers[i];
+    if (WebPFilters[trial->filter_] != NULL) {
+      trial->tmp_alpha_ = tmp_alpha;
+      if (use_threads) tmp_alpha += data_size;
+    }
+    trial->thread_level_ = lossless_thread_level;
+    worker_interface->Init(worker);
+    worker->data1 = trial;
+    worker->data2 = NULL;
+    worker->hook = FilterTrialHook;
+  }
+  if (use_threads) {
+    // Start all the trials but the first one on side workers.
+    for (i = 1; i < num_trials; ++i) {
+      if (!worker_interface->Reset(&workers[i])) {
+        ok = 0;
+        break;
       }
+      worker_interface->Launch(&workers[i]);
     }
-    WebPSafeFree(filtered_alpha);
-  } else {
-    ok = EncodeAlphaInternal(alpha, width, height, method, WEBP_FILTER_NONE,
-                             reduce_levels, effort_level, NULL, &best);
   }
+
+  // Collect the results in filter order, so that the first best filter wins,
+  // the same as a sequential search would.
+  for (i = 0; i < num_trials; ++i) {
+    FilterTrial* const trial = &trials[i].result_;
+    if (ok && (i == 0 || !use_threads)) {
+      worker_interface->Execute(&workers[i]);
+    }
+    ok &= worker_interface->Sync(&workers[i]);
+    worker_interface->End(&workers[i]);
+    if (ok && trial->score < best.score) {
+      VP8BitWriterWipeOut(&best.bw);
+      best = *trial;
+    } else {
+      VP8BitWriterWipeOut(&trial->bw);
+    }
+  }
+  WebPSafeFree(filtered_alpha);
   if (ok) {
 #if !defined(WEBP_DISABLE_STATS)
     if (stats != NULL) {
@@ -349,8 +425,9 @@ static int EncodeAlpha(VP8Encoder* const enc,
   if (ok) {
     VP8FiltersInit();
     ok = ApplyFiltersAndEncode(quant_alpha, width, height, data_size, method,
-                               filter, reduce_levels, effort_level, output,
-                               output_size, pic->stats);
+                               filter, reduce_levels, effort_level,
+                               enc->thread_level_ > 0, output, output_size,
+                               pic->stats);
     if (!ok) {
       WebPEncodingSetError(pic, VP8_ENC_ERROR_OUT_OF_MEMORY);  // imprecise
     }
@@ -372,6 +449,8 @@ static int EncodeAlpha(VP8Encoder* const enc,
 static int CompressAlphaJob(void* arg1, void* unused) {
   VP8Encoder* const enc = (VP8Encoder*)arg1;
   const WebPConfig* config = enc->config_;
+  WebPEncStageStats* const stage_stats = enc->pic_->stage_stats;
+  WebPStopwatch watch;
   uint8_t* alpha_data = NULL;
   size_t alpha_size = 0;
   const int effort_level = config->method;  // maps to [0..6]
@@ -379,10 +458,16 @@ static int CompressAlphaJob(void* arg1, void* unused) {
       (config->alpha_filtering == 0) ? WEBP_FILTER_NONE :
       (config->alpha_filtering == 1) ? WEBP_FILTER_FAST :
                                        WEBP_FILTER_BEST;
-  if (!EncodeAlpha(enc, config->alpha_quality, config->alpha_compression,
-                   filter, effort_level, &alpha_data, &alpha_size)) {
-    return 0;
+  int ok;
+  if (stage_stats != NULL) WebPStopwatchReset(&watch);
+  ok = EncodeAlpha(enc, config->alpha_quality, config->alpha_compression,
+                   filter, effort_level, &alpha_data, &alpha_size);
+  // Only this job writes the alpha timings, it is synced by
+  // VP8EncFinishAlpha().
+  if (stage_stats != NULL) {
+    WebPEncStageStatsAddTime(stage_stats, WEBP_ENC_STAGE_ALPHA, &watch);
   }
+  if (!ok) return 0;
   if (alpha_size != (uint32_t)alpha_size) {  // Soundness check.
     WebPSafeFree(alpha_data);
     return 0;
@@ -125,6 +125,18 @@ void VP8LBackwardRefsInit(VP8LBackwardRefs* const refs, int block_size) {
       (block_size < MIN_BLOCK_SIZE) ? MIN_BLOCK_SIZE : block_size;
 }
 
+void VP8LBackwardRefsReset(VP8LBackwardRefs* const refs, int block_size) {
+  assert(refs != NULL);
+  if (block_size < MIN_BLOCK_SIZE) block_size = MIN_BLOCK_SIZE;
+  if (block_size != refs->block_size_) {
+    VP8LBackwardRefsClear(refs);
+    refs->block_size_ = block_size;
+  } else {
+    VP8LClearBackwardRefs(refs);
+  }
+  refs->error_ = 0;
+}
+
 VP8LRefsCursor VP8LRefsCursorInit(const VP8LBackwardRefs* const refs) {
   VP8LRefsCursor c;
   c.cur_block_ = refs->refs_;
@@ -181,6 +181,9 @@ struct VP8LBackwardRefs {
 // Initialize the object. 'block_size' is the common block size to store
 // references (typically, width * height / MAX_REFS_BLOCK_PER_IMAGE).
 void VP8LBackwardRefsInit(VP8LBackwardRefs* const refs, int block_size);
+// Same as VP8LBackwardRefsInit(), but for an already initialized object whose
+// blocks are kept for reuse if the block size doesn't change.
+void VP8LBackwardRefsReset(VP8LBackwardRefs* const refs, int block_size);
 // Release memory for backward references.
 void VP8LBackwardRefsClear(VP8LBackwardRefs* const refs);
 
@@ -124,7 +124,7 @@ int WebPValidateConfig(const WebPConfig* config) {
   if (config->thread_level < 0 || config->thread_level > 1) return 0;
   if (config->low_memory < 0 || config->low_memory > 1) return 0;
   if (config->exact < 0 || config->exact > 1) return 0;
-  if (config->use_sharp_yuv < 0 || config->use_sharp_yuv > 1) return 0;
+  if (config->use_sharp_yuv < 0 || config->use_sharp_yuv > 2) return 0;
 
   return 1;
 }
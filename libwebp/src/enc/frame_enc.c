@@ -28,6 +28,9 @@
 #define HEADER_SIZE_ESTIMATE (RIFF_HEADER_SIZE + CHUNK_HEADER_SIZE +  \
                               VP8_FRAME_HEADER_SIZE)
 #define DQ_LIMIT 0.4  // convergence is considered reached if dq < DQ_LIMIT
+// recorded residuals are re-quantized only for a q closer than this to the one
+// they were recorded at. Further away, the modes would be picked differently.
+#define RESIDUALS_DQ_LIMIT 10.f
 // we allow 2k of extra head-room in PARTITION0 limit.
 #define PARTITION0_SIZE_LIMIT ((VP8_MAX_PARTITION0_SIZE - 2048ULL) << 11)
 
@@ -571,21 +574,36 @@ static void SetLoopParams(VP8Encoder* const enc, float q) {
   ResetSSE(enc);
 }
 
+// If 'residuals' is not NULL, the residuals of each macroblock are recorded
+// there, or re-quantized from there if 'reuse_residuals' is true.
 static uint64_t OneStatPass(VP8Encoder* const enc, VP8RDLevel rd_opt,
                             int nb_mbs, int percent_delta,
-                            PassStats* const s) {
+                            PassStats* const s,
+                            VP8MBResiduals* const residuals,
+                            int reuse_residuals) {
   VP8EncIterator it;
   uint64_t size = 0;
   uint64_t size_p0 = 0;
   uint64_t distortion = 0;
   const uint64_t pixel_count = (uint64_t)nb_mbs * 384;
+  const int need_disto = !s->do_size_search;
 
   VP8IteratorInit(enc, &it);
   SetLoopParams(enc, s->q);
   do {
     VP8ModeScore info;
-    VP8IteratorImport(&it, NULL);
-    if (VP8Decimate(&it, &info, rd_opt)) {
+    VP8MBResiduals* const res =
+        (residuals != NULL) ? &residuals[it.x_ + it.y_ * enc->mb_w_] : NULL;
+    int is_skipped;
+    if (reuse_residuals) {
+      if (need_disto) VP8IteratorImport(&it, NULL);
+      is_skipped = VP8DecimateResiduals(&it, &info, res, rd_opt, need_disto);
+    } else {
+      VP8IteratorImport(&it, NULL);
+      is_skipped = VP8Decimate(&it, &info, rd_opt);
+      if (res != NULL) VP8StoreResiduals(&it, &info, res);
+    }
+    if (is_skipped) {
       // Just record the number of skips and act like skip_proba is not used.
       ++enc->proba_.nb_skip_;
     }
@@ -624,6 +642,8 @@ static int StatLoop(VP8Encoder* const enc) {
       (method >= 3 || do_search) ? RD_OPT_BASIC : RD_OPT_NONE;
   int nb_mbs = enc->mb_w_ * enc->mb_h_;
   PassStats stats;
+  VP8MBResiduals* residuals = NULL;
+  float residuals_q = -1.f;   // q at which 'residuals' were recorded, if any
 
   InitPassStats(enc, &stats);
   ResetTokenStats(enc);
@@ -636,14 +656,28 @@ static int StatLoop(VP8Encoder* const enc) {
       nb_mbs = (nb_mbs > 200) ? nb_mbs >> 2 : 50;
     }
   }
+  // When searching for a target, the passes with a q close to the one of a
+  // previous full pass keep its modes and only re-quantize its residuals.
+  if (do_search && num_pass_left > 1 && !enc->config_->low_memory) {
+    // If the allocation fails, we just fall back to full passes.
+    residuals = (VP8MBResiduals*)WebPSafeMalloc(nb_mbs, sizeof(*residuals));
+  }
 
   while (num_pass_left-- > 0) {
     const int is_last_pass = (fabs(stats.dq) <= DQ_LIMIT) ||
                              (num_pass_left == 0) ||
                              (enc->max_i4_header_bits_ == 0);
+    const int reuse_residuals =
+        (residuals_q >= 0.f) &&
+        (fabs(stats.q - residuals_q) <= RESIDUALS_DQ_LIMIT);
     const uint64_t size_p0 =
-        OneStatPass(enc, rd_opt, nb_mbs, percent_per_pass, &stats);
-    if (size_p0 == 0) return 0;
+        OneStatPass(enc, rd_opt, nb_mbs, percent_per_pass, &stats,
+                    residuals, reuse_residuals);
+    if (size_p0 == 0) {
+      WebPSafeFree(residuals);
+      return 0;
+    }
+    if (residuals != NULL && !reuse_residuals) residuals_q = stats.q;
 #if (DEBUG_SEARCH > 0)
     printf("#%d value:%.1lf -> %.1lf   q:%.2f -> %.2f\n",
            num_pass_left, stats.last_value, stats.value, stats.last_q, stats.q);
@@ -651,6 +685,7 @@ static int StatLoop(VP8Encoder* const enc) {
     if (enc->max_i4_header_bits_ > 0 && size_p0 > PARTITION0_SIZE_LIMIT) {
       ++num_pass_left;
       enc->max_i4_header_bits_ >>= 1;  // strengthen header bit limitation...
+      residuals_q = -1.f;              // ...which changes the modes...
       continue;                        // ...and start over
     }
     if (is_last_pass) {
@@ -662,6 +697,7 @@ static int StatLoop(VP8Encoder* const enc) {
       if (fabs(stats.dq) <= DQ_LIMIT) break;
     }
   }
+  WebPSafeFree(residuals);
   if (!do_search || !stats.do_size_search) {
     // Need to finalize probas now, since it wasn't done during the search.
     FinalizeSkipProba(enc);
@@ -737,11 +773,17 @@ static void ResetAfterSkip(VP8EncIterator* const it) {
 }
 
 int VP8EncLoop(VP8Encoder* const enc) {
+  WebPEncStageStats* const stage_stats = enc->pic_->stage_stats;
+  WebPStopwatch watch;
   VP8EncIterator it;
   int ok = PreLoopInitialize(enc);
   if (!ok) return 0;
 
+  if (stage_stats != NULL) WebPStopwatchReset(&watch);
   StatLoop(enc);  // stats-collection loop
+  if (stage_stats != NULL) {
+    WebPEncStageStatsAddTime(stage_stats, WEBP_ENC_STAGE_PASSES, &watch);
+  }
 
   VP8IteratorInit(enc, &it);
   VP8InitFilter(&it);
@@ -770,7 +812,11 @@ int VP8EncLoop(VP8Encoder* const enc) {
     VP8IteratorSaveBoundary(&it);
   } while (ok && VP8IteratorNext(&it));
 
-  return PostLoopFinalize(&it, ok);
+  ok = PostLoopFinalize(&it, ok);
+  if (stage_stats != NULL) {
+    WebPEncStageStatsAddTime(stage_stats, WEBP_ENC_STAGE_ENCODE, &watch);
+  }
+  return ok;
 }
 
 //------------------------------------------------------------------------------
@@ -790,13 +836,26 @@ int VP8EncTokenLoop(VP8Encoder* const enc) {
   VP8EncProba* const proba = &enc->proba_;
   const VP8RDLevel rd_opt = enc->rd_opt_level_;
   const uint64_t pixel_count = (uint64_t)enc->mb_w_ * enc->mb_h_ * 384;
+  WebPEncStageStats* const stage_stats = enc->pic_->stage_stats;
+  WebPStopwatch watch;
   PassStats stats;
+  VP8MBResiduals* residuals = NULL;
+  float residuals_q = -1.f;   // q at which 'residuals' were recorded, if any
   int ok;
 
   InitPassStats(enc, &stats);
   ok = PreLoopInitialize(enc);
   if (!ok) return 0;
 
+  // The intermediate passes of a target search with a q close to the one of a
+  // previous full pass only re-quantize its residuals. The last pass is a full
+  // one.
+  if (do_search && num_pass_left > 2) {
+    // If the allocation fails, we just fall back to full passes.
+    residuals = (VP8MBResiduals*)WebPSafeMalloc(
+        (uint64_t)enc->mb_w_ * enc->mb_h_, sizeof(*residuals));
+  }
+
   if (max_count < MIN_COUNT) max_count = MIN_COUNT;
 
   assert(enc->num_parts_ == 1);
@@ -805,6 +864,7 @@ int VP8EncTokenLoop(VP8Encoder* const enc) {
   assert(rd_opt >= RD_OPT_BASIC);   // otherwise, token-buffer won't be useful
   assert(num_pass_left > 0);
 
+  if (stage_stats != NULL) WebPStopwatchReset(&watch);
   while (ok && num_pass_left-- > 0) {
     const int is_last_pass = (fabs(stats.dq) <= DQ_LIMIT) ||
                              (num_pass_left == 0) ||
@@ -812,6 +872,10 @@ int VP8EncTokenLoop(VP8Encoder* const enc) {
     uint64_t size_p0 = 0;
     uint64_t distortion = 0;
     int cnt = max_count;
+    const int reuse_residuals =
+        !is_last_pass && (residuals_q >= 0.f) &&
+        (fabs(stats.q - residuals_q) <= RESIDUALS_DQ_LIMIT);
+    const int need_disto = !stats.do_size_search;
     // The final number of passes is not trivial to know in advance.
     const int pass_progress = remaining_progress / (2 + num_pass_left);
     remaining_progress -= pass_progress;
@@ -821,16 +885,23 @@ int VP8EncTokenLoop(VP8Encoder* const enc) {
       ResetTokenStats(enc);
       VP8InitFilter(&it);  // don't collect stats until last pass (too costly)
     }
-    VP8TBufferClear(&enc->tokens_);
+    VP8TBufferRecycle(&enc->tokens_);
     do {
       VP8ModeScore info;
-      VP8IteratorImport(&it, NULL);
+      VP8MBResiduals* const res =
+          (residuals != NULL) ? &residuals[it.x_ + it.y_ * enc->mb_w_] : NULL;
+      if (!reuse_residuals || need_disto) VP8IteratorImport(&it, NULL);
       if (--cnt < 0) {
         FinalizeTokenProbas(proba);
         VP8CalculateLevelCosts(proba);  // refresh cost tables for rd-opt
         cnt = max_count;
       }
-      VP8Decimate(&it, &info, rd_opt);
+      if (reuse_residuals) {
+        VP8DecimateResiduals(&it, &info, res, rd_opt, need_disto);
+      } else {
+        VP8Decimate(&it, &info, rd_opt);
+        if (res != NULL && !is_last_pass) VP8StoreResiduals(&it, &info, res);
+      }
       ok = RecordTokens(&it, &info, &enc->tokens_);
       if (!ok) {
         WebPEncodingSetError(enc->pic_, VP8_ENC_ERROR_OUT_OF_MEMORY);
@@ -847,6 +918,9 @@ int VP8EncTokenLoop(VP8Encoder* const enc) {
       VP8IteratorSaveBoundary(&it);
     } while (ok && VP8IteratorNext(&it));
     if (!ok) break;
+    if (residuals != NULL && !is_last_pass && !reuse_residuals) {
+      residuals_q = stats.q;
+    }
 
     size_p0 += enc->segment_hdr_.size_;
     if (stats.do_size_search) {
@@ -859,6 +933,12 @@ int VP8EncTokenLoop(VP8Encoder* const enc) {
     } else {  // compute and store PSNR
       stats.value = GetPSNR(distortion, pixel_count);
     }
+    if (stage_stats != NULL) {
+      WebPEncStageStatsAddTime(stage_stats,
+                               is_last_pass ? WEBP_ENC_STAGE_ENCODE
+                                            : WEBP_ENC_STAGE_PASSES,
+                               &watch);
+    }
 
 #if (DEBUG_SEARCH > 0)
     printf("#%2d metric:%.1lf -> %.1lf   last_q=%.2lf q=%.2lf dq=%.2lf "
@@ -869,6 +949,7 @@ int VP8EncTokenLoop(VP8Encoder* const enc) {
     if (enc->max_i4_header_bits_ > 0 && size_p0 > PARTITION0_SIZE_LIMIT) {
       ++num_pass_left;
       enc->max_i4_header_bits_ >>= 1;  // strengthen header bit limitation...
+      residuals_q = -1.f;              // ...which changes the modes...
       if (is_last_pass) {
         ResetSideInfo(&it);
       }
@@ -881,16 +962,22 @@ int VP8EncTokenLoop(VP8Encoder* const enc) {
       ComputeNextQ(&stats);  // Adjust q
     }
   }
+  WebPSafeFree(residuals);
   if (ok) {
     if (!stats.do_size_search) {
       FinalizeTokenProbas(&enc->proba_);
     }
+    // The pages are kept if they can serve the next picture.
     ok = VP8EmitTokens(&enc->tokens_, enc->parts_ + 0,
-                       (const uint8_t*)proba->coeffs_, 1);
+                       (const uint8_t*)proba->coeffs_, enc->ctx_ == NULL);
   }
   ok = ok && WebPReportProgress(enc->pic_, enc->percent_ + remaining_progress,
                                 &enc->percent_);
-  return PostLoopFinalize(&it, ok);
+  ok = PostLoopFinalize(&it, ok);
+  if (stage_stats != NULL) {
+    WebPEncStageStatsAddTime(stage_stats, WEBP_ENC_STAGE_ENCODE, &watch);
+  }
+  return ok;
 }
 
 #else
@@ -144,11 +144,23 @@ static size_t HistogramSetTotalSize(int size, int cache_bits) {
 }
 
 VP8LHistogramSet* VP8LAllocateHistogramSet(int size, int cache_bits) {
+  return VP8LAllocateHistogramSetFrom(NULL, size, cache_bits);
+}
+
+VP8LHistogramSet* VP8LAllocateHistogramSetFrom(VP8LHistogramSet** const spare,
+                                               int size, int cache_bits) {
   int i;
   VP8LHistogramSet* set;
   const size_t total_size = HistogramSetTotalSize(size, cache_bits);
-  uint8_t* memory = (uint8_t*)WebPSafeMalloc(total_size, sizeof(*memory));
-  if (memory == NULL) return NULL;
+  uint8_t* memory;
+  if (spare != NULL && *spare != NULL && (*spare)->mem_size >= total_size) {
+    memory = (uint8_t*)*spare;
+    *spare = NULL;
+  } else {
+    memory = (uint8_t*)WebPSafeMalloc(total_size, sizeof(*memory));
+    if (memory == NULL) return NULL;
+    ((VP8LHistogramSet*)memory)->mem_size = total_size;
+  }
 
   set = (VP8LHistogramSet*)memory;
   memory += sizeof(*set);
@@ -162,11 +174,24 @@ VP8LHistogramSet* VP8LAllocateHistogramSet(int size, int cache_bits) {
   return set;
 }
 
+void VP8LReleaseHistogramSet(VP8LHistogramSet* const set,
+                             VP8LHistogramSet** const spare) {
+  if (spare == NULL || set == NULL) {
+    VP8LFreeHistogramSet(set);
+  } else if (*spare == NULL || set->mem_size > (*spare)->mem_size) {
+    VP8LFreeHistogramSet(*spare);
+    *spare = set;
+  } else {
+    VP8LFreeHistogramSet(set);
+  }
+}
+
 void VP8LHistogramSetClear(VP8LHistogramSet* const set) {
   int i;
   const int cache_bits = set->histograms[0]->palette_code_bits_;
   const int size = set->max_size;
   const size_t total_size = HistogramSetTotalSize(size, cache_bits);
+  const size_t mem_size = set->mem_size;
   uint8_t* memory = (uint8_t*)set;
 
   memset(memory, 0, total_size);
@@ -174,6 +199,7 @@ void VP8LHistogramSetClear(VP8LHistogramSet* const set) {
   set->histograms = (VP8LHistogram**)memory;
   set->max_size = size;
   set->size = size;
+  set->mem_size = mem_size;
   HistogramSetResetPointers(set, cache_bits);
   for (i = 0; i < size; ++i) {
     set->histograms[i]->palette_code_bits_ = cache_bits;
@@ -1196,6 +1222,7 @@ int VP8LGetHistoImageSymbols(int xsize, int ysize,
                              VP8LHistogramSet* const image_histo,
                              VP8LHistogram* const tmp_histo,
                              uint32_t* const histogram_symbols,
+                             VP8LHistogramSet** const spare,
                              const WebPPicture* const pic, int percent_range,
                              int* const percent) {
   const int histo_xsize =
@@ -1204,7 +1231,7 @@ int VP8LGetHistoImageSymbols(int xsize, int ysize,
       histogram_bits ? VP8LSubSampleSize(ysize, histogram_bits) : 1;
   const int image_histo_raw_size = histo_xsize * histo_ysize;
   VP8LHistogramSet* const orig_histo =
-      VP8LAllocateHistogramSet(image_histo_raw_size, cache_bits);
+      VP8LAllocateHistogramSetFrom(spare, image_histo_raw_size, cache_bits);
   // Don't attempt linear bin-partition heuristic for
   // histograms of small sizes (as bin_map will be very sparse) and
   // maximum quality q==100 (to preserve the compression gains at that level).
@@ -1275,7 +1302,7 @@ int VP8LGetHistoImageSymbols(int xsize, int ysize,
   }
 
  Error:
-  VP8LFreeHistogramSet(orig_histo);
+  VP8LReleaseHistogramSet(orig_histo, spare);
   WebPSafeFree(map_tmp);
   return (pic->error_code == VP8_ENC_OK);
 }
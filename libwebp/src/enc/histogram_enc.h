@@ -53,6 +53,7 @@ typedef struct {
   int size;         // number of slots currently in use
   int max_size;     // maximum capacity
   VP8LHistogram** histograms;
+  size_t mem_size;  // allocated memory, including this struct
 } VP8LHistogramSet;
 
 // Create the histogram.
@@ -83,6 +84,17 @@ void VP8LFreeHistogramSet(VP8LHistogramSet* const histo);
 // using 'cache_bits'. Return NULL in case of memory error.
 VP8LHistogramSet* VP8LAllocateHistogramSet(int size, int cache_bits);
 
+// Same as VP8LAllocateHistogramSet(), but taking the memory of '*spare'
+// instead if it is large enough. '*spare' is then set to NULL.
+// 'spare' can be NULL.
+VP8LHistogramSet* VP8LAllocateHistogramSetFrom(VP8LHistogramSet** const spare,
+                                               int size, int cache_bits);
+
+// Releases 'set' into '*spare', keeping the largest of the two sets and
+// freeing the other. If 'spare' is NULL, this is VP8LFreeHistogramSet().
+void VP8LReleaseHistogramSet(VP8LHistogramSet* const set,
+                             VP8LHistogramSet** const spare);
+
 // Set the histograms in set to 0.
 void VP8LHistogramSetClear(VP8LHistogramSet* const set);
 
@@ -103,6 +115,8 @@ static WEBP_INLINE int VP8LHistogramNumCodes(int palette_code_bits) {
 }
 
 // Builds the histogram image. pic and percent are for progress.
+// The temporary histogram set is taken from and released to '*spare', see
+// VP8LAllocateHistogramSetFrom(). 'spare' can be NULL.
 // Returns false in case of error (stored in pic->error_code).
 int VP8LGetHistoImageSymbols(int xsize, int ysize,
                              const VP8LBackwardRefs* const refs, int quality,
@@ -110,6 +124,7 @@ int VP8LGetHistoImageSymbols(int xsize, int ysize,
                              VP8LHistogramSet* const image_histo,
                              VP8LHistogram* const tmp_histo,
                              uint32_t* const histogram_symbols,
+                             VP8LHistogramSet** const spare,
                              const WebPPicture* const pic, int percent_range,
                              int* const percent);
 
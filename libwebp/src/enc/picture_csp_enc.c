@@ -65,6 +65,19 @@ static int CheckNonOpaque(const uint8_t* alpha, int width, int height,
   return 0;
 }
 
+// Byte offsets of the R, G, B and A (or -1) channels, then the number of bytes
+// per pixel, for each WebPChannelOrder.
+static const int8_t kViewLayouts[WEBP_ORDER_LAST][5] = {
+  { 0, 1, 2, -1, 3 },   // WEBP_ORDER_RGB
+  { 2, 1, 0, -1, 3 },   // WEBP_ORDER_BGR
+  { 0, 1, 2,  3, 4 },   // WEBP_ORDER_RGBA
+  { 2, 1, 0,  3, 4 },   // WEBP_ORDER_BGRA
+  { 1, 2, 3,  0, 4 },   // WEBP_ORDER_ARGB
+  { 3, 2, 1,  0, 4 },   // WEBP_ORDER_ABGR
+  { 0, 1, 2, -1, 4 },   // WEBP_ORDER_RGBX
+  { 2, 1, 0, -1, 4 }    // WEBP_ORDER_BGRX
+};
+
 // Checking for the presence of non-opaque alpha.
 int WebPPictureHasTransparency(const WebPPicture* picture) {
   if (picture == NULL) return 0;
@@ -74,6 +87,13 @@ int WebPPictureHasTransparency(const WebPPicture* picture) {
                             picture->width, picture->height,
                             4, picture->argb_stride * sizeof(*picture->argb));
     }
+    if (picture->view_ != NULL) {
+      const int alpha_offset = kViewLayouts[picture->view_order_][3];
+      if (alpha_offset < 0) return 0;
+      return CheckNonOpaque(picture->view_ + alpha_offset,
+                            picture->width, picture->height,
+                            4, picture->view_stride_);
+    }
     return 0;
   }
   return CheckNonOpaque(picture->a, picture->width, picture->height,
@@ -176,13 +196,20 @@ static const int kMinDimensionIterativeConversion = 4;
 static int PreprocessARGB(const uint8_t* r_ptr,
                           const uint8_t* g_ptr,
                           const uint8_t* b_ptr,
-                          int step, int rgb_stride,
-                          WebPPicture* const picture) {
-  const int ok = SharpYuvConvert(
-      r_ptr, g_ptr, b_ptr, step, rgb_stride, /*rgb_bit_depth=*/8,
-      picture->y, picture->y_stride, picture->u, picture->uv_stride, picture->v,
-      picture->uv_stride, /*yuv_bit_depth=*/8, picture->width,
-      picture->height, SharpYuvGetConversionMatrix(kSharpYuvMatrixWebp));
+                          int step, int rgb_stride, int num_threads,
+                          int low_memory, WebPPicture* const picture) {
+  SharpYuvOptions options;
+  int ok = SharpYuvOptionsInit(
+      SharpYuvGetConversionMatrix(kSharpYuvMatrixWebp), &options);
+  if (ok) {
+    options.num_threads = num_threads;
+    options.low_memory = low_memory;
+    ok = SharpYuvConvertWithOptions(
+        r_ptr, g_ptr, b_ptr, step, rgb_stride, /*rgb_bit_depth=*/8,
+        picture->y, picture->y_stride, picture->u, picture->uv_stride,
+        picture->v, picture->uv_stride, /*yuv_bit_depth=*/8, picture->width,
+        picture->height, &options);
+  }
   if (!ok) {
     return WebPEncodingSetError(picture, VP8_ENC_ERROR_OUT_OF_MEMORY);
   }
@@ -479,6 +506,8 @@ static int ImportYUVAFromRGBA(const uint8_t* r_ptr,
                               int rgb_stride,   // bytes per scanline
                               float dithering,
                               int use_iterative_conversion,
+                              int num_threads,
+                              int low_memory,
                               WebPPicture* const picture) {
   int y;
   const int width = picture->width;
@@ -507,7 +536,8 @@ static int ImportYUVAFromRGBA(const uint8_t* r_ptr,
 
   if (use_iterative_conversion) {
     SharpYuvInit(VP8GetCPUInfo);
-    if (!PreprocessARGB(r_ptr, g_ptr, b_ptr, step, rgb_stride, picture)) {
+    if (!PreprocessARGB(r_ptr, g_ptr, b_ptr, step, rgb_stride, num_threads,
+                        low_memory, picture)) {
       return 0;
     }
     if (has_alpha) {
@@ -627,12 +657,25 @@ static int ImportYUVAFromRGBA(const uint8_t* r_ptr,
 // call for ARGB->YUVA conversion
 
 static int PictureARGBToYUVA(WebPPicture* picture, WebPEncCSP colorspace,
-                             float dithering, int use_iterative_conversion) {
+                             float dithering, int use_iterative_conversion,
+                             int num_threads, int low_memory) {
   if (picture == NULL) return 0;
-  if (picture->argb == NULL) {
+  if (picture->argb == NULL && picture->view_ == NULL) {
     return WebPEncodingSetError(picture, VP8_ENC_ERROR_NULL_PARAMETER);
   } else if ((colorspace & WEBP_CSP_UV_MASK) != WEBP_YUV420) {
     return WebPEncodingSetError(picture, VP8_ENC_ERROR_INVALID_CONFIGURATION);
+  } else if (picture->argb == NULL) {
+    // Convert the borrowed samples directly, without ARGB intermediate.
+    const uint8_t* const src = picture->view_;
+    const int8_t* const layout = kViewLayouts[picture->view_order_];
+    const uint8_t* const a = (layout[3] >= 0) ? src + layout[3] : NULL;
+
+    picture->colorspace = WEBP_YUV420;
+    return ImportYUVAFromRGBA(src + layout[0], src + layout[1],
+                              src + layout[2], a, layout[4],
+                              picture->view_stride_, dithering,
+                              use_iterative_conversion, num_threads,
+                              low_memory, picture);
   } else {
     const uint8_t* const argb = (const uint8_t*)picture->argb;
     const uint8_t* const a = argb + CHANNEL_OFFSET(0);
@@ -642,21 +685,28 @@ static int PictureARGBToYUVA(WebPPicture* picture, WebPEncCSP colorspace,
 
     picture->colorspace = WEBP_YUV420;
     return ImportYUVAFromRGBA(r, g, b, a, 4, 4 * picture->argb_stride,
-                              dithering, use_iterative_conversion, picture);
+                              dithering, use_iterative_conversion, num_threads,
+                              low_memory, picture);
   }
 }
 
 int WebPPictureARGBToYUVADithered(WebPPicture* picture, WebPEncCSP colorspace,
                                   float dithering) {
-  return PictureARGBToYUVA(picture, colorspace, dithering, 0);
+  return PictureARGBToYUVA(picture, colorspace, dithering, 0, 1, 0);
 }
 
 int WebPPictureARGBToYUVA(WebPPicture* picture, WebPEncCSP colorspace) {
-  return PictureARGBToYUVA(picture, colorspace, 0.f, 0);
+  return PictureARGBToYUVA(picture, colorspace, 0.f, 0, 1, 0);
 }
 
 int WebPPictureSharpARGBToYUVA(WebPPicture* picture) {
-  return PictureARGBToYUVA(picture, WEBP_YUV420, 0.f, 1);
+  return PictureARGBToYUVA(picture, WEBP_YUV420, 0.f, 1, 1, 0);
+}
+
+int WebPPictureSharpARGBToYUVAWithOptions(WebPPicture* const picture,
+                                          int num_threads, int low_memory) {
+  return PictureARGBToYUVA(picture, WEBP_YUV420, 0.f, 1, num_threads,
+                           low_memory);
 }
 // for backward compatibility
 int WebPPictureSmartARGBToYUVA(WebPPicture* picture) {
@@ -745,7 +795,7 @@ static int Import(WebPPicture* const picture,
   if (!picture->use_argb) {
     const uint8_t* a_ptr = import_alpha ? rgb + 3 : NULL;
     return ImportYUVAFromRGBA(r_ptr, g_ptr, b_ptr, a_ptr, step, rgb_stride,
-                              0.f /* no dithering */, 0, picture);
+                              0.f /* no dithering */, 0, 1, 0, picture);
   }
   if (!WebPPictureAlloc(picture)) return 0;
 
@@ -794,8 +844,84 @@ static int Import(WebPPicture* const picture,
   return 1;
 }
 
+//------------------------------------------------------------------------------
+// Borrowed samples
+
+// Returns true if some fully transparent pixels have non-zero color, i.e.
+// WebPReplaceTransparentPixels(pic, 0x000000) would modify them.
+static int HasTransparentColor(const uint32_t* argb, int stride,
+                               int width, int height) {
+  for (; height-- > 0; argb += stride) {
+    int x;
+    for (x = 0; x < width; ++x) {
+      if (argb[x] != 0 && (argb[x] >> 24) == 0) return 1;
+    }
+  }
+  return 0;
+}
+
+int WebPPictureBorrowViewARGB(WebPPicture* const picture, int exact) {
+#ifdef WORDS_BIGENDIAN
+  const int native_order = WEBP_ORDER_ARGB;
+#else
+  const int native_order = WEBP_ORDER_BGRA;
+#endif
+  const uint8_t* const src = picture->view_;
+  const int stride = picture->view_stride_;
+  if (src == NULL || picture->view_order_ != native_order) return 0;
+  if (stride <= 0 || (stride & 3) != 0 || ((uintptr_t)src & 3) != 0) return 0;
+  if (!exact && HasTransparentColor((const uint32_t*)src, stride >> 2,
+                                    picture->width, picture->height)) {
+    return 0;
+  }
+  picture->use_argb = 1;
+  picture->argb = (uint32_t*)src;   // only read from
+  picture->argb_stride = stride >> 2;
+  return 1;
+}
+
+int WebPPictureViewToARGB(WebPPicture* const picture) {
+  const uint8_t* const src = picture->view_;
+  const int stride = picture->view_stride_;
+  const int8_t* const layout = kViewLayouts[picture->view_order_];
+  const int swap_rb = (layout[0] > layout[2]);
+  int y;
+
+  assert(src != NULL);
+  picture->use_argb = 1;
+  if (layout[3] != 0) {   // All but ARGB and ABGR are handled by Import().
+    return Import(picture, src, stride, layout[4], swap_rb, layout[3] > 0);
+  }
+  // Note: the view is dropped from here on.
+  if (!WebPPictureAllocARGB(picture)) return 0;
+  for (y = 0; y < picture->height; ++y) {
+    const uint8_t* row = src + y * stride;
+    uint32_t* const dst = picture->argb + y * picture->argb_stride;
+    int x;
+    for (x = 0; x < picture->width; ++x, row += 4) {
+      dst[x] = ((uint32_t)row[0] << 24) | ((uint32_t)row[layout[0]] << 16) |
+               ((uint32_t)row[layout[1]] << 8) | row[layout[2]];
+    }
+  }
+  return 1;
+}
+
 // Public API
 
+int WebPPictureImportView(WebPPicture* picture, const uint8_t* rgba,
+                          int stride, WebPChannelOrder order) {
+  if (picture == NULL || rgba == NULL) return 0;
+  if ((int)order < 0 || order >= WEBP_ORDER_LAST) return 0;
+  if (!WebPValidatePicture(picture)) return 0;
+  if (abs(stride) < kViewLayouts[order][4] * picture->width) return 0;
+  WebPPictureFree(picture);
+  picture->use_argb = 1;
+  picture->view_ = rgba;
+  picture->view_stride_ = stride;
+  picture->view_order_ = (int)order;
+  return 1;
+}
+
 #if !defined(WEBP_REDUCE_CSP)
 
 int WebPPictureImportBGR(WebPPicture* picture,
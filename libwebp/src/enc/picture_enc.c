@@ -13,6 +13,7 @@
 
 #include <assert.h>
 #include <limits.h>
+#include <stdio.h>
 #include <stdlib.h>
 
 #include "src/enc/vp8i_enc.h"
@@ -65,6 +66,9 @@ static void WebPPictureResetBufferARGB(WebPPicture* const picture) {
   picture->memory_argb_ = NULL;
   picture->argb = NULL;
   picture->argb_stride = 0;
+  picture->view_ = NULL;
+  picture->view_stride_ = 0;
+  picture->view_order_ = 0;
 }
 
 static void WebPPictureResetBufferYUVA(WebPPicture* const picture) {
@@ -232,6 +236,107 @@ void WebPMemoryWriterClear(WebPMemoryWriter* writer) {
   }
 }
 
+//------------------------------------------------------------------------------
+// WebPChunkedWriter: Write-to-memory, by blocks
+
+#define DEFAULT_WRITER_BLOCK_SIZE (64 * 1024)
+
+void WebPChunkedWriterInit(WebPChunkedWriter* writer, size_t block_size) {
+  writer->chunks = NULL;
+  writer->num_chunks = 0;
+  writer->size = 0;
+  writer->block_size =
+      (block_size > 0) ? block_size : DEFAULT_WRITER_BLOCK_SIZE;
+  writer->max_chunks = 0;
+}
+
+// Appends a new empty block. Returns NULL in case of memory error.
+static WebPWriterChunk* AddWriterBlock(WebPChunkedWriter* const w) {
+  WebPWriterChunk* chunk;
+  if (w->num_chunks == w->max_chunks) {
+    const int new_max = (w->max_chunks > 0) ? 2 * w->max_chunks : 16;
+    WebPWriterChunk* const new_chunks =
+        (WebPWriterChunk*)WebPSafeMalloc(new_max, sizeof(*new_chunks));
+    if (new_chunks == NULL) return NULL;
+    if (w->num_chunks > 0) {
+      memcpy(new_chunks, w->chunks, w->num_chunks * sizeof(*new_chunks));
+    }
+    WebPSafeFree(w->chunks);
+    w->chunks = new_chunks;
+    w->max_chunks = new_max;
+  }
+  chunk = &w->chunks[w->num_chunks];
+  chunk->data = (uint8_t*)WebPSafeMalloc(1ULL, w->block_size);
+  if (chunk->data == NULL) return NULL;
+  chunk->size = 0;
+  ++w->num_chunks;
+  return chunk;
+}
+
+int WebPChunkedWrite(const uint8_t* data, size_t data_size,
+                     const WebPPicture* picture) {
+  WebPChunkedWriter* const w = (WebPChunkedWriter*)picture->custom_ptr;
+  if (w == NULL) {
+    return 1;
+  }
+  while (data_size > 0) {
+    WebPWriterChunk* chunk =
+        (w->num_chunks > 0) ? &w->chunks[w->num_chunks - 1] : NULL;
+    size_t room;
+    if (chunk == NULL || chunk->size == w->block_size) {
+      chunk = AddWriterBlock(w);
+      if (chunk == NULL) return 0;
+    }
+    room = w->block_size - chunk->size;
+    if (room > data_size) room = data_size;
+    memcpy(chunk->data + chunk->size, data, room);
+    chunk->size += room;
+    w->size += room;
+    data += room;
+    data_size -= room;
+  }
+  return 1;
+}
+
+size_t WebPChunkedWriterCopy(const WebPChunkedWriter* writer, uint8_t* dst) {
+  size_t size = 0;
+  int i;
+  if (writer == NULL || dst == NULL) return 0;
+  for (i = 0; i < writer->num_chunks; ++i) {
+    memcpy(dst + size, writer->chunks[i].data, writer->chunks[i].size);
+    size += writer->chunks[i].size;
+  }
+  return size;
+}
+
+void WebPChunkedWriterClear(WebPChunkedWriter* writer) {
+  if (writer != NULL) {
+    int i;
+    for (i = 0; i < writer->num_chunks; ++i) {
+      WebPSafeFree(writer->chunks[i].data);
+    }
+    WebPSafeFree(writer->chunks);
+    writer->chunks = NULL;
+    writer->num_chunks = 0;
+    writer->size = 0;
+    writer->max_chunks = 0;
+  }
+}
+
+#undef DEFAULT_WRITER_BLOCK_SIZE
+
+//------------------------------------------------------------------------------
+// WebPFileWrite: Write-to-file
+
+int WebPFileWrite(const uint8_t* data, size_t data_size,
+                  const WebPPicture* picture) {
+  FILE* const file = (FILE*)picture->custom_ptr;
+  if (file == NULL) {
+    return 1;
+  }
+  return (data_size == 0) || (fwrite(data, data_size, 1, file) == 1);
+}
+
 //------------------------------------------------------------------------------
 // Simplest high-level calls:
 
@@ -20,6 +20,7 @@
 
 #if !defined(WEBP_REDUCE_SIZE)
 #include "src/utils/rescaler_utils.h"
+#include "src/utils/thread_utils.h"
 #include "src/utils/utils.h"
 #endif  // !defined(WEBP_REDUCE_SIZE)
 
@@ -191,6 +192,110 @@ static int RescalePlane(const uint8_t* src,
   return 1;
 }
 
+// Below this number of source pixels, the planes are rescaled serially:
+// the thread start-up would cost more than what is saved.
+#define RESCALE_MT_MIN_PIXELS (256 * 256)
+
+// Rescaling task for one plane, or for several same-sized ones in a row.
+typedef struct {
+  WebPWorker worker;
+  int num_planes;
+  const uint8_t* src[2];
+  uint8_t* dst[2];
+  int src_width, src_height, src_stride;
+  int dst_width, dst_height, dst_stride;
+  rescaler_t* work;
+} RescaleJob;
+
+static int RescaleJobHook(void* arg1, void* arg2) {
+  const RescaleJob* const job = (const RescaleJob*)arg1;
+  int i;
+  (void)arg2;
+  for (i = 0; i < job->num_planes; ++i) {
+    if (!RescalePlane(job->src[i], job->src_width, job->src_height,
+                      job->src_stride, job->dst[i], job->dst_width,
+                      job->dst_height, job->dst_stride, job->work, 1)) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+static void InitRescaleJob(RescaleJob* const job,
+                           const uint8_t* src0, const uint8_t* src1,
+                           int src_width, int src_height, int src_stride,
+                           uint8_t* dst0, uint8_t* dst1,
+                           int dst_width, int dst_height, int dst_stride,
+                           rescaler_t* const work) {
+  WebPGetWorkerInterface()->Init(&job->worker);
+  job->worker.hook = RescaleJobHook;
+  job->worker.data1 = job;
+  job->worker.data2 = NULL;
+  job->num_planes = (src1 != NULL) ? 2 : 1;
+  job->src[0] = src0;
+  job->src[1] = src1;
+  job->dst[0] = dst0;
+  job->dst[1] = dst1;
+  job->src_width = src_width;
+  job->src_height = src_height;
+  job->src_stride = src_stride;
+  job->dst_width = dst_width;
+  job->dst_height = dst_height;
+  job->dst_stride = dst_stride;
+  job->work = work;
+}
+
+// Rescales the Y, U, V and alpha planes of 'src' into 'dst'. With 'use_mt',
+// the alpha plane and the U/V pair are handled by side workers while the
+// main thread does Y. 'work' must then hold three separate buffers of
+// 2 * dst->width elements each (one is enough otherwise). In case of error,
+// the reason is recorded in 'dst->error_code'.
+static int RescaleYUVA(const WebPPicture* const src, WebPPicture* const dst,
+                       rescaler_t* const work, int use_mt) {
+  const WebPWorkerInterface* const worker_interface =
+      WebPGetWorkerInterface();
+  const int work_size = 2 * dst->width;
+  const int num_jobs = (src->a != NULL) ? 3 : 2;
+  RescaleJob jobs[3];
+  int ok = 1;
+  int i;
+
+  InitRescaleJob(&jobs[0], src->y, NULL, src->width, src->height,
+                 src->y_stride, dst->y, NULL, dst->width, dst->height,
+                 dst->y_stride, work);
+  InitRescaleJob(&jobs[1], src->u, src->v, HALVE(src->width),
+                 HALVE(src->height), src->uv_stride, dst->u, dst->v,
+                 HALVE(dst->width), HALVE(dst->height), dst->uv_stride,
+                 work + (use_mt ? work_size : 0));
+  if (src->a != NULL) {
+    InitRescaleJob(&jobs[2], src->a, NULL, src->width, src->height,
+                   src->a_stride, dst->a, NULL, dst->width, dst->height,
+                   dst->a_stride, work + (use_mt ? 2 * work_size : 0));
+  }
+  if (use_mt) {
+    // Note the use of '&' instead of '&&': all workers must be started.
+    for (i = 1; i < num_jobs; ++i) {
+      ok &= worker_interface->Reset(&jobs[i].worker);
+    }
+    if (ok) {
+      for (i = 1; i < num_jobs; ++i) worker_interface->Launch(&jobs[i].worker);
+      worker_interface->Execute(&jobs[0].worker);
+      for (i = 0; i < num_jobs; ++i) {
+        ok &= worker_interface->Sync(&jobs[i].worker);
+      }
+    }
+    if (!ok) WebPEncodingSetError(dst, VP8_ENC_ERROR_OUT_OF_MEMORY);
+  } else {
+    for (i = 0; i < num_jobs; ++i) {
+      worker_interface->Execute(&jobs[i].worker);
+      ok &= worker_interface->Sync(&jobs[i].worker);
+    }
+    if (!ok) WebPEncodingSetError(dst, VP8_ENC_ERROR_BAD_DIMENSION);
+  }
+  for (i = 0; i < num_jobs; ++i) worker_interface->End(&jobs[i].worker);
+  return ok;
+}
+
 static void AlphaMultiplyARGB(WebPPicture* const pic, int inverse) {
   assert(pic->argb != NULL);
   WebPMultARGBRows((uint8_t*)pic->argb, pic->argb_stride * sizeof(*pic->argb),
@@ -204,7 +309,10 @@ static void AlphaMultiplyY(WebPPicture* const pic, int inverse) {
   }
 }
 
-int WebPPictureRescale(WebPPicture* picture, int width, int height) {
+// With 'use_threads', the planes of a YUV(A) picture are rescaled
+// concurrently.
+static int PictureRescale(WebPPicture* picture, int width, int height,
+                          int use_threads) {
   WebPPicture tmp;
   int prev_width, prev_height;
   rescaler_t* work;
@@ -225,32 +333,29 @@ int WebPPictureRescale(WebPPicture* picture, int width, int height) {
   }
 
   if (!picture->use_argb) {
-    work = (rescaler_t*)WebPSafeMalloc(2ULL * width, sizeof(*work));
+#ifdef WEBP_USE_THREAD
+    const int use_mt = use_threads &&
+        ((uint64_t)prev_width * prev_height >= RESCALE_MT_MIN_PIXELS);
+#else
+    const int use_mt = 0;
+#endif
+    work = (rescaler_t*)WebPSafeMalloc((use_mt ? 6ULL : 2ULL) * width,
+                                       sizeof(*work));
     if (work == NULL) {
       WebPPictureFree(&tmp);
       return WebPEncodingSetError(picture, VP8_ENC_ERROR_OUT_OF_MEMORY);
     }
-    // If present, we need to rescale alpha first (for AlphaMultiplyY).
-    if (picture->a != NULL) {
-      WebPInitAlphaProcessing();
-      if (!RescalePlane(picture->a, prev_width, prev_height, picture->a_stride,
-                        tmp.a, width, height, tmp.a_stride, work, 1)) {
-        return WebPEncodingSetError(picture, VP8_ENC_ERROR_BAD_DIMENSION);
-      }
-    }
-
     // We take transparency into account on the luma plane only. That's not
     // totally exact blending, but still is a good approximation.
+    // Only picture->y is premultiplied, so the (source) alpha plane can be
+    // rescaled at the same time as the others.
+    if (picture->a != NULL) WebPInitAlphaProcessing();
     AlphaMultiplyY(picture, 0);
-    if (!RescalePlane(picture->y, prev_width, prev_height, picture->y_stride,
-                      tmp.y, width, height, tmp.y_stride, work, 1) ||
-        !RescalePlane(picture->u, HALVE(prev_width), HALVE(prev_height),
-                      picture->uv_stride, tmp.u, HALVE(width), HALVE(height),
-                      tmp.uv_stride, work, 1) ||
-        !RescalePlane(picture->v, HALVE(prev_width), HALVE(prev_height),
-                      picture->uv_stride, tmp.v, HALVE(width), HALVE(height),
-                      tmp.uv_stride, work, 1)) {
-      return WebPEncodingSetError(picture, VP8_ENC_ERROR_BAD_DIMENSION);
+    if (!RescaleYUVA(picture, &tmp, work, use_mt)) {
+      const WebPEncodingError error = tmp.error_code;
+      WebPSafeFree(work);
+      WebPPictureFree(&tmp);
+      return WebPEncodingSetError(picture, error);
     }
     AlphaMultiplyY(&tmp, 1);
   } else {
@@ -267,6 +372,8 @@ int WebPPictureRescale(WebPPicture* picture, int width, int height) {
     if (!RescalePlane((const uint8_t*)picture->argb, prev_width, prev_height,
                       picture->argb_stride * 4, (uint8_t*)tmp.argb, width,
                       height, tmp.argb_stride * 4, work, 4)) {
+      WebPSafeFree(work);
+      WebPPictureFree(&tmp);
       return WebPEncodingSetError(picture, VP8_ENC_ERROR_BAD_DIMENSION);
     }
     AlphaMultiplyARGB(&tmp, 1);
@@ -277,6 +384,16 @@ int WebPPictureRescale(WebPPicture* picture, int width, int height) {
   return 1;
 }
 
+int WebPPictureRescale(WebPPicture* picture, int width, int height) {
+  return PictureRescale(picture, width, height, 0);
+}
+
+int WebPPictureRescaleMT(WebPPicture* picture, int width, int height) {
+  return PictureRescale(picture, width, height, 1);
+}
+
+#undef RESCALE_MT_MIN_PIXELS
+
 #else  // defined(WEBP_REDUCE_SIZE)
 
 int WebPPictureCopy(const WebPPicture* src, WebPPicture* dst) {
@@ -301,4 +418,11 @@ int WebPPictureRescale(WebPPicture* pic, int width, int height) {
   (void)height;
   return 0;
 }
+
+int WebPPictureRescaleMT(WebPPicture* pic, int width, int height) {
+  (void)pic;
+  (void)width;
+  (void)height;
+  return 0;
+}
 #endif  // !defined(WEBP_REDUCE_SIZE)
@@ -607,12 +607,16 @@ static int TrellisQuantizeBlock(const VP8Encoder* WEBP_RESTRICT const enc,
   ScoreState* ss_prev = &SCORE_STATE(1, MIN_DELTA);
   int best_path[3] = {-1, -1, -1};   // store best-last/best-level/best-previous
   score_t best_score;
+  uint32_t coeffs0[16];      // sharpened absolute value of the coefficients
+  int levels0[16];           // neutral-bias quantized levels
+  int thresh_levels[16];     // highest levels worth testing
   int n, m, p, last;
 
   {
     score_t cost;
     const int thresh = mtx->q_[1] * mtx->q_[1] / 4;
     const int last_proba = probas[VP8EncBands[first]][ctx0][0];
+    int any_level = 0;
 
     // compute the position of the last interesting coefficient
     last = first - 1;
@@ -628,6 +632,25 @@ static int TrellisQuantizeBlock(const VP8Encoder* WEBP_RESTRICT const enc,
     // to last + 1 (inclusive) without losing much.
     if (last < 15) ++last;
 
+    // quantize the coefficients ahead of the traversal. This loop has no
+    // dependency between iterations and is left to the compiler to vectorize.
+    for (n = first; n <= last; ++n) {
+      const int j = kZigzag[n];
+      // note: it's important to take sign of the _original_ coeff,
+      // so we don't have to consider level < 0 afterward.
+      const uint32_t coeff0 = (in[j] < 0 ? -in[j] : in[j]) + mtx->sharpen_[j];
+      const int level0 = QUANTDIV(coeff0, mtx->iq_[j], BIAS(0x00));
+      const int thresh_level = QUANTDIV(coeff0, mtx->iq_[j], BIAS(0x80));
+      coeffs0[n] = coeff0;
+      levels0[n] = (level0 > MAX_LEVEL) ? MAX_LEVEL : level0;
+      thresh_levels[n] = (thresh_level > MAX_LEVEL) ? MAX_LEVEL : thresh_level;
+      any_level |= thresh_level;
+    }
+    // If no coefficient can be coded with a non-zero level, all the nodes
+    // have level 0 and no terminal node can be recorded: the trellis would
+    // end up skipping the block anyway. Bail out without traversing it.
+    if (any_level == 0) last = first - 1;
+
     // compute 'skip' score. This is the max score one can do.
     cost = VP8BitCost(0, last_proba);
     best_score = RDScoreTrellis(lambda, cost, 0);
@@ -644,16 +667,10 @@ static int TrellisQuantizeBlock(const VP8Encoder* WEBP_RESTRICT const enc,
   for (n = first; n <= last; ++n) {
     const int j = kZigzag[n];
     const uint32_t Q  = mtx->q_[j];
-    const uint32_t iQ = mtx->iq_[j];
-    const uint32_t B = BIAS(0x00);     // neutral bias
-    // note: it's important to take sign of the _original_ coeff,
-    // so we don't have to consider level < 0 afterward.
     const int sign = (in[j] < 0);
-    const uint32_t coeff0 = (sign ? -in[j] : in[j]) + mtx->sharpen_[j];
-    int level0 = QUANTDIV(coeff0, iQ, B);
-    int thresh_level = QUANTDIV(coeff0, iQ, BIAS(0x80));
-    if (thresh_level > MAX_LEVEL) thresh_level = MAX_LEVEL;
-    if (level0 > MAX_LEVEL) level0 = MAX_LEVEL;
+    const uint32_t coeff0 = coeffs0[n];
+    const int level0 = levels0[n];
+    const int thresh_level = thresh_levels[n];
 
     {   // Swap current and previous score states
       ScoreState* const tmp = ss_cur;
@@ -771,21 +788,17 @@ static int TrellisQuantizeBlock(const VP8Encoder* WEBP_RESTRICT const enc,
 // all at once. Output is the reconstructed block in *yuv_out, and the
 // quantized levels in *levels.
 
-static int ReconstructIntra16(VP8EncIterator* WEBP_RESTRICT const it,
-                              VP8ModeScore* WEBP_RESTRICT const rd,
-                              uint8_t* WEBP_RESTRICT const yuv_out,
-                              int mode) {
+// Quantizes the intra16 coefficients 'tmp' in place. On return, 'tmp' holds
+// the dequantized coefficients, ready for the inverse transform.
+static int QuantizeIntra16(VP8EncIterator* WEBP_RESTRICT const it,
+                           VP8ModeScore* WEBP_RESTRICT const rd,
+                           int16_t tmp[16][16]) {
   const VP8Encoder* const enc = it->enc_;
-  const uint8_t* const ref = it->yuv_p_ + VP8I16ModeOffsets[mode];
-  const uint8_t* const src = it->yuv_in_ + Y_OFF_ENC;
   const VP8SegmentInfo* const dqm = &enc->dqm_[it->mb_->segment_];
   int nz = 0;
   int n;
-  int16_t tmp[16][16], dc_tmp[16];
+  int16_t dc_tmp[16];
 
-  for (n = 0; n < 16; n += 2) {
-    VP8FTransform2(src + VP8Scan[n], ref + VP8Scan[n], tmp[n]);
-  }
   VP8FTransformWHT(tmp[0], dc_tmp);
   nz |= VP8EncQuantizeBlockWHT(dc_tmp, rd->y_dc_levels, &dqm->y2_) << 24;
 
@@ -814,8 +827,27 @@ static int ReconstructIntra16(VP8EncIterator* WEBP_RESTRICT const it,
     }
   }
 
-  // Transform back
+  // Transform back the DC
   VP8TransformWHT(dc_tmp, tmp[0]);
+  return nz;
+}
+
+static int ReconstructIntra16(VP8EncIterator* WEBP_RESTRICT const it,
+                              VP8ModeScore* WEBP_RESTRICT const rd,
+                              uint8_t* WEBP_RESTRICT const yuv_out,
+                              int mode) {
+  const uint8_t* const ref = it->yuv_p_ + VP8I16ModeOffsets[mode];
+  const uint8_t* const src = it->yuv_in_ + Y_OFF_ENC;
+  int nz;
+  int n;
+  int16_t tmp[16][16];
+
+  for (n = 0; n < 16; n += 2) {
+    VP8FTransform2(src + VP8Scan[n], ref + VP8Scan[n], tmp[n]);
+  }
+  nz = QuantizeIntra16(it, rd, tmp);
+
+  // Transform back
   for (n = 0; n < 16; n += 2) {
     VP8ITransform(ref + VP8Scan[n], tmp[n], yuv_out + VP8Scan[n], 1);
   }
@@ -823,26 +855,31 @@ static int ReconstructIntra16(VP8EncIterator* WEBP_RESTRICT const it,
   return nz;
 }
 
+// Quantizes the coefficients of the intra4 block 'it->i4_' in place.
+static int QuantizeIntra4(VP8EncIterator* WEBP_RESTRICT const it,
+                          int16_t tmp[16], int16_t levels[16]) {
+  const VP8Encoder* const enc = it->enc_;
+  const VP8SegmentInfo* const dqm = &enc->dqm_[it->mb_->segment_];
+  if (DO_TRELLIS_I4 && it->do_trellis_) {
+    const int x = it->i4_ & 3, y = it->i4_ >> 2;
+    const int ctx = it->top_nz_[x] + it->left_nz_[y];
+    return TrellisQuantizeBlock(enc, tmp, levels, ctx, TYPE_I4_AC, &dqm->y1_,
+                                dqm->lambda_trellis_i4_);
+  }
+  return VP8EncQuantizeBlock(tmp, levels, &dqm->y1_);
+}
+
 static int ReconstructIntra4(VP8EncIterator* WEBP_RESTRICT const it,
                              int16_t levels[16],
                              const uint8_t* WEBP_RESTRICT const src,
                              uint8_t* WEBP_RESTRICT const yuv_out,
                              int mode) {
-  const VP8Encoder* const enc = it->enc_;
   const uint8_t* const ref = it->yuv_p_ + VP8I4ModeOffsets[mode];
-  const VP8SegmentInfo* const dqm = &enc->dqm_[it->mb_->segment_];
-  int nz = 0;
+  int nz;
   int16_t tmp[16];
 
   VP8FTransform(src, ref, tmp);
-  if (DO_TRELLIS_I4 && it->do_trellis_) {
-    const int x = it->i4_ & 3, y = it->i4_ >> 2;
-    const int ctx = it->top_nz_[x] + it->left_nz_[y];
-    nz = TrellisQuantizeBlock(enc, tmp, levels, ctx, TYPE_I4_AC, &dqm->y1_,
-                              dqm->lambda_trellis_i4_);
-  } else {
-    nz = VP8EncQuantizeBlock(tmp, levels, &dqm->y1_);
-  }
+  nz = QuantizeIntra4(it, tmp, levels);
   VP8ITransform(ref, tmp, yuv_out, 0);
   return nz;
 }
@@ -928,20 +965,15 @@ static void StoreDiffusionErrors(VP8EncIterator* WEBP_RESTRICT const it,
 
 //------------------------------------------------------------------------------
 
-static int ReconstructUV(VP8EncIterator* WEBP_RESTRICT const it,
-                         VP8ModeScore* WEBP_RESTRICT const rd,
-                         uint8_t* WEBP_RESTRICT const yuv_out, int mode) {
+// Quantizes the chroma coefficients 'tmp' in place.
+static int QuantizeUV(VP8EncIterator* WEBP_RESTRICT const it,
+                      VP8ModeScore* WEBP_RESTRICT const rd,
+                      int16_t tmp[8][16]) {
   const VP8Encoder* const enc = it->enc_;
-  const uint8_t* const ref = it->yuv_p_ + VP8UVModeOffsets[mode];
-  const uint8_t* const src = it->yuv_in_ + U_OFF_ENC;
   const VP8SegmentInfo* const dqm = &enc->dqm_[it->mb_->segment_];
   int nz = 0;
   int n;
-  int16_t tmp[8][16];
 
-  for (n = 0; n < 8; n += 2) {
-    VP8FTransform2(src + VP8ScanUV[n], ref + VP8ScanUV[n], tmp[n]);
-  }
   if (it->top_derr_ != NULL) CorrectDCValues(it, &dqm->uv_, tmp, rd);
 
   if (DO_TRELLIS_UV && it->do_trellis_) {
@@ -963,11 +995,27 @@ static int ReconstructUV(VP8EncIterator* WEBP_RESTRICT const it,
       nz |= VP8EncQuantize2Blocks(tmp[n], rd->uv_levels[n], &dqm->uv_) << n;
     }
   }
+  return (nz << 16);
+}
+
+static int ReconstructUV(VP8EncIterator* WEBP_RESTRICT const it,
+                         VP8ModeScore* WEBP_RESTRICT const rd,
+                         uint8_t* WEBP_RESTRICT const yuv_out, int mode) {
+  const uint8_t* const ref = it->yuv_p_ + VP8UVModeOffsets[mode];
+  const uint8_t* const src = it->yuv_in_ + U_OFF_ENC;
+  int nz;
+  int n;
+  int16_t tmp[8][16];
+
+  for (n = 0; n < 8; n += 2) {
+    VP8FTransform2(src + VP8ScanUV[n], ref + VP8ScanUV[n], tmp[n]);
+  }
+  nz = QuantizeUV(it, rd, tmp);
 
   for (n = 0; n < 8; n += 2) {
     VP8ITransform(ref + VP8ScanUV[n], tmp[n], yuv_out + VP8ScanUV[n], 1);
   }
-  return (nz << 16);
+  return nz;
 }
 
 //------------------------------------------------------------------------------
@@ -1398,3 +1446,100 @@ int VP8Decimate(VP8EncIterator* WEBP_RESTRICT const it,
   VP8SetSkip(it, is_skipped);
   return is_skipped;
 }
+
+//------------------------------------------------------------------------------
+// Re-quantization of recorded residuals, for the rate-control passes.
+
+void VP8StoreResiduals(VP8EncIterator* WEBP_RESTRICT const it,
+                       const VP8ModeScore* WEBP_RESTRICT const rd,
+                       VP8MBResiduals* WEBP_RESTRICT const res) {
+  const VP8Encoder* const enc = it->enc_;
+  const uint8_t* const src = it->yuv_in_;
+  uint8_t* const pred = res->pred;
+  int n;
+
+  res->H = rd->H;
+  if (it->mb_->type_ == 1) {
+    const uint8_t* const ref = it->yuv_p_ + VP8I16ModeOffsets[it->preds_[0]];
+    VP8Copy16x8(ref, pred + Y_OFF_ENC);
+    VP8Copy16x8(ref + 8 * BPS, pred + Y_OFF_ENC + 8 * BPS);
+    for (n = 0; n < 16; n += 2) {
+      VP8FTransform2(src + Y_OFF_ENC + VP8Scan[n],
+                     pred + Y_OFF_ENC + VP8Scan[n], res->coeffs[n]);
+    }
+  } else {
+    // The intra4 predictions are rebuilt from the final reconstruction.
+    VP8IteratorStartI4(it);
+    do {
+      const int mode =
+          it->preds_[(it->i4_ & 3) + (it->i4_ >> 2) * enc->preds_w_];
+      uint8_t* const dst = pred + Y_OFF_ENC + VP8Scan[it->i4_];
+      MakeIntra4Preds(it);
+      VP8Copy4x4(it->yuv_p_ + VP8I4ModeOffsets[mode], dst);
+      VP8FTransform(src + Y_OFF_ENC + VP8Scan[it->i4_], dst,
+                    res->coeffs[it->i4_]);
+    } while (VP8IteratorRotateI4(it, it->yuv_out_ + Y_OFF_ENC));
+  }
+  VP8Copy16x8(it->yuv_p_ + VP8UVModeOffsets[it->mb_->uv_mode_],
+              pred + U_OFF_ENC);
+  for (n = 0; n < 8; n += 2) {
+    VP8FTransform2(src + U_OFF_ENC + VP8ScanUV[n],
+                   pred + U_OFF_ENC + VP8ScanUV[n], res->coeffs[16 + n]);
+  }
+}
+
+int VP8DecimateResiduals(VP8EncIterator* WEBP_RESTRICT const it,
+                         VP8ModeScore* WEBP_RESTRICT const rd,
+                         const VP8MBResiduals* WEBP_RESTRICT const res,
+                         VP8RDLevel rd_opt, int need_disto) {
+  const uint8_t* const pred = res->pred;
+  uint8_t* const yuv_out = it->yuv_out_;
+  int16_t tmp[16 + 4 + 4][16];
+  int nz = 0;
+  int n;
+
+  InitScore(rd);
+  memcpy(tmp, res->coeffs, sizeof(tmp));
+  it->do_trellis_ = (rd_opt >= RD_OPT_TRELLIS);
+  rd->H = res->H;
+
+  if (it->mb_->type_ == 1) {
+    nz = QuantizeIntra16(it, rd, tmp);
+    rd->R = VP8GetCostLuma16(it, rd);
+    if (need_disto) {
+      for (n = 0; n < 16; n += 2) {
+        VP8ITransform(pred + Y_OFF_ENC + VP8Scan[n], tmp[n],
+                      yuv_out + Y_OFF_ENC + VP8Scan[n], 1);
+      }
+    }
+  } else {
+    VP8IteratorNzToBytes(it);
+    for (it->i4_ = 0; it->i4_ < 16; ++it->i4_) {
+      const int x = it->i4_ & 3, y = it->i4_ >> 2;
+      int16_t* const levels = rd->y_ac_levels[it->i4_];
+      const int non_zero = QuantizeIntra4(it, tmp[it->i4_], levels);
+      rd->R += VP8GetCostLuma4(it, levels);
+      it->top_nz_[x] = it->left_nz_[y] = non_zero;
+      nz |= non_zero << it->i4_;
+      if (need_disto) {
+        VP8ITransform(pred + Y_OFF_ENC + VP8Scan[it->i4_], tmp[it->i4_],
+                      yuv_out + Y_OFF_ENC + VP8Scan[it->i4_], 0);
+      }
+    }
+  }
+
+  nz |= QuantizeUV(it, rd, tmp + 16);
+  rd->R += VP8GetCostUV(it, rd);
+  if (it->top_derr_ != NULL) StoreDiffusionErrors(it, rd);
+  if (need_disto) {
+    for (n = 0; n < 8; n += 2) {
+      VP8ITransform(pred + U_OFF_ENC + VP8ScanUV[n], tmp[16 + n],
+                    yuv_out + U_OFF_ENC + VP8ScanUV[n], 1);
+    }
+    rd->D = VP8SSE16x16(it->yuv_in_ + Y_OFF_ENC, yuv_out + Y_OFF_ENC) +
+            VP8SSE16x8(it->yuv_in_ + U_OFF_ENC, yuv_out + U_OFF_ENC);
+  }
+  rd->nz = nz;
+  VP8SetSkip(it, (nz == 0));
+  return (nz == 0);
+}
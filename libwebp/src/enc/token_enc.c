@@ -48,24 +48,53 @@ void VP8TBufferInit(VP8TBuffer* const b, int page_size) {
   b->last_page_ = &b->pages_;
   b->left_ = 0;
   b->page_size_ = (page_size < MIN_PAGE_SIZE) ? MIN_PAGE_SIZE : page_size;
+  b->free_pages_ = NULL;
   b->error_ = 0;
 }
 
+static void FreePages(VP8Tokens* p) {
+  while (p != NULL) {
+    VP8Tokens* const next = p->next_;
+    WebPSafeFree(p);
+    p = next;
+  }
+}
+
 void VP8TBufferClear(VP8TBuffer* const b) {
   if (b != NULL) {
-    VP8Tokens* p = b->pages_;
-    while (p != NULL) {
-      VP8Tokens* const next = p->next_;
-      WebPSafeFree(p);
-      p = next;
-    }
+    FreePages(b->pages_);
+    FreePages(b->free_pages_);
     VP8TBufferInit(b, b->page_size_);
   }
 }
 
+void VP8TBufferRecycle(VP8TBuffer* const b) {
+  if (b->pages_ != NULL) {
+    *b->last_page_ = b->free_pages_;
+    b->free_pages_ = b->pages_;
+  }
+  b->pages_ = NULL;
+  b->last_page_ = &b->pages_;
+  b->tokens_ = NULL;
+  b->left_ = 0;
+  b->error_ = 0;
+}
+
+void VP8TBufferMovePages(VP8TBuffer* const src, VP8TBuffer* const dst) {
+  VP8TBufferRecycle(src);
+  if (src->free_pages_ == NULL) return;
+  VP8TBufferClear(dst);
+  dst->page_size_ = src->page_size_;
+  dst->free_pages_ = src->free_pages_;
+  src->free_pages_ = NULL;
+}
+
 static int TBufferNewPage(VP8TBuffer* const b) {
   VP8Tokens* page = NULL;
-  if (!b->error_) {
+  if (!b->error_ && b->free_pages_ != NULL) {
+    page = b->free_pages_;
+    b->free_pages_ = page->next_;
+  } else if (!b->error_) {
     const size_t size = sizeof(*page) + b->page_size_ * sizeof(token_t);
     page = (VP8Tokens*)WebPSafeMalloc(1ULL, size);
   }
@@ -257,6 +286,13 @@ void VP8TBufferInit(VP8TBuffer* const b, int page_size) {
 void VP8TBufferClear(VP8TBuffer* const b) {
   (void)b;
 }
+void VP8TBufferRecycle(VP8TBuffer* const b) {
+  (void)b;
+}
+void VP8TBufferMovePages(VP8TBuffer* const src, VP8TBuffer* const dst) {
+  (void)src;
+  (void)dst;
+}
 
 #endif    // !DISABLE_TOKEN_BUFFER
 
@@ -19,6 +19,7 @@
 #include "src/dsp/cpu.h"
 #include "src/dsp/dsp.h"
 #include "src/utils/bit_writer_utils.h"
+#include "src/utils/stopwatch_utils.h"
 #include "src/utils/thread_utils.h"
 #include "src/utils/utils.h"
 #include "src/webp/encode.h"
@@ -221,6 +222,15 @@ typedef struct {
   int8_t derr[2][3];          // DC diffusion errors for U/V for blocks #1/2/3
 } VP8ModeScore;
 
+// Residuals of the modes picked for a macroblock. They are recorded during the
+// first rate-control pass, so that the following passes only need to
+// re-quantize them instead of searching the modes again.
+typedef struct {
+  score_t H;                      // header bits of the picked modes
+  int16_t coeffs[16 + 4 + 4][16]; // luma and chroma transformed residuals
+  uint8_t pred[YUV_SIZE_ENC];     // predictions, laid out like yuv_out_
+} VP8MBResiduals;
+
 // Iterator structure to iterate through macroblocks, pointing to the
 // right neighbouring data (samples, predictions, contexts, ...)
 typedef struct {
@@ -318,6 +328,7 @@ typedef struct {
   uint16_t* tokens_;        // set to (*last_page_)->tokens_
   int left_;                // how many free tokens left before the page is full
   int page_size_;           // number of tokens per page
+  VP8Tokens* free_pages_;   // pages kept for reuse
 #endif
   int error_;         // true in case of malloc error
 } VP8TBuffer;
@@ -325,6 +336,11 @@ typedef struct {
 // initialize an empty buffer
 void VP8TBufferInit(VP8TBuffer* const b, int page_size);
 void VP8TBufferClear(VP8TBuffer* const b);   // de-allocate pages memory
+// Empties the buffer, keeping its pages for the next tokens.
+void VP8TBufferRecycle(VP8TBuffer* const b);
+// Empties 'src' and hands its pages, along with its page size, over to 'dst'
+// whose own pages are freed. Does nothing if 'src' has no page.
+void VP8TBufferMovePages(VP8TBuffer* const src, VP8TBuffer* const dst);
 
 #if !defined(DISABLE_TOKEN_BUFFER)
 
@@ -348,6 +364,7 @@ size_t VP8EstimateTokenSize(VP8TBuffer* const b, const uint8_t* const probas);
 struct VP8Encoder {
   const WebPConfig* config_;    // user configuration and parameters
   WebPPicture* pic_;            // input / output picture
+  WebPEncoderContext* ctx_;     // if not NULL, keeps memory between pictures
 
   // headers
   VP8EncFilterHeader   filter_hdr_;     // filtering information
@@ -459,6 +476,13 @@ int VP8EncTokenLoop(VP8Encoder* const enc);
 int WebPEncodingSetError(const WebPPicture* const pic, WebPEncodingError error);
 int WebPReportProgress(const WebPPicture* const pic,
                        int percent, int* const percent_store);
+// Adds the time elapsed since the last checkpoint of 'watch' to the 'stage'
+// timings of 'stats', and restarts 'watch'.
+static WEBP_INLINE void WebPEncStageStatsAddTime(
+    WebPEncStageStats* const stats, WEBP_ENC_STAGE stage,
+    WebPStopwatch* const watch) {
+  WebPStopwatchAdd(watch, &stats->wall_time[stage], &stats->cpu_time[stage]);
+}
 
   // in analysis.c
 // Main analysis loop. Decides the segmentations and complexity.
@@ -472,6 +496,19 @@ void VP8SetSegmentParams(VP8Encoder* const enc, float quality);
 int VP8Decimate(VP8EncIterator* WEBP_RESTRICT const it,
                 VP8ModeScore* WEBP_RESTRICT const rd,
                 VP8RDLevel rd_opt);
+// Records the residuals of the modes picked by the last VP8Decimate() call.
+// Must be called before VP8IteratorSaveBoundary().
+void VP8StoreResiduals(VP8EncIterator* WEBP_RESTRICT const it,
+                       const VP8ModeScore* WEBP_RESTRICT const rd,
+                       VP8MBResiduals* WEBP_RESTRICT const res);
+// Re-quantizes residuals recorded by VP8StoreResiduals() with the current
+// segment parameters, keeping the modes. The reconstruction and distortion are
+// only computed if 'need_disto' is true, in which case the source samples must
+// have been imported. Returns true if skipped.
+int VP8DecimateResiduals(VP8EncIterator* WEBP_RESTRICT const it,
+                         VP8ModeScore* WEBP_RESTRICT const rd,
+                         const VP8MBResiduals* WEBP_RESTRICT const res,
+                         VP8RDLevel rd_opt, int need_disto);
 
   // in alpha.c
 void VP8EncInitAlpha(VP8Encoder* const enc);    // initialize alpha compression
@@ -509,10 +546,28 @@ int WebPPictureAllocARGB(WebPPicture* const picture);
 // Returns false in case of error (invalid param, out-of-memory).
 int WebPPictureAllocYUVA(WebPPicture* const picture);
 
+// Same as WebPPictureSharpARGBToYUVA(), but the conversion may use up to
+// 'num_threads' threads and, if 'low_memory' is set, proceeds by strips with
+// bounded scratch memory.
+int WebPPictureSharpARGBToYUVAWithOptions(WebPPicture* const picture,
+                                          int num_threads, int low_memory);
+
 // Replace samples that are fully transparent by 'color' to help compressibility
 // (no guarantee, though). Assumes pic->use_argb is true.
 void WebPReplaceTransparentPixels(WebPPicture* const pic, uint32_t color);
 
+// Points picture->argb directly at the samples borrowed with
+// WebPPictureImportView(), if they are already in the native ARGB layout.
+// Unless 'exact' is true, the samples must also not need any change from
+// WebPReplaceTransparentPixels(). Returns false if a copy is needed. Upon
+// success, picture->argb must not be written to, and should be reset to NULL
+// after use.
+int WebPPictureBorrowViewARGB(WebPPicture* const picture, int exact);
+
+// Converts the samples borrowed with WebPPictureImportView() to a newly
+// allocated picture->argb buffer, and drops the view.
+int WebPPictureViewToARGB(WebPPicture* const picture);
+
 //------------------------------------------------------------------------------
 
 #ifdef __cplusplus
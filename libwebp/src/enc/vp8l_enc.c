@@ -413,9 +413,15 @@ static int EncoderInit(VP8LEncoder* const enc) {
   // at most MAX_REFS_BLOCK_PER_IMAGE blocks used:
   const int refs_block_size = (pix_cnt - 1) / MAX_REFS_BLOCK_PER_IMAGE + 1;
   int i;
-  if (!VP8LHashChainInit(&enc->hash_chain_, pix_cnt)) return 0;
+  // A recycled encoder keeps its memory if the picture size is unchanged.
+  if (enc->hash_chain_.size_ != pix_cnt) {
+    VP8LHashChainClear(&enc->hash_chain_);
+    if (!VP8LHashChainInit(&enc->hash_chain_, pix_cnt)) return 0;
+  }
 
-  for (i = 0; i < 4; ++i) VP8LBackwardRefsInit(&enc->refs_[i], refs_block_size);
+  for (i = 0; i < 4; ++i) {
+    VP8LBackwardRefsReset(&enc->refs_[i], refs_block_size);
+  }
 
   return 1;
 }
@@ -844,10 +850,12 @@ static int EncodeImageNoHuffman(VP8LBitWriter* const bw,
 // pic and percent are for progress.
 static int EncodeImageInternal(
     VP8LBitWriter* const bw, const uint32_t* const argb,
-    VP8LHashChain* const hash_chain, VP8LBackwardRefs refs_array[4], int width,
+    VP8LHashChain* const hash_chain, VP8LBackwardRefs refs_array[4],
+    VP8LHistogramSet* histogram_sets[2], int width,
     int height, int quality, int low_effort, const CrunchConfig* const config,
     int* cache_bits, int histogram_bits_in, size_t init_byte_position,
     int* const hdr_size, int* const data_size, const WebPPicture* const pic,
+    WebPEncStageStats* const stage_stats, WebPStopwatch* const watch,
     int percent_range, int* const percent) {
   const uint32_t histogram_image_xysize =
       VP8LSubSampleSize(width, histogram_bits_in) *
@@ -893,6 +901,9 @@ static int EncodeImageInternal(
                          low_effort, pic, percent_range, percent)) {
     goto Error;
   }
+  if (stage_stats != NULL) {
+    WebPEncStageStatsAddTime(stage_stats, WEBP_ENC_STAGE_HASH_CHAIN, watch);
+  }
   percent_start += percent_range;
   remaining_percent -= percent_range;
 
@@ -921,6 +932,10 @@ static int EncodeImageInternal(
             &refs_array[0], &cache_bits_best, pic, i_percent_range, percent)) {
       goto Error;
     }
+    if (stage_stats != NULL) {
+      WebPEncStageStatsAddTime(stage_stats, WEBP_ENC_STAGE_BACKWARD_REFS,
+                               watch);
+    }
 
     for (i_cache = 0; i_cache < (sub_config->do_no_cache_ ? 2 : 1); ++i_cache) {
       const int cache_bits_tmp = (i_cache == 0) ? cache_bits_best : 0;
@@ -933,8 +948,8 @@ static int EncodeImageInternal(
       VP8LBitWriterReset(&bw_init, bw);
 
       // Build histogram image and symbols from backward references.
-      histogram_image =
-          VP8LAllocateHistogramSet(histogram_image_xysize, cache_bits_tmp);
+      histogram_image = VP8LAllocateHistogramSetFrom(
+          &histogram_sets[0], histogram_image_xysize, cache_bits_tmp);
       tmp_histo = VP8LAllocateHistogram(cache_bits_tmp);
       if (histogram_image == NULL || tmp_histo == NULL) {
         WebPEncodingSetError(pic, VP8_ENC_ERROR_OUT_OF_MEMORY);
@@ -946,9 +961,14 @@ static int EncodeImageInternal(
       if (!VP8LGetHistoImageSymbols(
               width, height, &refs_array[i_cache], quality, low_effort,
               histogram_bits, cache_bits_tmp, histogram_image, tmp_histo,
-              histogram_argb, pic, i_percent_range, percent)) {
+              histogram_argb, &histogram_sets[1], pic, i_percent_range,
+              percent)) {
         goto Error;
       }
+      if (stage_stats != NULL) {
+        WebPEncStageStatsAddTime(stage_stats, WEBP_ENC_STAGE_HISTOGRAMS,
+                                 watch);
+      }
       // Create Huffman bit lengths and codes for each histogram image.
       histogram_image_size = histogram_image->size;
       bit_array_size = 5 * histogram_image_size;
@@ -962,8 +982,8 @@ static int EncodeImageInternal(
         WebPEncodingSetError(pic, VP8_ENC_ERROR_OUT_OF_MEMORY);
         goto Error;
       }
-      // Free combined histograms.
-      VP8LFreeHistogramSet(histogram_image);
+      // Release combined histograms.
+      VP8LReleaseHistogramSet(histogram_image, &histogram_sets[0]);
       histogram_image = NULL;
 
       // Free scratch histograms.
@@ -1047,6 +1067,10 @@ static int EncodeImageInternal(
         WebPSafeFree(huffman_codes);
         huffman_codes = NULL;
       }
+      if (stage_stats != NULL) {
+        WebPEncStageStatsAddTime(stage_stats, WEBP_ENC_STAGE_ENTROPY_CODING,
+                                 watch);
+      }
     }
   }
   VP8LBitWriterSwap(bw, &bw_best);
@@ -1058,7 +1082,7 @@ static int EncodeImageInternal(
  Error:
   WebPSafeFree(tokens);
   WebPSafeFree(huff_tree);
-  VP8LFreeHistogramSet(histogram_image);
+  VP8LReleaseHistogramSet(histogram_image, &histogram_sets[0]);
   VP8LFreeHistogram(tmp_histo);
   VP8LHashChainClear(&hash_chain_histogram);
   if (huffman_codes != NULL) {
@@ -1455,12 +1479,34 @@ static int EncodePalette(VP8LBitWriter* const bw, int low_effort,
 // -----------------------------------------------------------------------------
 // VP8LEncoder
 
+extern void VP8LClearBackwardRefs(VP8LBackwardRefs* const refs);
+
+// If 'keep' is not NULL and points to an encoder, that encoder is reset and
+// returned together with its buffers, and *keep is set to NULL.
 static VP8LEncoder* VP8LEncoderNew(const WebPConfig* const config,
-                                   const WebPPicture* const picture) {
-  VP8LEncoder* const enc = (VP8LEncoder*)WebPSafeCalloc(1ULL, sizeof(*enc));
-  if (enc == NULL) {
-    WebPEncodingSetError(picture, VP8_ENC_ERROR_OUT_OF_MEMORY);
-    return NULL;
+                                   const WebPPicture* const picture,
+                                   VP8LEncoder** const keep) {
+  VP8LEncoder* enc;
+  if (keep != NULL && *keep != NULL) {
+    VP8LEncoder saved;
+    enc = *keep;
+    *keep = NULL;
+    memcpy(&saved, enc, sizeof(saved));
+    memset(enc, 0, sizeof(*enc));
+    enc->transform_mem_ = saved.transform_mem_;
+    enc->transform_mem_size_ = saved.transform_mem_size_;
+    memcpy(enc->refs_, saved.refs_, sizeof(enc->refs_));
+    enc->hash_chain_ = saved.hash_chain_;
+    memcpy(enc->histogram_sets_, saved.histogram_sets_,
+           sizeof(enc->histogram_sets_));
+  } else {
+    int i;
+    enc = (VP8LEncoder*)WebPSafeCalloc(1ULL, sizeof(*enc));
+    if (enc == NULL) {
+      WebPEncodingSetError(picture, VP8_ENC_ERROR_OUT_OF_MEMORY);
+      return NULL;
+    }
+    for (i = 0; i < 4; ++i) VP8LBackwardRefsInit(&enc->refs_[i], 0);
   }
   enc->config_ = config;
   enc->pic_ = picture;
@@ -1471,16 +1517,34 @@ static VP8LEncoder* VP8LEncoderNew(const WebPConfig* const config,
   return enc;
 }
 
-static void VP8LEncoderDelete(VP8LEncoder* enc) {
+// If 'keep' is not NULL and doesn't already hold an encoder, 'enc' is stored
+// there with its buffers instead of being freed.
+static void VP8LEncoderDelete(VP8LEncoder* enc, VP8LEncoder** const keep) {
   if (enc != NULL) {
     int i;
+    if (keep != NULL && *keep == NULL) {
+      for (i = 0; i < 4; ++i) VP8LClearBackwardRefs(&enc->refs_[i]);
+      *keep = enc;
+      return;
+    }
     VP8LHashChainClear(&enc->hash_chain_);
     for (i = 0; i < 4; ++i) VP8LBackwardRefsClear(&enc->refs_[i]);
+    VP8LFreeHistogramSet(enc->histogram_sets_[0]);
+    VP8LFreeHistogramSet(enc->histogram_sets_[1]);
     ClearTransformBuffer(enc);
     WebPSafeFree(enc);
   }
 }
 
+void VP8LEncoderCacheClear(VP8LEncoderCache* const cache) {
+  int i;
+  for (i = 0; i < 2; ++i) {
+    VP8LEncoderDelete(cache->enc_[i], NULL);
+    cache->enc_[i] = NULL;
+    VP8LBitWriterWipeOut(&cache->bw_[i]);
+  }
+}
+
 // -----------------------------------------------------------------------------
 // Main call
 
@@ -1493,6 +1557,7 @@ typedef struct {
   int num_crunch_configs_;
   int red_and_blue_always_zero_;
   WebPAuxStats* stats_;
+  WebPEncStageStats* stage_stats_;
 } StreamEncodeContext;
 
 static int EncodeStreamHook(void* input, void* data2) {
@@ -1523,8 +1588,10 @@ static int EncodeStreamHook(void* input, void* data2) {
   int idx;
   size_t best_size = ~(size_t)0;
   VP8LBitWriter bw_init = *bw, bw_best;
+  WebPStopwatch watch;
   (void)data2;
 
+  if (params->stage_stats_ != NULL) WebPStopwatchReset(&watch);
   if (!VP8LBitWriterInit(&bw_best, 0) ||
       (num_crunch_configs > 1 && !VP8LBitWriterClone(bw, &bw_best))) {
     WebPEncodingSetError(picture, VP8_ENC_ERROR_OUT_OF_MEMORY);
@@ -1549,8 +1616,8 @@ static int EncodeStreamHook(void* input, void* data2) {
     }
     // Reset any parameter in the encoder that is set in the previous iteration.
     enc->cache_bits_ = 0;
-    VP8LBackwardRefsClear(&enc->refs_[0]);
-    VP8LBackwardRefsClear(&enc->refs_[1]);
+    VP8LClearBackwardRefs(&enc->refs_[0]);
+    VP8LClearBackwardRefs(&enc->refs_[1]);
 
 #if (WEBP_NEAR_LOSSLESS == 1)
     // Apply near-lossless preprocessing.
@@ -1627,11 +1694,17 @@ static int EncodeStreamHook(void* input, void* data2) {
 
     // -------------------------------------------------------------------------
     // Encode and write the transformed image.
+    if (params->stage_stats_ != NULL) {
+      WebPEncStageStatsAddTime(params->stage_stats_, WEBP_ENC_STAGE_TRANSFORMS,
+                               &watch);
+    }
     if (!EncodeImageInternal(
-            bw, enc->argb_, &enc->hash_chain_, enc->refs_, enc->current_width_,
+            bw, enc->argb_, &enc->hash_chain_, enc->refs_,
+            enc->histogram_sets_, enc->current_width_,
             height, quality, low_effort, &crunch_configs[idx],
             &enc->cache_bits_, enc->histo_bits_, byte_position, &hdr_size,
-            &data_size, picture, remaining_percent, &percent)) {
+            &data_size, picture, params->stage_stats_, &watch,
+            remaining_percent, &percent)) {
       goto Error;
     }
 
@@ -1670,10 +1743,22 @@ static int EncodeStreamHook(void* input, void* data2) {
   return (params->picture_->error_code == VP8_ENC_OK);
 }
 
-int VP8LEncodeStream(const WebPConfig* const config,
-                     const WebPPicture* const picture,
-                     VP8LBitWriter* const bw_main) {
-  VP8LEncoder* const enc_main = VP8LEncoderNew(config, picture);
+// Adds the stage timings of 'src' to the ones of 'dst'.
+static void AddStageTimes(WebPEncStageStats* const dst,
+                          const WebPEncStageStats* const src) {
+  int i;
+  for (i = 0; i < WEBP_ENC_STAGE_LAST; ++i) {
+    dst->wall_time[i] += src->wall_time[i];
+    dst->cpu_time[i] += src->cpu_time[i];
+  }
+}
+
+static int EncodeStream(const WebPConfig* const config,
+                        const WebPPicture* const picture,
+                        VP8LBitWriter* const bw_main,
+                        VP8LEncoderCache* const cache) {
+  VP8LEncoder* const enc_main =
+      VP8LEncoderNew(config, picture, (cache != NULL) ? &cache->enc_[0] : NULL);
   VP8LEncoder* enc_side = NULL;
   CrunchConfig crunch_configs[CRUNCH_CONFIGS_MAX];
   int num_crunch_configs_main, num_crunch_configs_side = 0;
@@ -1683,13 +1768,23 @@ int VP8LEncodeStream(const WebPConfig* const config,
   StreamEncodeContext params_main, params_side;
   // The main thread uses picture->stats, the side thread uses stats_side.
   WebPAuxStats stats_side;
+  WebPEncStageStats stage_stats_side;
   VP8LBitWriter bw_side;
   WebPPicture picture_side;
   const WebPWorkerInterface* const worker_interface = WebPGetWorkerInterface();
+  WebPStopwatch watch;
   int ok_main;
 
-  if (enc_main == NULL || !VP8LBitWriterInit(&bw_side, 0)) {
-    VP8LEncoderDelete(enc_main);
+  if (picture->stage_stats != NULL) WebPStopwatchReset(&watch);
+  if (cache != NULL) {
+    bw_side = cache->bw_[1];
+    memset(&cache->bw_[1], 0, sizeof(cache->bw_[1]));
+  } else {
+    memset(&bw_side, 0, sizeof(bw_side));
+  }
+  if (enc_main == NULL || !VP8LBitWriterReinit(&bw_side, 0)) {
+    VP8LEncoderDelete(enc_main, (cache != NULL) ? &cache->enc_[0] : NULL);
+    VP8LBitWriterWipeOut(&bw_side);
     return WebPEncodingSetError(picture, VP8_ENC_ERROR_OUT_OF_MEMORY);
   }
 
@@ -1705,6 +1800,11 @@ int VP8LEncodeStream(const WebPConfig* const config,
     WebPEncodingSetError(picture, VP8_ENC_ERROR_OUT_OF_MEMORY);
     goto Error;
   }
+  if (picture->stage_stats != NULL) {
+    WebPEncStageStats* const stage_stats = picture->stage_stats;
+    stage_stats->num_crunch_configs = num_crunch_configs_main;
+    WebPEncStageStatsAddTime(stage_stats, WEBP_ENC_STAGE_TRANSFORMS, &watch);
+  }
 
   // Split the configs between the main and side threads (if any).
   if (config->thread_level > 0) {
@@ -1735,6 +1835,7 @@ int VP8LEncodeStream(const WebPConfig* const config,
       if (idx == 0) {
         param->picture_ = picture;
         param->stats_ = picture->stats;
+        param->stage_stats_ = picture->stage_stats;
         param->bw_ = bw_main;
         param->enc_ = enc_main;
       } else {
@@ -1746,6 +1847,8 @@ int VP8LEncodeStream(const WebPConfig* const config,
         picture_side.progress_hook = NULL;  // Progress hook is not thread-safe.
         param->picture_ = &picture_side;  // No need to free a view afterwards.
         param->stats_ = (picture->stats == NULL) ? NULL : &stats_side;
+        param->stage_stats_ =
+            (picture->stage_stats == NULL) ? NULL : &stage_stats_side;
         // Create a side bit writer.
         if (!VP8LBitWriterClone(bw_main, &bw_side)) {
           WebPEncodingSetError(picture, VP8_ENC_ERROR_OUT_OF_MEMORY);
@@ -1753,7 +1856,8 @@ int VP8LEncodeStream(const WebPConfig* const config,
         }
         param->bw_ = &bw_side;
         // Create a side encoder.
-        enc_side = VP8LEncoderNew(config, &picture_side);
+        enc_side = VP8LEncoderNew(config, &picture_side,
+                                  (cache != NULL) ? &cache->enc_[1] : NULL);
         if (enc_side == NULL || !EncoderInit(enc_side)) {
           WebPEncodingSetError(picture, VP8_ENC_ERROR_OUT_OF_MEMORY);
           goto Error;
@@ -1792,6 +1896,10 @@ int VP8LEncodeStream(const WebPConfig* const config,
       memcpy(&stats_side, picture->stats, sizeof(stats_side));
     }
 #endif
+    if (picture->stage_stats != NULL) {
+      // The side thread only accumulates its own timings.
+      memset(&stage_stats_side, 0, sizeof(stage_stats_side));
+    }
     worker_interface->Launch(&worker_side);
   }
   // Execute the main thread.
@@ -1809,6 +1917,10 @@ int VP8LEncodeStream(const WebPConfig* const config,
       }
       goto Error;
     }
+    if (picture->stage_stats != NULL) {
+      // Report the timings of both threads, whichever output is kept.
+      AddStageTimes(picture->stage_stats, &stage_stats_side);
+    }
     if (VP8LBitWriterNumBytes(&bw_side) < VP8LBitWriterNumBytes(bw_main)) {
       VP8LBitWriterSwap(bw_main, &bw_side);
 #if !defined(WEBP_DISABLE_STATS)
@@ -1820,17 +1932,30 @@ int VP8LEncodeStream(const WebPConfig* const config,
   }
 
  Error:
-  VP8LBitWriterWipeOut(&bw_side);
-  VP8LEncoderDelete(enc_main);
-  VP8LEncoderDelete(enc_side);
+  if (cache != NULL) {
+    cache->bw_[1] = bw_side;
+    VP8LEncoderDelete(enc_main, &cache->enc_[0]);
+    VP8LEncoderDelete(enc_side, &cache->enc_[1]);
+  } else {
+    VP8LBitWriterWipeOut(&bw_side);
+    VP8LEncoderDelete(enc_main, NULL);
+    VP8LEncoderDelete(enc_side, NULL);
+  }
   return (picture->error_code == VP8_ENC_OK);
 }
 
+int VP8LEncodeStream(const WebPConfig* const config,
+                     const WebPPicture* const picture,
+                     VP8LBitWriter* const bw_main) {
+  return EncodeStream(config, picture, bw_main, /*cache=*/NULL);
+}
+
 #undef CRUNCH_CONFIGS_MAX
 #undef CRUNCH_SUBCONFIGS_MAX
 
 int VP8LEncodeImage(const WebPConfig* const config,
-                    const WebPPicture* const picture) {
+                    const WebPPicture* const picture,
+                    VP8LEncoderCache* const cache) {
   int width, height;
   int has_alpha;
   size_t coded_size;
@@ -1850,7 +1975,13 @@ int VP8LEncodeImage(const WebPConfig* const config,
   // 8 bpp for graphical images.
   initial_size = (config->image_hint == WEBP_HINT_GRAPH) ?
       width * height : width * height * 2;
-  if (!VP8LBitWriterInit(&bw, initial_size)) {
+  if (cache != NULL) {
+    bw = cache->bw_[0];
+    memset(&cache->bw_[0], 0, sizeof(cache->bw_[0]));
+  } else {
+    memset(&bw, 0, sizeof(bw));
+  }
+  if (!VP8LBitWriterReinit(&bw, initial_size)) {
     WebPEncodingSetError(picture, VP8_ENC_ERROR_OUT_OF_MEMORY);
     goto Error;
   }
@@ -1887,7 +2018,7 @@ int VP8LEncodeImage(const WebPConfig* const config,
   if (!WebPReportProgress(picture, 2, &percent)) goto UserAbort;
 
   // Encode main image stream.
-  if (!VP8LEncodeStream(config, picture, &bw)) goto Error;
+  if (!EncodeStream(config, picture, &bw, cache)) goto Error;
 
   if (!WebPReportProgress(picture, 99, &percent)) goto UserAbort;
 
@@ -1914,7 +2045,11 @@ int VP8LEncodeImage(const WebPConfig* const config,
   if (bw.error_) {
     WebPEncodingSetError(picture, VP8_ENC_ERROR_OUT_OF_MEMORY);
   }
-  VP8LBitWriterWipeOut(&bw);
+  if (cache != NULL) {
+    cache->bw_[0] = bw;
+  } else {
+    VP8LBitWriterWipeOut(&bw);
+  }
   return (picture->error_code == VP8_ENC_OK);
 }
 
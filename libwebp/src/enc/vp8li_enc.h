@@ -77,16 +77,29 @@ typedef struct {
   struct VP8LBackwardRefs refs_[4];  // Backward Refs array for temporaries.
   VP8LHashChain hash_chain_;         // HashChain data for constructing
                                      // backward references.
+  VP8LHistogramSet* histogram_sets_[2];  // spare sets, for the histogram image
+                                         // and the histograms it is built from.
 } VP8LEncoder;
 
+// Lossless encoding memory kept between pictures by a WebPEncoderContext.
+typedef struct {
+  VP8LEncoder* enc_[2];  // main and side encoders, with their buffers
+  VP8LBitWriter bw_[2];  // main and side bit writers, for their buffers
+} VP8LEncoderCache;
+
+// Releases the memory held by 'cache'.
+void VP8LEncoderCacheClear(VP8LEncoderCache* const cache);
+
 //------------------------------------------------------------------------------
 // internal functions. Not public.
 
-// Encodes the picture.
+// Encodes the picture. If 'cache' is not NULL, memory is taken from and
+// returned to it.
 // Returns 0 if config or picture is NULL or picture doesn't have valid argb
 // input.
 int VP8LEncodeImage(const WebPConfig* const config,
-                    const WebPPicture* const picture);
+                    const WebPPicture* const picture,
+                    VP8LEncoderCache* const cache);
 
 // Encodes the main image stream using the supplied bit writer.
 // Returns false in case of error (stored in picture->error_code).
@@ -27,6 +27,11 @@
 #include <stdio.h>
 #endif
 
+// Number of bands, each on its own thread, used by the sharp RGB->YUV
+// conversion when config->use_sharp_yuv is 2. Fixed, so that the output
+// doesn't depend on the machine.
+#define SHARP_YUV_NUM_THREADS 4
+
 //------------------------------------------------------------------------------
 
 int WebPGetEncoderVersion(void) {
@@ -141,8 +146,17 @@ static void MapConfigToTools(VP8Encoder* const enc) {
 //              LFStats: 2048
 // Picture size (yuv): 419328
 
+// Memory kept between the pictures encoded with a WebPEncoderContext.
+struct WebPEncoderContext {
+  uint8_t* vp8_mem_;          // VP8Encoder block, with its per-picture arrays
+  size_t vp8_mem_size_;
+  VP8TBuffer tokens_;         // spare token pages
+  VP8LEncoderCache vp8l_;     // lossless encoders and bit writers
+};
+
 static VP8Encoder* InitVP8Encoder(const WebPConfig* const config,
-                                  WebPPicture* const picture) {
+                                  WebPPicture* const picture,
+                                  WebPEncoderContext* const ctx) {
   VP8Encoder* enc;
   const int use_filter =
       (config->filter_strength > 0) || (config->autofilter > 0);
@@ -198,10 +212,19 @@ static VP8Encoder* InitVP8Encoder(const WebPConfig* const config,
          mb_w * mb_h * 384 * sizeof(uint8_t));
   printf("===================================\n");
 #endif
-  mem = (uint8_t*)WebPSafeMalloc(size, sizeof(*mem));
-  if (mem == NULL) {
-    WebPEncodingSetError(picture, VP8_ENC_ERROR_OUT_OF_MEMORY);
-    return NULL;
+  if (ctx != NULL && ctx->vp8_mem_size_ >= size) {
+    mem = ctx->vp8_mem_;
+  } else {
+    mem = (uint8_t*)WebPSafeMalloc(size, sizeof(*mem));
+    if (mem == NULL) {
+      WebPEncodingSetError(picture, VP8_ENC_ERROR_OUT_OF_MEMORY);
+      return NULL;
+    }
+    if (ctx != NULL) {
+      WebPSafeFree(ctx->vp8_mem_);
+      ctx->vp8_mem_ = mem;
+      ctx->vp8_mem_size_ = (size_t)size;
+    }
   }
   enc = (VP8Encoder*)mem;
   mem = (uint8_t*)WEBP_ALIGN(mem + sizeof(*enc));
@@ -231,6 +254,7 @@ static VP8Encoder* InitVP8Encoder(const WebPConfig* const config,
   enc->config_ = config;
   enc->profile_ = use_filter ? ((config->filter_type == 1) ? 0 : 1) : 2;
   enc->pic_ = picture;
+  enc->ctx_ = ctx;
   enc->percent_ = 0;
 
   MapConfigToTools(enc);
@@ -248,6 +272,7 @@ static VP8Encoder* InitVP8Encoder(const WebPConfig* const config,
     const float scale = 1.f + config->quality * 5.f / 100.f;  // in [1,6]
     VP8TBufferInit(&enc->tokens_, (int)(mb_w * mb_h * 4 * scale));
   }
+  if (ctx != NULL) VP8TBufferMovePages(&ctx->tokens_, &enc->tokens_);
   return enc;
 }
 
@@ -255,8 +280,13 @@ static int DeleteVP8Encoder(VP8Encoder* enc) {
   int ok = 1;
   if (enc != NULL) {
     ok = VP8EncDeleteAlpha(enc);
-    VP8TBufferClear(&enc->tokens_);
-    WebPSafeFree(enc);
+    if (enc->ctx_ != NULL) {
+      // The memory block itself is owned by the context.
+      VP8TBufferMovePages(&enc->tokens_, &enc->ctx_->tokens_);
+    } else {
+      VP8TBufferClear(&enc->tokens_);
+      WebPSafeFree(enc);
+    }
   }
   return ok;
 }
@@ -327,8 +357,11 @@ int WebPReportProgress(const WebPPicture* const pic,
 }
 //------------------------------------------------------------------------------
 
-int WebPEncode(const WebPConfig* config, WebPPicture* pic) {
+static int Encode(WebPEncoderContext* const ctx,
+                  const WebPConfig* config, WebPPicture* pic) {
   int ok = 0;
+  WebPEncStageStats* stage_stats;
+  WebPStopwatch watch;
   if (pic == NULL) return 0;
 
   pic->error_code = VP8_ENC_OK;  // all ok so far
@@ -344,6 +377,11 @@ int WebPEncode(const WebPConfig* config, WebPPicture* pic) {
   }
 
   if (pic->stats != NULL) memset(pic->stats, 0, sizeof(*pic->stats));
+  stage_stats = pic->stage_stats;
+  if (stage_stats != NULL) {
+    memset(stage_stats, 0, sizeof(*stage_stats));
+    WebPStopwatchReset(&watch);
+  }
 
   if (!config->lossless) {
     VP8Encoder* enc = NULL;
@@ -351,7 +389,10 @@ int WebPEncode(const WebPConfig* config, WebPPicture* pic) {
     if (pic->use_argb || pic->y == NULL || pic->u == NULL || pic->v == NULL) {
       // Make sure we have YUVA samples.
       if (config->use_sharp_yuv || (config->preprocessing & 4)) {
-        if (!WebPPictureSharpARGBToYUVA(pic)) {
+        const int num_threads =
+            (config->use_sharp_yuv == 2) ? SHARP_YUV_NUM_THREADS : 1;
+        if (!WebPPictureSharpARGBToYUVAWithOptions(pic, num_threads,
+                                                   config->low_memory)) {
           return 0;
         }
       } else {
@@ -372,11 +413,18 @@ int WebPEncode(const WebPConfig* config, WebPPicture* pic) {
     if (!config->exact) {
       WebPCleanupTransparentArea(pic);
     }
+    if (stage_stats != NULL) {
+      WebPEncStageStatsAddTime(stage_stats, WEBP_ENC_STAGE_CONVERSION, &watch);
+    }
 
-    enc = InitVP8Encoder(config, pic);
+    enc = InitVP8Encoder(config, pic, ctx);
     if (enc == NULL) return 0;  // pic->error is already set.
     // Note: each of the tasks below account for 20% in the progress report.
+    if (stage_stats != NULL) WebPStopwatchReset(&watch);
     ok = VP8EncAnalyze(enc);
+    if (stage_stats != NULL) {
+      WebPEncStageStatsAddTime(stage_stats, WEBP_ENC_STAGE_ANALYSIS, &watch);
+    }
 
     // Analysis is done, proceed to actual coding.
     ok = ok && VP8EncStartAlpha(enc);   // possibly done in parallel
@@ -387,24 +435,75 @@ int WebPEncode(const WebPConfig* config, WebPPicture* pic) {
     }
     ok = ok && VP8EncFinishAlpha(enc);
 
+    if (stage_stats != NULL) WebPStopwatchReset(&watch);
     ok = ok && VP8EncWrite(enc);
+    if (stage_stats != NULL) {
+      WebPEncStageStatsAddTime(stage_stats, WEBP_ENC_STAGE_ENCODE, &watch);
+    }
     StoreStats(enc);
     if (!ok) {
       VP8EncFreeBitWriters(enc);
     }
     ok &= DeleteVP8Encoder(enc);  // must always be called, even if !ok
   } else {
-    // Make sure we have ARGB samples.
+    int borrowed = 0;
+    // Make sure we have ARGB samples, reading borrowed ones in place if
+    // possible.
+    if (pic->argb == NULL && pic->view_ != NULL) {
+      borrowed = WebPPictureBorrowViewARGB(pic, config->exact);
+      if (!borrowed && !WebPPictureViewToARGB(pic)) return 0;
+    }
     if (pic->argb == NULL && !WebPPictureYUVAToARGB(pic)) {
       return 0;
     }
 
-    if (!config->exact) {
+    if (!config->exact && !borrowed) {
       WebPReplaceTransparentPixels(pic, 0x000000);
     }
+    if (stage_stats != NULL) {
+      WebPEncStageStatsAddTime(stage_stats, WEBP_ENC_STAGE_CONVERSION, &watch);
+    }
 
-    ok = VP8LEncodeImage(config, pic);  // Sets pic->error in case of problem.
+    // Sets pic->error in case of problem.
+    ok = VP8LEncodeImage(config, pic, (ctx != NULL) ? &ctx->vp8l_ : NULL);
+    if (borrowed) {
+      pic->argb = NULL;
+      pic->argb_stride = 0;
+    }
   }
 
   return ok;
 }
+
+int WebPEncode(const WebPConfig* config, WebPPicture* pic) {
+  return Encode(NULL, config, pic);
+}
+
+//------------------------------------------------------------------------------
+// Reusable encoding context
+
+WebPEncoderContext* WebPEncoderContextNew(void) {
+  WebPEncoderContext* const ctx =
+      (WebPEncoderContext*)WebPSafeCalloc(1ULL, sizeof(*ctx));
+  if (ctx != NULL) VP8TBufferInit(&ctx->tokens_, 0);
+  return ctx;
+}
+
+int WebPEncodeWithContext(WebPEncoderContext* context,
+                          const WebPConfig* config, WebPPicture* picture) {
+  return Encode(context, config, picture);
+}
+
+void WebPEncoderContextReset(WebPEncoderContext* context) {
+  if (context == NULL) return;
+  WebPSafeFree(context->vp8_mem_);
+  context->vp8_mem_ = NULL;
+  context->vp8_mem_size_ = 0;
+  VP8TBufferClear(&context->tokens_);
+  VP8LEncoderCacheClear(&context->vp8l_);
+}
+
+void WebPEncoderContextDelete(WebPEncoderContext* context) {
+  WebPEncoderContextReset(context);
+  WebPSafeFree(context);
+}
@@ -36,16 +36,10 @@ WebPMux* WebPNewInternal(int version) {
   }
 }
 
-// Delete all images in 'wpi_list'.
-static void DeleteAllImages(WebPMuxImage** const wpi_list) {
-  while (*wpi_list != NULL) {
-    *wpi_list = MuxImageDelete(*wpi_list);
-  }
-}
-
 static void MuxRelease(WebPMux* const mux) {
   assert(mux != NULL);
-  DeleteAllImages(&mux->images_);
+  MuxImageDeleteAll(mux);
+  WebPSafeFree(mux->image_index_);
   ChunkListDelete(&mux->vp8x_);
   ChunkListDelete(&mux->iccp_);
   ChunkListDelete(&mux->anim_);
@@ -245,7 +239,7 @@ WebPMuxError WebPMuxSetImage(WebPMux* mux, const WebPData* bitstream,
 
   if (mux->images_ != NULL) {
     // Only one 'simple image' can be added in mux. So, remove present images.
-    DeleteAllImages(&mux->images_);
+    MuxImageDeleteAll(mux);
   }
 
   MuxImageInit(&wpi);
@@ -253,7 +247,7 @@ WebPMuxError WebPMuxSetImage(WebPMux* mux, const WebPData* bitstream,
   if (err != WEBP_MUX_OK) goto Err;
 
   // Add this WebPMuxImage to mux.
-  err = MuxImagePush(&wpi, &mux->images_);
+  err = MuxImagePush(&wpi, mux);
   if (err != WEBP_MUX_OK) goto Err;
 
   // All is well.
@@ -314,7 +308,7 @@ WebPMuxError WebPMuxPushFrame(WebPMux* mux, const WebPMuxFrameInfo* info,
   }
 
   // Add this WebPMuxImage to mux.
-  err = MuxImagePush(&wpi, &mux->images_);
+  err = MuxImagePush(&wpi, mux);
   if (err != WEBP_MUX_OK) goto Err;
 
   // All is well.
@@ -382,7 +376,7 @@ WebPMuxError WebPMuxDeleteChunk(WebPMux* mux, const char fourcc[4]) {
 
 WebPMuxError WebPMuxDeleteFrame(WebPMux* mux, uint32_t nth) {
   if (mux == NULL) return WEBP_MUX_INVALID_ARGUMENT;
-  return MuxImageDeleteNth(&mux->images_, nth);
+  return MuxImageDeleteNth(mux, nth);
 }
 
 //------------------------------------------------------------------------------
@@ -556,7 +550,7 @@ static WebPMuxError MuxCleanup(WebPMux* const mux) {
   if (err != WEBP_MUX_OK) return err;
   if (num_frames == 1) {
     WebPMuxImage* frame = NULL;
-    err = MuxImageGetNth((const WebPMuxImage**)&mux->images_, 1, &frame);
+    err = MuxImageGetNth(mux, 1, &frame);
     if (err != WEBP_MUX_OK) return err;
     // We know that one frame does exist.
     assert(frame != NULL);
@@ -599,6 +593,21 @@ static uint8_t* ImageListEmit(const WebPMuxImage* wpi_list, uint8_t* dst) {
   return dst;
 }
 
+// Finalizes 'mux' before assembly and returns the total size of the output in
+// '*size'.
+static WebPMuxError MuxFinalize(WebPMux* const mux, size_t* const size) {
+  WebPMuxError err = MuxCleanup(mux);
+  if (err != WEBP_MUX_OK) return err;
+  err = CreateVP8XChunk(mux);
+  if (err != WEBP_MUX_OK) return err;
+
+  *size = ChunkListDiskSize(mux->vp8x_) + ChunkListDiskSize(mux->iccp_)
+        + ChunkListDiskSize(mux->anim_) + ImageListDiskSize(mux->images_)
+        + ChunkListDiskSize(mux->exif_) + ChunkListDiskSize(mux->xmp_)
+        + ChunkListDiskSize(mux->unknown_) + RIFF_HEADER_SIZE;
+  return WEBP_MUX_OK;
+}
+
 WebPMuxError WebPMuxAssemble(WebPMux* mux, WebPData* assembled_data) {
   size_t size = 0;
   uint8_t* data = NULL;
@@ -616,17 +625,10 @@ WebPMuxError WebPMuxAssemble(WebPMux* mux, WebPData* assembled_data) {
   }
 
   // Finalize mux.
-  err = MuxCleanup(mux);
-  if (err != WEBP_MUX_OK) return err;
-  err = CreateVP8XChunk(mux);
+  err = MuxFinalize(mux, &size);
   if (err != WEBP_MUX_OK) return err;
 
   // Allocate data.
-  size = ChunkListDiskSize(mux->vp8x_) + ChunkListDiskSize(mux->iccp_)
-       + ChunkListDiskSize(mux->anim_) + ImageListDiskSize(mux->images_)
-       + ChunkListDiskSize(mux->exif_) + ChunkListDiskSize(mux->xmp_)
-       + ChunkListDiskSize(mux->unknown_) + RIFF_HEADER_SIZE;
-
   data = (uint8_t*)WebPSafeMalloc(1ULL, size);
   if (data == NULL) return WEBP_MUX_MEMORY_ERROR;
 
@@ -656,4 +658,73 @@ WebPMuxError WebPMuxAssemble(WebPMux* mux, WebPData* assembled_data) {
   return err;
 }
 
+// Write out the RIFF header and all the chunks of 'mux' as segments.
+static void MuxEmitSegments(const WebPMux* const mux, size_t size,
+                            MuxSegmentWriter* const w) {
+  const WebPMuxImage* wpi;
+  uint8_t riff_header[RIFF_HEADER_SIZE];
+  MuxEmitRiffHeader(riff_header, size);
+  MuxSegmentWriterCopy(w, riff_header, sizeof(riff_header));
+  ChunkListEmitSegments(mux->vp8x_, w);
+  ChunkListEmitSegments(mux->iccp_, w);
+  ChunkListEmitSegments(mux->anim_, w);
+  for (wpi = mux->images_; wpi != NULL; wpi = wpi->next_) {
+    MuxImageEmitSegments(wpi, w);
+  }
+  ChunkListEmitSegments(mux->exif_, w);
+  ChunkListEmitSegments(mux->xmp_, w);
+  ChunkListEmitSegments(mux->unknown_, w);
+}
+
+WebPMuxError WebPMuxAssembleSegments(WebPMux* mux,
+                                     WebPMuxSegments* assembled_segments) {
+  size_t size = 0;
+  size_t segs_size;
+  uint8_t* memory;
+  MuxSegmentWriter w;
+  WebPMuxError err;
+
+  if (assembled_segments == NULL) {
+    return WEBP_MUX_INVALID_ARGUMENT;
+  }
+  memset(assembled_segments, 0, sizeof(*assembled_segments));
+
+  if (mux == NULL) {
+    return WEBP_MUX_INVALID_ARGUMENT;
+  }
+
+  err = MuxFinalize(mux, &size);
+  if (err != WEBP_MUX_OK) return err;
+  err = MuxValidate(mux);
+  if (err != WEBP_MUX_OK) return err;
+
+  // First pass: count the segments and the bytes to copy.
+  memset(&w, 0, sizeof(w));
+  MuxEmitSegments(mux, size, &w);
+
+  // Second pass: the segment list and the copied bytes share one allocation.
+  segs_size = (size_t)w.num_segs_ * sizeof(*w.segs_);
+  memory = (uint8_t*)WebPSafeMalloc(1ULL, segs_size + w.buf_size_);
+  if (memory == NULL) return WEBP_MUX_MEMORY_ERROR;
+  w.segs_ = (WebPData*)memory;
+  w.buf_ = memory + segs_size;
+  w.num_segs_ = 0;
+  w.buf_size_ = 0;
+  w.last_is_copy_ = 0;
+  MuxEmitSegments(mux, size, &w);
+
+  assembled_segments->segments = w.segs_;
+  assembled_segments->num_segments = w.num_segs_;
+  assembled_segments->size = size;
+  assembled_segments->memory_ = memory;
+  return WEBP_MUX_OK;
+}
+
+void WebPMuxSegmentsClear(WebPMuxSegments* assembled_segments) {
+  if (assembled_segments != NULL) {
+    WebPSafeFree(assembled_segments->memory_);
+    memset(assembled_segments, 0, sizeof(*assembled_segments));
+  }
+}
+
 //------------------------------------------------------------------------------
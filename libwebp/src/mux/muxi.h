@@ -60,6 +60,9 @@ struct WebPMuxImage {
 // Main mux object. Stores data chunks.
 struct WebPMux {
   WebPMuxImage*   images_;
+  WebPMuxImage**  image_index_;  // images_ as an array, in list order
+  int             num_images_;   // number of entries in image_index_
+  int             max_images_;   // allocated size of image_index_
   WebPChunk*      iccp_;
   WebPChunk*      exif_;
   WebPChunk*      xmp_;
@@ -163,6 +166,27 @@ size_t ChunkListDiskSize(const WebPChunk* chunk_list);
 // Write out the given list of chunks into 'dst'.
 uint8_t* ChunkListEmit(const WebPChunk* chunk_list, uint8_t* dst);
 
+//------------------------------------------------------------------------------
+// Segmented output.
+
+// Collects the output as a list of segments. When 'segs_' and 'buf_' are NULL,
+// only the number of segments and the size of the copied bytes are computed.
+typedef struct {
+  WebPData* segs_;      // output segments (can be NULL)
+  int num_segs_;        // number of segments
+  uint8_t* buf_;        // storage for the copied bytes (can be NULL)
+  size_t buf_size_;     // number of copied bytes
+  int last_is_copy_;    // true if the last segment ends at buf_ + buf_size_
+} MuxSegmentWriter;
+
+// Appends a copy of 'data' to the output.
+void MuxSegmentWriterCopy(MuxSegmentWriter* const w,
+                          const uint8_t* data, size_t size);
+
+// Write out the given list of chunks as segments.
+void ChunkListEmitSegments(const WebPChunk* chunk_list,
+                           MuxSegmentWriter* const w);
+
 //------------------------------------------------------------------------------
 // MuxImage object management.
 
@@ -194,14 +218,17 @@ static WEBP_INLINE int IsWPI(WebPChunkId id) {
   }
 }
 
-// Pushes 'wpi' at the end of 'wpi_list'.
-WebPMuxError MuxImagePush(const WebPMuxImage* wpi, WebPMuxImage** wpi_list);
+// Pushes 'wpi' at the end of the image list of 'mux'.
+WebPMuxError MuxImagePush(const WebPMuxImage* wpi, WebPMux* const mux);
 
-// Delete nth image in the image list.
-WebPMuxError MuxImageDeleteNth(WebPMuxImage** wpi_list, uint32_t nth);
+// Delete nth image in the image list of 'mux'.
+WebPMuxError MuxImageDeleteNth(WebPMux* const mux, uint32_t nth);
 
-// Get nth image in the image list.
-WebPMuxError MuxImageGetNth(const WebPMuxImage** wpi_list, uint32_t nth,
+// Delete all the images of 'mux'.
+void MuxImageDeleteAll(WebPMux* const mux);
+
+// Get nth image in the image list of 'mux'.
+WebPMuxError MuxImageGetNth(const WebPMux* const mux, uint32_t nth,
                             WebPMuxImage** wpi);
 
 // Total size of the given image.
@@ -210,6 +237,10 @@ size_t MuxImageDiskSize(const WebPMuxImage* const wpi);
 // Write out the given image into 'dst'.
 uint8_t* MuxImageEmit(const WebPMuxImage* const wpi, uint8_t* dst);
 
+// Write out the given image as segments.
+void MuxImageEmitSegments(const WebPMuxImage* const wpi,
+                          MuxSegmentWriter* const w);
+
 //------------------------------------------------------------------------------
 // Helper methods for mux.
 
@@ -217,6 +217,68 @@ size_t ChunkListDiskSize(const WebPChunk* chunk_list) {
   return size;
 }
 
+//------------------------------------------------------------------------------
+// Segmented chunk serialization.
+
+void MuxSegmentWriterCopy(MuxSegmentWriter* const w,
+                          const uint8_t* data, size_t size) {
+  if (size == 0) return;
+  if (!w->last_is_copy_) {
+    if (w->segs_ != NULL) {
+      w->segs_[w->num_segs_].bytes = w->buf_ + w->buf_size_;
+      w->segs_[w->num_segs_].size = 0;
+    }
+    ++w->num_segs_;
+    w->last_is_copy_ = 1;
+  }
+  if (w->buf_ != NULL) memcpy(w->buf_ + w->buf_size_, data, size);
+  if (w->segs_ != NULL) w->segs_[w->num_segs_ - 1].size += size;
+  w->buf_size_ += size;
+}
+
+// Payloads smaller than this are copied rather than referenced in place.
+#define MIN_REFERENCED_SIZE 256
+
+// Appends 'data' to the output, referencing it in place if large enough.
+static void SegmentWriterReference(MuxSegmentWriter* const w,
+                                   const uint8_t* data, size_t size) {
+  if (size < MIN_REFERENCED_SIZE) {
+    MuxSegmentWriterCopy(w, data, size);
+    return;
+  }
+  if (w->segs_ != NULL) {
+    w->segs_[w->num_segs_].bytes = data;
+    w->segs_[w->num_segs_].size = size;
+  }
+  ++w->num_segs_;
+  w->last_is_copy_ = 0;
+}
+
+// Writes the header of a chunk with payload 'data', announcing a chunk size of
+// 'chunk_size', followed by the payload and its padding.
+static void ChunkEmitSegmentsWithSize(const WebPChunk* const chunk,
+                                      size_t chunk_size,
+                                      MuxSegmentWriter* const w) {
+  const size_t data_size = chunk->data_.size;
+  uint8_t header[CHUNK_HEADER_SIZE];
+  static const uint8_t kPadding = 0;
+  assert(chunk->tag_ != NIL_TAG);
+  assert(chunk_size == (uint32_t)chunk_size);
+  PutLE32(header + 0, chunk->tag_);
+  PutLE32(header + TAG_SIZE, (uint32_t)chunk_size);
+  MuxSegmentWriterCopy(w, header, sizeof(header));
+  SegmentWriterReference(w, chunk->data_.bytes, data_size);
+  if (data_size & 1) MuxSegmentWriterCopy(w, &kPadding, 1);  // Add padding.
+}
+
+void ChunkListEmitSegments(const WebPChunk* chunk_list,
+                           MuxSegmentWriter* const w) {
+  while (chunk_list != NULL) {
+    ChunkEmitSegmentsWithSize(chunk_list, chunk_list->data_.size, w);
+    chunk_list = chunk_list->next_;
+  }
+}
+
 //------------------------------------------------------------------------------
 // Life of a MuxImage object.
 
@@ -272,40 +334,25 @@ int MuxImageCount(const WebPMuxImage* wpi_list, WebPChunkId id) {
   return count;
 }
 
-// Outputs a pointer to 'prev_wpi->next_',
-//   where 'prev_wpi' is the pointer to the image at position (nth - 1).
-// Returns true if nth image was found.
-static int SearchImageToGetOrDelete(WebPMuxImage** wpi_list, uint32_t nth,
-                                    WebPMuxImage*** const location) {
-  uint32_t count = 0;
-  assert(wpi_list);
-  *location = wpi_list;
-
-  if (nth == 0) {
-    nth = MuxImageCount(*wpi_list, WEBP_CHUNK_NIL);
-    if (nth == 0) return 0;  // Not found.
-  }
-
-  while (*wpi_list != NULL) {
-    WebPMuxImage* const cur_wpi = *wpi_list;
-    ++count;
-    if (count == nth) return 1;  // Found.
-    wpi_list = &cur_wpi->next_;
-    *location = wpi_list;
-  }
-  return 0;  // Not found.
-}
-
 //------------------------------------------------------------------------------
 // MuxImage writer methods.
 
-WebPMuxError MuxImagePush(const WebPMuxImage* wpi, WebPMuxImage** wpi_list) {
+WebPMuxError MuxImagePush(const WebPMuxImage* wpi, WebPMux* const mux) {
   WebPMuxImage* new_wpi;
+  assert(mux != NULL);
 
-  while (*wpi_list != NULL) {
-    WebPMuxImage* const cur_wpi = *wpi_list;
-    if (cur_wpi->next_ == NULL) break;
-    wpi_list = &cur_wpi->next_;
+  if (mux->num_images_ == mux->max_images_) {
+    const int new_max = (mux->max_images_ > 0) ? 2 * mux->max_images_ : 8;
+    WebPMuxImage** const new_index =
+        (WebPMuxImage**)WebPSafeMalloc(new_max, sizeof(*new_index));
+    if (new_index == NULL) return WEBP_MUX_MEMORY_ERROR;
+    if (mux->num_images_ > 0) {
+      memcpy(new_index, mux->image_index_,
+             mux->num_images_ * sizeof(*new_index));
+    }
+    WebPSafeFree(mux->image_index_);
+    mux->image_index_ = new_index;
+    mux->max_images_ = new_max;
   }
 
   new_wpi = (WebPMuxImage*)WebPSafeMalloc(1ULL, sizeof(*new_wpi));
@@ -313,11 +360,12 @@ WebPMuxError MuxImagePush(const WebPMuxImage* wpi, WebPMuxImage** wpi_list) {
   *new_wpi = *wpi;
   new_wpi->next_ = NULL;
 
-  if (*wpi_list != NULL) {
-    (*wpi_list)->next_ = new_wpi;
+  if (mux->num_images_ > 0) {
+    mux->image_index_[mux->num_images_ - 1]->next_ = new_wpi;
   } else {
-    *wpi_list = new_wpi;
+    mux->images_ = new_wpi;
   }
+  mux->image_index_[mux->num_images_++] = new_wpi;
   return WEBP_MUX_OK;
 }
 
@@ -331,27 +379,41 @@ WebPMuxImage* MuxImageDelete(WebPMuxImage* const wpi) {
   return next;
 }
 
-WebPMuxError MuxImageDeleteNth(WebPMuxImage** wpi_list, uint32_t nth) {
-  assert(wpi_list);
-  if (!SearchImageToGetOrDelete(wpi_list, nth, &wpi_list)) {
-    return WEBP_MUX_NOT_FOUND;
-  }
-  *wpi_list = MuxImageDelete(*wpi_list);
+WebPMuxError MuxImageDeleteNth(WebPMux* const mux, uint32_t nth) {
+  WebPMuxImage** location;
+  int i;
+  assert(mux != NULL);
+  if (nth == 0) nth = (uint32_t)mux->num_images_;  // Last image.
+  if (nth == 0 || nth > (uint32_t)mux->num_images_) return WEBP_MUX_NOT_FOUND;
+
+  i = (int)nth - 1;
+  location = (i > 0) ? &mux->image_index_[i - 1]->next_ : &mux->images_;
+  assert(*location == mux->image_index_[i]);
+  *location = MuxImageDelete(*location);
+  memmove(&mux->image_index_[i], &mux->image_index_[i + 1],
+          (mux->num_images_ - 1 - i) * sizeof(*mux->image_index_));
+  --mux->num_images_;
   return WEBP_MUX_OK;
 }
 
+void MuxImageDeleteAll(WebPMux* const mux) {
+  assert(mux != NULL);
+  while (mux->images_ != NULL) {
+    mux->images_ = MuxImageDelete(mux->images_);
+  }
+  mux->num_images_ = 0;
+}
+
 //------------------------------------------------------------------------------
 // MuxImage reader methods.
 
-WebPMuxError MuxImageGetNth(const WebPMuxImage** wpi_list, uint32_t nth,
+WebPMuxError MuxImageGetNth(const WebPMux* const mux, uint32_t nth,
                             WebPMuxImage** wpi) {
-  assert(wpi_list);
+  assert(mux != NULL);
   assert(wpi);
-  if (!SearchImageToGetOrDelete((WebPMuxImage**)wpi_list, nth,
-                                (WebPMuxImage***)&wpi_list)) {
-    return WEBP_MUX_NOT_FOUND;
-  }
-  *wpi = (WebPMuxImage*)*wpi_list;
+  if (nth == 0) nth = (uint32_t)mux->num_images_;  // Last image.
+  if (nth == 0 || nth > (uint32_t)mux->num_images_) return WEBP_MUX_NOT_FOUND;
+  *wpi = mux->image_index_[nth - 1];
   return WEBP_MUX_OK;
 }
 
@@ -399,6 +461,24 @@ uint8_t* MuxImageEmit(const WebPMuxImage* const wpi, uint8_t* dst) {
   return dst;
 }
 
+void MuxImageEmitSegments(const WebPMuxImage* const wpi,
+                          MuxSegmentWriter* const w) {
+  // Same ordering as MuxImageEmit().
+  assert(wpi);
+  if (wpi->header_ != NULL) {
+    assert(wpi->header_->tag_ == kChunks[IDX_ANMF].tag);
+    ChunkEmitSegmentsWithSize(wpi->header_,
+                              MuxImageDiskSize(wpi) - CHUNK_HEADER_SIZE, w);
+  }
+  if (wpi->alpha_ != NULL) {
+    ChunkEmitSegmentsWithSize(wpi->alpha_, wpi->alpha_->data_.size, w);
+  }
+  if (wpi->img_ != NULL) {
+    ChunkEmitSegmentsWithSize(wpi->img_, wpi->img_->data_.size, w);
+  }
+  if (wpi->unknown_ != NULL) ChunkListEmitSegments(wpi->unknown_, w);
+}
+
 //------------------------------------------------------------------------------
 // Helper methods for mux.
 
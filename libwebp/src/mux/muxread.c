@@ -262,7 +262,7 @@ WebPMux* WebPMuxCreateInternal(const WebPData* bitstream, int copy_data,
         wpi->is_partial_ = 0;  // wpi is completely filled.
  PushImage:
         // Add this to mux->images_ list.
-        if (MuxImagePush(wpi, &mux->images_) != WEBP_MUX_OK) goto Err;
+        if (MuxImagePush(wpi, mux) != WEBP_MUX_OK) goto Err;
         MuxImageInit(wpi);  // Reset for reading next image.
         break;
       case WEBP_CHUNK_ANMF:
@@ -494,7 +494,7 @@ WebPMuxError WebPMuxGetFrame(
   }
 
   // Get the nth WebPMuxImage.
-  err = MuxImageGetNth((const WebPMuxImage**)&mux->images_, nth, &wpi);
+  err = MuxImageGetNth(mux, nth, &wpi);
   if (err != WEBP_MUX_OK) return err;
 
   // Get frame info.
@@ -41,6 +41,8 @@ void VP8InitBitReader(VP8BitReader* const br,
   br->value_   = 0;
   br->bits_    = -8;   // to load the very first 8bits
   br->eof_     = 0;
+  br->segments_ = NULL;
+  br->next_segment_ = 0;
   VP8BitReaderSetBuffer(br, start, size);
   VP8LoadNewBytes(br);
 }
@@ -53,6 +55,27 @@ void VP8RemapBitReader(VP8BitReader* const br, ptrdiff_t offset) {
   }
 }
 
+void VP8BitReaderSetSegments(VP8BitReader* const br,
+                             const VP8InputSegments* const segments) {
+  br->segments_ = segments;
+  br->next_segment_ = segments->first_ + segments->num_;
+}
+
+// Switches to the next input segment, if there is one available.
+static int LoadNextSegment(VP8BitReader* const br) {
+  const VP8InputSegments* const segments = br->segments_;
+  if (segments != NULL &&
+      br->next_segment_ < segments->first_ + segments->num_) {
+    const VP8InputSegment* const seg =
+        &segments->segments_[br->next_segment_ - segments->first_];
+    assert(br->next_segment_ >= segments->first_);
+    VP8BitReaderSetBuffer(br, seg->buf_, seg->size_);
+    ++br->next_segment_;
+    return 1;
+  }
+  return 0;
+}
+
 const uint8_t kVP8Log2Range[128] = {
      7, 6, 6, 5, 5, 5, 5, 4, 4, 4, 4, 4, 4, 4, 4,
   3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3,
@@ -88,7 +111,7 @@ const uint8_t kVP8NewRange[128] = {
 void VP8LoadFinalBytes(VP8BitReader* const br) {
   assert(br != NULL && br->buf_ != NULL);
   // Only read 8bits at a time
-  if (br->buf_ < br->buf_end_) {
+  if (br->buf_ < br->buf_end_ || LoadNextSegment(br)) {
     br->bits_ += 8;
     br->value_ = (bit_t)(*br->buf_++) | (br->value_ << 8);
   } else if (!br->eof_) {
@@ -151,6 +174,8 @@ void VP8LInitBitReader(VP8LBitReader* const br, const uint8_t* const start,
   br->val_ = 0;
   br->bit_pos_ = 0;
   br->eos_ = 0;
+  br->segments_ = NULL;
+  br->next_segment_ = 0;
 
   if (length > sizeof(br->val_)) {
     length = sizeof(br->val_);
@@ -174,6 +199,29 @@ void VP8LBitReaderSetBuffer(VP8LBitReader* const br,
   br->eos_ = (br->pos_ > br->len_) || VP8LIsEndOfStream(br);
 }
 
+void VP8LBitReaderSetSegments(VP8LBitReader* const br,
+                              const VP8InputSegments* const segments) {
+  br->segments_ = segments;
+  br->next_segment_ = segments->first_ + segments->num_;
+}
+
+// Switches to the next input segment, if there is one available.
+static int VP8LLoadNextSegment(VP8LBitReader* const br) {
+  const VP8InputSegments* const segments = br->segments_;
+  if (segments != NULL &&
+      br->next_segment_ < segments->first_ + segments->num_) {
+    const VP8InputSegment* const seg =
+        &segments->segments_[br->next_segment_ - segments->first_];
+    assert(br->next_segment_ >= segments->first_);
+    br->buf_ = seg->buf_;
+    br->len_ = seg->size_;
+    br->pos_ = 0;
+    ++br->next_segment_;
+    return 1;
+  }
+  return 0;
+}
+
 static void VP8LSetEndOfStream(VP8LBitReader* const br) {
   br->eos_ = 1;
   br->bit_pos_ = 0;  // To avoid undefined behaviour with shifts.
@@ -181,7 +229,8 @@ static void VP8LSetEndOfStream(VP8LBitReader* const br) {
 
 // If not at EOS, reload up to VP8L_LBITS byte-by-byte
 static void ShiftBytes(VP8LBitReader* const br) {
-  while (br->bit_pos_ >= 8 && br->pos_ < br->len_) {
+  while (br->bit_pos_ >= 8 &&
+         (br->pos_ < br->len_ || VP8LLoadNextSegment(br))) {
     br->val_ >>= 8;
     br->val_ |= ((vp8l_val_t)br->buf_[br->pos_]) << (VP8L_LBITS - 8);
     ++br->pos_;
@@ -88,6 +88,25 @@ typedef uint32_t bit_t;
 
 typedef uint32_t range_t;
 
+//------------------------------------------------------------------------------
+// Segmented input
+
+// List of non-contiguous byte ranges that follow each other in the bitstream.
+// Once a bit-reader attached to such a list reaches the end of its buffer, it
+// moves on to the next segment, if available. Segments are identified by their
+// absolute index in the sequence, so that leading ones can be dropped once
+// they are fully read.
+typedef struct {
+  const uint8_t* buf_;
+  size_t size_;               // always > 0
+} VP8InputSegment;
+
+typedef struct {
+  VP8InputSegment* segments_;
+  int first_;                 // absolute index of segments_[0]
+  int num_;                   // number of segments in segments_[]
+} VP8InputSegments;
+
 //------------------------------------------------------------------------------
 // Bitreader
 
@@ -102,6 +121,9 @@ struct VP8BitReader {
   const uint8_t* buf_end_;    // end of read buffer
   const uint8_t* buf_max_;    // max packed-read position on buffer
   int eof_;                   // true if input is exhausted
+  // segmented input
+  const VP8InputSegments* segments_;  // next buffers to read, or NULL
+  int next_segment_;          // absolute index of the next segment to read
 };
 
 // Initialize the bit reader and the boolean decoder.
@@ -115,6 +137,11 @@ void VP8BitReaderSetBuffer(VP8BitReader* const br,
 // relative offset 'offset'.
 void VP8RemapBitReader(VP8BitReader* const br, ptrdiff_t offset);
 
+// Makes the reader continue with the segments appended to 'segments' from now
+// on, once the current buffer is exhausted.
+void VP8BitReaderSetSegments(VP8BitReader* const br,
+                             const VP8InputSegments* const segments);
+
 // return the next value made of 'num_bits' bits
 uint32_t VP8GetValue(VP8BitReader* const br, int num_bits, const char label[]);
 
@@ -147,6 +174,8 @@ typedef struct {
   size_t         pos_;        // byte position in buf_
   int            bit_pos_;    // current bit-reading position in val_
   int            eos_;        // true if a bit was read past the end of buffer
+  const VP8InputSegments* segments_;  // next buffers to read, or NULL
+  int            next_segment_;  // absolute index of the next segment to read
 } VP8LBitReader;
 
 void VP8LInitBitReader(VP8LBitReader* const br,
@@ -157,6 +186,10 @@ void VP8LInitBitReader(VP8LBitReader* const br,
 void VP8LBitReaderSetBuffer(VP8LBitReader* const br,
                             const uint8_t* const buffer, size_t length);
 
+// Same as VP8BitReaderSetSegments(), for the lossless bit-reader.
+void VP8LBitReaderSetSegments(VP8LBitReader* const br,
+                              const VP8InputSegments* const segments);
+
 // Reads the specified number of bits from read buffer.
 // Flags an error in case end_of_stream or n_bits is more than the allowed limit
 // of VP8L_MAX_NUM_BIT_READ (inclusive).
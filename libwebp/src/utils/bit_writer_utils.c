@@ -239,6 +239,15 @@ int VP8LBitWriterInit(VP8LBitWriter* const bw, size_t expected_size) {
   return VP8LBitWriterResize(bw, expected_size);
 }
 
+int VP8LBitWriterReinit(VP8LBitWriter* const bw, size_t expected_size) {
+  uint8_t* const buf = bw->buf_;
+  uint8_t* const end = bw->end_;
+  memset(bw, 0, sizeof(*bw));
+  bw->buf_ = bw->cur_ = buf;
+  bw->end_ = end;
+  return VP8LBitWriterResize(bw, expected_size);
+}
+
 int VP8LBitWriterClone(const VP8LBitWriter* const src,
                        VP8LBitWriter* const dst) {
   const size_t current_size = src->cur_ - src->buf_;
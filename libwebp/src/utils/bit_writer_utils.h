@@ -106,6 +106,10 @@ static WEBP_INLINE size_t VP8LBitWriterNumBytes(const VP8LBitWriter* const bw) {
 
 // Returns false in case of memory allocation error.
 int VP8LBitWriterInit(VP8LBitWriter* const bw, size_t expected_size);
+// Same as VP8LBitWriterInit(), but reusing the buffer of an already
+// initialized 'bw' if it is large enough.
+// Returns false in case of memory allocation error.
+int VP8LBitWriterReinit(VP8LBitWriter* const bw, size_t expected_size);
 // Returns false in case of memory allocation error.
 int VP8LBitWriterClone(const VP8LBitWriter* const src,
                        VP8LBitWriter* const dst);
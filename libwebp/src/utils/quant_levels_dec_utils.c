@@ -18,6 +18,7 @@
 
 #include <string.h>   // for memset
 
+#include "src/dsp/dsp.h"
 #include "src/utils/utils.h"
 
 // #define USE_DITHERING   // uncomment to enable ordered dithering (not vital)
@@ -42,7 +43,7 @@ static const uint8_t kOrderedDither[DSIZE][DSIZE] = {
 #define DFIX 0
 #endif
 
-typedef struct {
+struct WebPSmoothParams {
   int width_, height_;  // dimension
   int stride_;          // stride in bytes
   int row_;             // current input row being processed
@@ -67,36 +68,25 @@ typedef struct {
   int min_level_dist_;   // smallest distance between two consecutive levels
 
   int16_t* correction_;  // size = 1 + 2*LUT_SIZE  -> ~4k memory
-} SmoothParams;
+};
 
 //------------------------------------------------------------------------------
 
+#if defined(USE_DITHERING)
 #define CLIP_8b_MASK (int)(~0U << (8 + DFIX))
 static WEBP_INLINE uint8_t clip_8b(int v) {
   return (!(v & CLIP_8b_MASK)) ? (uint8_t)(v >> DFIX) : (v < 0) ? 0u : 255u;
 }
 #undef CLIP_8b_MASK
+#endif
 
 // vertical accumulation
-static void VFilter(SmoothParams* const p) {
-  const uint8_t* src = p->src_;
-  const int w = p->width_;
-  uint16_t* const cur = p->cur_;
-  const uint16_t* const top = p->top_;
-  uint16_t* const out = p->end_;
-  uint16_t sum = 0;               // all arithmetic is modulo 16bit
-  int x;
-
-  for (x = 0; x < w; ++x) {
-    uint16_t new_value;
-    sum += src[x];
-    new_value = top[x] + sum;
-    out[x] = new_value - cur[x];  // vertical sum of 'r' pixels.
-    cur[x] = new_value;
-  }
+static void VFilter(WebPSmoothParams* const p) {
+  // vertical sum of 'r' pixels goes to p->end_
+  WebPSmoothLevelsVFilter(p->src_, p->top_, p->cur_, p->end_, p->width_);
   // move input pointers one row down
   p->top_ = p->cur_;
-  p->cur_ += w;
+  p->cur_ += p->width_;
   if (p->cur_ == p->end_) p->cur_ = p->start_;  // roll-over
   // We replicate edges, as it's somewhat easier as a boundary condition.
   // That's why we don't update the 'src' pointer on top/bottom area:
@@ -107,7 +97,7 @@ static void VFilter(SmoothParams* const p) {
 
 // horizontal accumulation. We use mirror replication of missing pixels, as it's
 // a little easier to implement (surprisingly).
-static void HFilter(SmoothParams* const p) {
+static void HFilter(WebPSmoothParams* const p) {
   const uint16_t* const in = p->end_;
   uint16_t* const out = p->average_;
   const uint32_t scale = p->scale_;
@@ -119,9 +109,10 @@ static void HFilter(SmoothParams* const p) {
     const uint16_t delta = in[x + r - 1] + in[r - x];
     out[x] = (delta * scale) >> FIX;
   }
-  for (; x < w - r; ++x) {     // bulk middle run
-    const uint16_t delta = in[x + r] - in[x - r - 1];
-    out[x] = (delta * scale) >> FIX;
+  if (x < w - r) {             // bulk middle run
+    WebPSmoothLevelsHFilter(in + x + r, in + x - r - 1, scale, out + x,
+                            w - r - x);
+    x = w - r;
   }
   for (; x < w; ++x) {         // right mirroring
     const uint16_t delta =
@@ -131,26 +122,26 @@ static void HFilter(SmoothParams* const p) {
 }
 
 // emit one filtered output row
-static void ApplyFilter(SmoothParams* const p) {
+static void ApplyFilter(WebPSmoothParams* const p) {
+#if defined(USE_DITHERING)
   const uint16_t* const average = p->average_;
   const int w = p->width_;
   const int16_t* const correction = p->correction_;
-#if defined(USE_DITHERING)
   const uint8_t* const dither = kOrderedDither[p->row_ % DSIZE];
-#endif
   uint8_t* const dst = p->dst_;
   int x;
   for (x = 0; x < w; ++x) {
     const int v = dst[x];
     if (v < p->max_ && v > p->min_) {
       const int c = (v << DFIX) + correction[average[x] - (v << LFIX)];
-#if defined(USE_DITHERING)
       dst[x] = clip_8b(c + dither[x % DSIZE]);
-#else
-      dst[x] = clip_8b(c);
-#endif
     }
   }
+#else
+  // (this assumes LFIX = 2)
+  WebPSmoothLevelsApply(p->average_, p->correction_, p->min_, p->max_,
+                        p->dst_, p->width_);
+#endif
   p->dst_ += p->stride_;  // advance output pointer
 }
 
@@ -180,21 +171,18 @@ static void InitCorrectionLUT(int16_t* const lut, int min_dist) {
   lut[0] = 0;
 }
 
-static void CountLevels(SmoothParams* const p) {
+static void CountLevels(WebPSmoothParams* const p) {
   int i, j, last_level;
   uint8_t used_levels[256] = { 0 };
   const uint8_t* data = p->src_;
-  p->min_ = 255;
-  p->max_ = 0;
   for (j = 0; j < p->height_; ++j) {
     for (i = 0; i < p->width_; ++i) {
-      const int v = data[i];
-      if (v < p->min_) p->min_ = v;
-      if (v > p->max_) p->max_ = v;
-      used_levels[v] = 1;
+      used_levels[data[i]] = 1;
     }
     data += p->stride_;
   }
+  for (p->min_ = 0; p->min_ < 255 && !used_levels[p->min_]; ++p->min_) {}
+  for (p->max_ = 255; p->max_ > 0 && !used_levels[p->max_]; --p->max_) {}
   // Compute the mininum distance between two non-zero levels.
   p->min_level_dist_ = p->max_ - p->min_;
   last_level = -1;
@@ -214,7 +202,7 @@ static void CountLevels(SmoothParams* const p) {
 
 // Initialize all params.
 static int InitParams(uint8_t* const data, int width, int height, int stride,
-                      int radius, SmoothParams* const p) {
+                      int radius, WebPSmoothParams* const p) {
   const int R = 2 * radius + 1;  // total size of the kernel
 
   const size_t size_scratch_m = (R + 1) * width * sizeof(*p->start_);
@@ -255,37 +243,66 @@ static int InitParams(uint8_t* const data, int width, int height, int stride,
   return 1;
 }
 
-static void CleanupParams(SmoothParams* const p) {
+static void CleanupParams(WebPSmoothParams* const p) {
   WebPSafeFree(p->mem_);
 }
 
-int WebPDequantizeLevels(uint8_t* const data, int width, int height, int stride,
-                         int strength) {
+WebPSmoothParams* WebPDequantizeLevelsNew(uint8_t* const data, int width,
+                                          int height, int stride,
+                                          int strength) {
+  WebPSmoothParams* p;
   int radius = 4 * strength / 100;
 
-  if (strength < 0 || strength > 100) return 0;
-  if (data == NULL || width <= 0 || height <= 0) return 0;  // bad params
+  if (strength < 0 || strength > 100) return NULL;
+  if (data == NULL || width <= 0 || height <= 0) return NULL;  // bad params
 
   // limit the filter size to not exceed the image dimensions
   if (2 * radius + 1 > width) radius = (width - 1) >> 1;
   if (2 * radius + 1 > height) radius = (height - 1) >> 1;
 
+  p = (WebPSmoothParams*)WebPSafeCalloc(1ULL, sizeof(*p));
+  if (p == NULL) return NULL;
+  p->height_ = height;
   if (radius > 0) {
-    SmoothParams p;
-    memset(&p, 0, sizeof(p));
-    if (!InitParams(data, width, height, stride, radius, &p)) return 0;
-    if (p.num_levels_ > 2) {
-      for (; p.row_ < p.height_; ++p.row_) {
-        VFilter(&p);  // accumulate average of input
-        // Need to wait few rows in order to prime the filter,
-        // before emitting some output.
-        if (p.row_ >= p.radius_) {
-          HFilter(&p);
-          ApplyFilter(&p);
-        }
-      }
+    VP8FiltersInit();
+    if (!InitParams(data, width, height, stride, radius, p)) {
+      WebPDequantizeLevelsDelete(p);
+      return NULL;
+    }
+    if (p->num_levels_ <= 2) {  // nothing to smooth
+      CleanupParams(p);
+      p->mem_ = NULL;
     }
-    CleanupParams(&p);
   }
+  return p;
+}
+
+void WebPDequantizeLevelsRows(WebPSmoothParams* const p, int last_row) {
+  if (p == NULL || p->mem_ == NULL) return;
+  // Output rows lag 'radius' rows behind the input ones, which need to prime
+  // the filter.
+  for (; p->row_ < p->height_ && p->row_ - p->radius_ < last_row; ++p->row_) {
+    VFilter(p);  // accumulate average of input
+    if (p->row_ >= p->radius_) {
+      HFilter(p);
+      ApplyFilter(p);
+    }
+  }
+}
+
+void WebPDequantizeLevelsDelete(WebPSmoothParams* const p) {
+  if (p != NULL) {
+    CleanupParams(p);
+    WebPSafeFree(p);
+  }
+}
+
+int WebPDequantizeLevels(uint8_t* const data, int width, int height, int stride,
+                         int strength) {
+  WebPSmoothParams* const p =
+      WebPDequantizeLevelsNew(data, width, height, stride, strength);
+  if (p == NULL) return 0;
+  WebPDequantizeLevelsRows(p, height);
+  WebPDequantizeLevelsDelete(p);
   return 1;
 }
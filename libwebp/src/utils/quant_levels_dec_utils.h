@@ -28,6 +28,18 @@ extern "C" {
 int WebPDequantizeLevels(uint8_t* const data, int width, int height, int stride,
                          int strength);
 
+// Streaming variant of the above. The levels distribution is analyzed over
+// the whole 'data' at creation, but the smoothing itself is done band by band
+// by WebPDequantizeLevelsRows(), which only reads 'radius' rows ahead of the
+// output (radius = 4 * strength / 100). Returns NULL in case of error.
+typedef struct WebPSmoothParams WebPSmoothParams;
+WebPSmoothParams* WebPDequantizeLevelsNew(uint8_t* const data, int width,
+                                          int height, int stride,
+                                          int strength);
+// Smoothes all rows before 'last_row' that were not already processed.
+void WebPDequantizeLevelsRows(WebPSmoothParams* const p, int last_row);
+void WebPDequantizeLevelsDelete(WebPSmoothParams* const p);
+
 #ifdef __cplusplus
 }    // extern "C"
 #endif
@@ -0,0 +1,76 @@
+// Copyright 2025 Google Inc. All Rights Reserved.
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the COPYING file in the root of the source
+// tree. An additional intellectual property rights grant can be found
+// in the file PATENTS. All contributing project authors may
+// be found in the AUTHORS file in the root of the source tree.
+// -----------------------------------------------------------------------------
+//
+// Wall-clock and CPU time measurement.
+
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 199309L   // for clock_gettime()
+#endif
+
+#include "src/utils/stopwatch_utils.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+#if defined(_WIN32)
+
+static void GetTimes(double* const wall, double* const cpu) {
+  LARGE_INTEGER frequency, counter;
+  FILETIME creation_time, exit_time, kernel_time, user_time;
+  QueryPerformanceFrequency(&frequency);
+  QueryPerformanceCounter(&counter);
+  *wall = (double)counter.QuadPart / (double)frequency.QuadPart;
+  if (GetThreadTimes(GetCurrentThread(), &creation_time, &exit_time,
+                     &kernel_time, &user_time)) {
+    // Both times are in 100ns units.
+    const uint64_t kernel =
+        ((uint64_t)kernel_time.dwHighDateTime << 32) | kernel_time.dwLowDateTime;
+    const uint64_t user =
+        ((uint64_t)user_time.dwHighDateTime << 32) | user_time.dwLowDateTime;
+    *cpu = (double)(kernel + user) * 1e-7;
+  } else {
+    *cpu = 0.;
+  }
+}
+
+#else  // !_WIN32
+
+static double GetClock(clockid_t clock_id) {
+  struct timespec t;
+  if (clock_gettime(clock_id, &t) != 0) return 0.;
+  return (double)t.tv_sec + (double)t.tv_nsec * 1e-9;
+}
+
+static void GetTimes(double* const wall, double* const cpu) {
+  *wall = GetClock(CLOCK_MONOTONIC);
+#if defined(CLOCK_THREAD_CPUTIME_ID)
+  *cpu = GetClock(CLOCK_THREAD_CPUTIME_ID);
+#else
+  *cpu = (double)clock() / CLOCKS_PER_SEC;   // process time as a fallback
+#endif
+}
+
+#endif  // _WIN32
+
+void WebPStopwatchReset(WebPStopwatch* const watch) {
+  GetTimes(&watch->wall_, &watch->cpu_);
+}
+
+void WebPStopwatchAdd(WebPStopwatch* const watch,
+                      double* const wall, double* const cpu) {
+  double now_wall, now_cpu;
+  GetTimes(&now_wall, &now_cpu);
+  *wall += now_wall - watch->wall_;
+  *cpu += now_cpu - watch->cpu_;
+  watch->wall_ = now_wall;
+  watch->cpu_ = now_cpu;
+}
@@ -0,0 +1,44 @@
+// Copyright 2025 Google Inc. All Rights Reserved.
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the COPYING file in the root of the source
+// tree. An additional intellectual property rights grant can be found
+// in the file PATENTS. All contributing project authors may
+// be found in the AUTHORS file in the root of the source tree.
+// -----------------------------------------------------------------------------
+//
+// Wall-clock and CPU time measurement, for the timings reported in the
+// decoder and encoder statistics.
+
+#ifndef WEBP_UTILS_STOPWATCH_UTILS_H_
+#define WEBP_UTILS_STOPWATCH_UTILS_H_
+
+#ifdef HAVE_CONFIG_H
+#include "src/webp/config.h"
+#endif
+
+#include "src/webp/types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+  double wall_;   // wall-clock time, in seconds
+  double cpu_;    // CPU time of the calling thread, in seconds
+} WebPStopwatch;
+
+// Starts 'watch' from the current times.
+void WebPStopwatchReset(WebPStopwatch* const watch);
+
+// Adds the wall-clock and CPU times elapsed since the last reset of 'watch'
+// to 'wall' and 'cpu', then restarts 'watch' from the current times. This way,
+// consecutive calls split a sequence of tasks into stages.
+void WebPStopwatchAdd(WebPStopwatch* const watch,
+                      double* const wall, double* const cpu);
+
+#ifdef __cplusplus
+}    // extern "C"
+#endif
+
+#endif  // WEBP_UTILS_STOPWATCH_UTILS_H_
@@ -367,3 +367,49 @@ const WebPWorkerInterface* WebPGetWorkerInterface(void) {
 }
 
 //------------------------------------------------------------------------------
+
+int WebPSharedCounterInit(WebPSharedCounter* const counter, int value) {
+  counter->impl_ = NULL;
+  counter->value = value;
+#ifdef WEBP_USE_THREAD
+  {
+    pthread_mutex_t* const mutex =
+        (pthread_mutex_t*)WebPSafeMalloc(1ULL, sizeof(*mutex));
+    if (mutex == NULL) return 0;
+    if (pthread_mutex_init(mutex, NULL)) {
+      WebPSafeFree(mutex);
+      return 0;
+    }
+    counter->impl_ = (void*)mutex;
+  }
+#endif
+  return 1;
+}
+
+int WebPSharedCounterNext(WebPSharedCounter* const counter) {
+  int value;
+#ifdef WEBP_USE_THREAD
+  pthread_mutex_t* const mutex = (pthread_mutex_t*)counter->impl_;
+  assert(mutex != NULL);
+  pthread_mutex_lock(mutex);
+  value = counter->value++;
+  pthread_mutex_unlock(mutex);
+#else
+  value = counter->value++;
+#endif
+  return value;
+}
+
+void WebPSharedCounterClear(WebPSharedCounter* const counter) {
+#ifdef WEBP_USE_THREAD
+  if (counter->impl_ != NULL) {
+    pthread_mutex_destroy((pthread_mutex_t*)counter->impl_);
+    WebPSafeFree(counter->impl_);
+    counter->impl_ = NULL;
+  }
+#else
+  (void)counter;
+#endif
+}
+
+//------------------------------------------------------------------------------
@@ -81,6 +81,22 @@ WEBP_EXTERN int WebPSetWorkerInterface(
 // Retrieve the currently set thread worker interface.
 WEBP_EXTERN const WebPWorkerInterface* WebPGetWorkerInterface(void);
 
+//------------------------------------------------------------------------------
+// Shared counter, for several workers to claim items of a common list.
+
+typedef struct {
+  void* impl_;            // platform-dependent lock, if any
+  int value;              // next value to hand out. Only to be changed while
+                          // no worker is using the counter.
+} WebPSharedCounter;
+
+// Initializes 'counter' with 'value'. Returns false in case of error.
+int WebPSharedCounterInit(WebPSharedCounter* const counter, int value);
+// Returns the current value and increments it, atomically.
+int WebPSharedCounterNext(WebPSharedCounter* const counter);
+// Releases the resources held by 'counter'.
+void WebPSharedCounterClear(WebPSharedCounter* const counter);
+
 //------------------------------------------------------------------------------
 
 #ifdef __cplusplus
@@ -20,7 +20,7 @@
 extern "C" {
 #endif
 
-#define WEBP_DECODER_ABI_VERSION 0x0209    // MAJOR(8b) + MINOR(8b)
+#define WEBP_DECODER_ABI_VERSION 0x020f    // MAJOR(8b) + MINOR(8b)
 
 // Note: forward declaring enumerations is not allowed in (strict) C and C++,
 // the types are left here for reference.
@@ -33,6 +33,10 @@ typedef struct WebPIDecoder WebPIDecoder;
 typedef struct WebPBitstreamFeatures WebPBitstreamFeatures;
 typedef struct WebPDecoderOptions WebPDecoderOptions;
 typedef struct WebPDecoderConfig WebPDecoderConfig;
+typedef struct WebPDecStats WebPDecStats;
+typedef struct WebPDecoderContext WebPDecoderContext;
+typedef struct WebPDecodeJob WebPDecodeJob;
+typedef struct WebPDecodeBatchOptions WebPDecodeBatchOptions;
 
 // Return the decoder's version number, packed in hexadecimal using 8bits for
 // each of major/minor/revision. E.g: v2.5.7 is 0x020507.
@@ -157,7 +161,10 @@ typedef enum WEBP_CSP_MODE {
   MODE_rgbA_4444 = 10,
   // YUV modes must come after RGB ones.
   MODE_YUV = 11, MODE_YUVA = 12,  // yuv 4:2:0
-  MODE_LAST = 13
+  // yuv 4:2:0 semi-planar: a luma plane followed by a single chroma plane
+  // with interleaved samples, U first for NV12 and V first for NV21.
+  MODE_NV12 = 13, MODE_NV21 = 14,
+  MODE_LAST = 15
 } WEBP_CSP_MODE;
 
 // Some useful macros:
@@ -176,6 +183,10 @@ static WEBP_INLINE int WebPIsRGBMode(WEBP_CSP_MODE mode) {
   return (mode < MODE_YUV);
 }
 
+static WEBP_INLINE int WebPIsSemiPlanarMode(WEBP_CSP_MODE mode) {
+  return (mode == MODE_NV12 || mode == MODE_NV21);
+}
+
 //------------------------------------------------------------------------------
 // WebPDecBuffer: Generic structure for describing the output sample buffer.
 
@@ -194,6 +205,11 @@ struct WebPYUVABuffer {              // view as YUVA
   size_t u_size, v_size;      // chroma planes size
   size_t a_size;              // alpha-plane size
 };
+// For the semi-planar modes (MODE_NV12 / MODE_NV21), 'u' and 'v' point to the
+// first U and V samples of the shared interleaved chroma plane (so that
+// v == u + 1 for NV12 and u == v + 1 for NV21), both chroma strides are equal
+// to the stride of that plane, and 'u_size' / 'v_size' are the number of bytes
+// available from the respective pointer. There is no alpha plane.
 
 // Output buffer
 struct WebPDecBuffer {
@@ -339,6 +355,24 @@ WEBP_EXTERN VP8StatusCode WebPIAppend(
 WEBP_EXTERN VP8StatusCode WebPIUpdate(
     WebPIDecoder* idec, const uint8_t* data, size_t data_size);
 
+// Signals that the decoder no longer needs a buffer passed to
+// WebPIAppendSegment().
+typedef void (*WebPIReleaseFunc)(const uint8_t* data, size_t data_size,
+                                 void* user_data);
+
+// Same as WebPIAppend(), but 'data' is not copied once the decoder has reached
+// the compressed pixel data: the buffer is then read in place, as one segment
+// of the bitstream, and kept until it has been consumed. 'release' (if not
+// NULL) is called exactly once with 'data', 'data_size' and 'user_data' when
+// the buffer is no longer needed. This can happen before the function returns,
+// for instance if the data was copied or in case of error, and at the latest
+// from WebPIDelete(). Until then, the content of 'data' must not be changed.
+// Calls to WebPIAppend() and WebPIAppendSegment() can be mixed.
+// Note: lossy bitstreams with several token partitions are always copied.
+WEBP_EXTERN VP8StatusCode WebPIAppendSegment(
+    WebPIDecoder* idec, const uint8_t* data, size_t data_size,
+    WebPIReleaseFunc release, void* user_data);
+
 // Returns the RGB/A image decoded so far. Returns NULL if output params
 // are not initialized yet. The RGB/A output type corresponds to the colorspace
 // specified during call to WebPINewDecoder() or WebPINewRGB().
@@ -457,7 +491,51 @@ struct WebPDecoderOptions {
   int flip;                           // if true, flip output vertically
   int alpha_dithering_strength;       // alpha dithering strength in [0..100]
 
-  uint32_t pad[5];                    // padding for later use
+  WebPDecStats* stats;                // If not NULL, filled with statistics
+                                      // (reset at the start of decoding).
+                                      // Timing has a small cost, there's none
+                                      // otherwise.
+
+  // padding for later use. 'stats' took the place of the first pad words.
+  // Note: on 64-bit platforms the pointer is 8-byte aligned, so the size of a
+  // standalone WebPDecoderOptions went from 76 to 80 bytes. WebPDecoderConfig
+  // absorbs this in its tail padding and kept its size and field offsets.
+  uint32_t pad[5 - sizeof(WebPDecStats*) / sizeof(uint32_t)];
+};
+
+// Decoding stages, for the timings of WebPDecStats.
+typedef enum WEBP_DEC_STAGE {
+  WEBP_DEC_STAGE_HEADERS = 0,     // container, frame and lossless headers
+                                  // (including the lossless transform data)
+  WEBP_DEC_STAGE_ENTROPY,         // coefficient or pixel entropy decoding
+  WEBP_DEC_STAGE_RECONSTRUCTION,  // lossy prediction and inverse transforms,
+                                  // or lossless inverse transforms
+  WEBP_DEC_STAGE_FILTER,          // lossy loop filter and dithering
+  WEBP_DEC_STAGE_ALPHA,           // alpha plane decoding and smoothing
+  WEBP_DEC_STAGE_EMIT,            // output colorspace conversion
+  WEBP_DEC_STAGE_RESCALE,         // rescaling, with the output conversion
+  WEBP_DEC_STAGE_LAST
+} WEBP_DEC_STAGE;
+
+// Statistics filled by the decoder when WebPDecoderOptions::stats is set.
+// The timings are summed per stage, over all the threads used. With
+// 'use_threads', stages run in parallel and their sum can exceed the total
+// decoding time.
+struct WebPDecStats {
+  size_t bytes_consumed;    // size of the bitstream up to the end of the
+                            // image data chunk
+  int num_macroblocks;      // number of decoded lossy macroblocks
+  int num_partitions;       // number of lossy token partitions
+  uint32_t transforms;      // lossless transforms: bit (1 << type) is set for
+                            // each VP8LImageTransformType present
+  int use_threads;          // true if side threads were used
+  size_t peak_memory;       // size of the working buffers, in bytes, output
+                            // buffer excluded. These all live at once.
+
+  double wall_time[WEBP_DEC_STAGE_LAST];  // wall-clock time, in seconds
+  double cpu_time[WEBP_DEC_STAGE_LAST];   // CPU time, in seconds
+
+  uint32_t pad[4];          // padding for later use
 };
 
 // Main object storing the configuration for advanced decoding.
@@ -499,6 +577,112 @@ WEBP_NODISCARD WEBP_EXTERN WebPIDecoder* WebPIDecode(
 WEBP_EXTERN VP8StatusCode WebPDecode(const uint8_t* data, size_t data_size,
                                      WebPDecoderConfig* config);
 
+//------------------------------------------------------------------------------
+// Reusable decoding context
+//
+// When decoding many pictures in a row, a WebPDecoderContext avoids setting up
+// and tearing down the decoder for each of them: the decoder objects, their
+// scratch buffers (sized for the largest picture seen so far), the Huffman
+// tables and the worker threads are kept from one call to the next.
+// A context must not be used by several threads at the same time. Use one
+// context per thread instead.
+//
+// Typical usage:
+//
+//   WebPDecoderContext* const ctx = WebPDecoderContextNew();
+//   for (each picture) {
+//     ... initialize 'config' as for WebPDecode() ...
+//     status = WebPDecodeWithContext(ctx, data, data_size, &config);
+//     ... use config.output, then WebPFreeDecBuffer(&config.output) ...
+//   }
+//   WebPDecoderContextDelete(ctx);
+
+// Returns a new decoding context, or NULL in case of memory error.
+WEBP_NODISCARD WEBP_EXTERN WebPDecoderContext* WebPDecoderContextNew(void);
+
+// Same as WebPDecode(), but reusing the resources held by 'context'.
+WEBP_EXTERN VP8StatusCode WebPDecodeWithContext(WebPDecoderContext* context,
+                                                const uint8_t* data,
+                                                size_t data_size,
+                                                WebPDecoderConfig* config);
+
+// Releases the memory and the threads held by 'context', which remains usable.
+WEBP_EXTERN void WebPDecoderContextReset(WebPDecoderContext* context);
+
+// Releases 'context' and all its resources.
+WEBP_EXTERN void WebPDecoderContextDelete(WebPDecoderContext* context);
+
+//------------------------------------------------------------------------------
+// Batch decoding
+//
+// WebPDecodeBatch() decodes a set of independent pictures, spreading them over
+// a pool of worker threads. This pays off for many small pictures, which are
+// too small to be decoded with 'use_threads' efficiently. Each thread reuses
+// its own decoding context (see above) from one picture to the next.
+//
+// Typical usage:
+//
+//   WebPDecodeJob jobs[N];
+//   for (i = 0; i < N; ++i) {
+//     jobs[i].data = ...; jobs[i].data_size = ...;
+//     jobs[i].config = &configs[i];   // initialized as for WebPDecode()
+//   }
+//   WebPDecodeBatchOptions options;
+//   if (!WebPDecodeBatchOptionsInit(&options)) return;  // version error
+//   options.num_threads = 8;    // optional, or pass NULL options instead
+//   status = WebPDecodeBatch(jobs, N, &options);
+//   ... check jobs[i].status, use and free configs[i].output ...
+
+// One picture to decode.
+struct WebPDecodeJob {
+  const uint8_t* data;          // input bitstream
+  size_t data_size;
+  WebPDecoderConfig* config;    // options and output, as for WebPDecode()
+  VP8StatusCode status;         // decoding status, set by WebPDecodeBatch()
+  void* user_data;              // free for the caller's use
+};
+
+// Called on the calling thread for each decoded job, in the order of the jobs
+// array. Returning 0 stops the batch.
+typedef int (*WebPDecodeJobHook)(WebPDecodeJob* job, void* user_data);
+
+struct WebPDecodeBatchOptions {
+  int num_threads;          // number of decoding threads, including the
+                            // calling one. 0 means the default (4).
+  int max_in_flight;        // maximum number of jobs decoded ahead of the
+                            // 'hook' calls. 0 means no limit.
+  WebPDecodeJobHook hook;   // optional, called for each decoded job
+  void* user_data;          // passed to 'hook'
+
+  uint32_t pad[4];          // padding for later use
+};
+
+// Internal, version-checked, entry point.
+WEBP_NODISCARD WEBP_EXTERN int WebPDecodeBatchOptionsInitInternal(
+    WebPDecodeBatchOptions*, int);
+
+// Should always be called, to initialize a fresh WebPDecodeBatchOptions
+// structure before modification. Returns false in case of version mismatch.
+WEBP_NODISCARD static WEBP_INLINE int WebPDecodeBatchOptionsInit(
+    WebPDecodeBatchOptions* options) {
+  return WebPDecodeBatchOptionsInitInternal(options,
+                                            WEBP_DECODER_ABI_VERSION);
+}
+
+// Decodes the 'num_jobs' pictures of 'jobs'. 'options' can be NULL, in which
+// case the default options are used. Otherwise, it must have been initialized
+// with WebPDecodeBatchOptionsInit().
+// Jobs are handed out to the threads in groups of 'max_in_flight': 'hook' is
+// called for a group once it is entirely decoded, before the next group is
+// started. This bounds the memory used by pending outputs. Within a group,
+// each thread takes the next pending job as soon as it is done with one.
+// Returns VP8_STATUS_OK once all jobs have been processed (each job's own
+// result is in its 'status' field), VP8_STATUS_USER_ABORT if 'hook' stopped
+// the batch (the jobs that were not decoded then have this status too), or
+// another error code if the batch could not be run.
+WEBP_EXTERN VP8StatusCode WebPDecodeBatch(
+    WebPDecodeJob* jobs, int num_jobs, const WebPDecodeBatchOptions* options);
+
 #ifdef __cplusplus
 }    // extern "C"
 #endif
@@ -56,7 +56,7 @@
 extern "C" {
 #endif
 
-#define WEBP_DEMUX_ABI_VERSION 0x0107    // MAJOR(8b) + MINOR(8b)
+#define WEBP_DEMUX_ABI_VERSION 0x0108    // MAJOR(8b) + MINOR(8b)
 
 // Note: forward declaring enumerations is not allowed in (strict) C and C++,
 // the types are left here for reference.
@@ -66,6 +66,7 @@ typedef struct WebPDemuxer WebPDemuxer;
 typedef struct WebPIterator WebPIterator;
 typedef struct WebPChunkIterator WebPChunkIterator;
 typedef struct WebPAnimInfo WebPAnimInfo;
+typedef struct WebPAnimRect WebPAnimRect;
 typedef struct WebPAnimDecoderOptions WebPAnimDecoderOptions;
 
 //------------------------------------------------------------------------------
@@ -302,6 +303,12 @@ struct WebPAnimInfo {
   uint32_t pad[4];   // padding for later use
 };
 
+// A rectangle of the canvas.
+struct WebPAnimRect {
+  int x_offset, y_offset;
+  int width, height;
+};
+
 // Get global information about the animation.
 // Parameters:
 //   dec - (in) decoder instance to get information from.
@@ -316,6 +323,8 @@ WEBP_NODISCARD WEBP_EXTERN int WebPAnimDecoderGetInfo(
 // 'canvas_width * 4 * canvas_height', and not just the frame sub-rectangle. The
 // returned buffer 'buf' is valid only until the next call to
 // WebPAnimDecoderGetNext(), WebPAnimDecoderReset() or WebPAnimDecoderDelete().
+// The content of 'buf' must not be modified, as the next canvas is
+// reconstructed on top of it.
 // Parameters:
 //   dec - (in/out) decoder instance from which the next frame is to be fetched.
 //   buf - (out) decoded frame.
@@ -344,6 +353,19 @@ WEBP_NODISCARD WEBP_EXTERN int WebPAnimDecoderHasMoreFrames(
 //   dec - (in/out) decoder instance to be reset
 WEBP_EXTERN void WebPAnimDecoderReset(WebPAnimDecoder* dec);
 
+// Get the area of the canvas that was changed by the last call to
+// WebPAnimDecoderGetNext(), compared to the canvas returned by the call before.
+// Pixels outside of this rectangle are unchanged, so renderers only need to
+// update this region. After the first frame, this is the whole canvas.
+// Parameters:
+//   dec - (in) decoder instance.
+//   rect - (out) changed area of the canvas.
+// Returns:
+//   False if any of the arguments are NULL, or if no frame was decoded since
+//   the creation or the last reset of 'dec'. Otherwise, returns true.
+WEBP_NODISCARD WEBP_EXTERN int WebPAnimDecoderGetDirtyRect(
+    const WebPAnimDecoder* dec, WebPAnimRect* rect);
+
 // Grab the internal demuxer object.
 // Getting the demuxer object can be useful if one wants to use operations only
 // available through demuxer; e.g. to get XMP/EXIF/ICC metadata. The returned
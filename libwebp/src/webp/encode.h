@@ -20,7 +20,7 @@
 extern "C" {
 #endif
 
-#define WEBP_ENCODER_ABI_VERSION 0x0210  // MAJOR(8b) + MINOR(8b)
+#define WEBP_ENCODER_ABI_VERSION 0x0216  // MAJOR(8b) + MINOR(8b)
 
 // Note: forward declaring enumerations is not allowed in (strict) C and C++,
 // the types are left here for reference.
@@ -31,7 +31,11 @@ extern "C" {
 typedef struct WebPConfig WebPConfig;
 typedef struct WebPPicture WebPPicture;   // main structure for I/O
 typedef struct WebPAuxStats WebPAuxStats;
+typedef struct WebPEncStageStats WebPEncStageStats;
 typedef struct WebPMemoryWriter WebPMemoryWriter;
+typedef struct WebPWriterChunk WebPWriterChunk;
+typedef struct WebPChunkedWriter WebPChunkedWriter;
+typedef struct WebPEncoderContext WebPEncoderContext;
 
 // Return the encoder's version number, packed in hexadecimal using 8bits for
 // each of major/minor/revision. E.g: v2.5.7 is 0x020507.
@@ -118,6 +122,9 @@ struct WebPConfig {
                           // 1 = compressed with WebP lossless). Default is 1.
   int alpha_filtering;    // Predictive filtering method for alpha plane.
                           //  0: none, 1: fast, 2: best. Default if 1.
+                          // With 'thread_level', the 'best' trials run
+                          // concurrently, each with its own filtered copy
+                          // of the alpha plane (up to 4x the memory).
   int alpha_quality;      // Between 0 (smallest size) and 100 (lossless).
                           // Default is 100.
   int pass;               // number of entropy-analysis passes (in [1..10]).
@@ -136,6 +143,7 @@ struct WebPConfig {
                           // JPEG compression. Generally, the output size will
                           // be similar but the degradation will be lower.
   int thread_level;       // If non-zero, try and use multi-threaded encoding.
+                          // This only changes the speed, not the output.
   int low_memory;         // If set, reduce memory usage (but increase CPU use).
 
   int near_lossless;      // Near lossless encoding [0 = max loss .. 100 = off
@@ -147,6 +155,8 @@ struct WebPConfig {
 
   int use_delta_palette;  // reserved
   int use_sharp_yuv;      // if needed, use sharp (and slow) RGB->YUV conversion
+                          // 1: exact, 2: refined by bands on several threads,
+                          // faster but the output differs slightly from 1.
 
   int qmin;               // minimum permissible quality factor
   int qmax;               // maximum permissible quality factor
@@ -202,8 +212,26 @@ WEBP_NODISCARD WEBP_EXTERN int WebPValidateConfig(const WebPConfig* config);
 
 //------------------------------------------------------------------------------
 // Input / Output
-// Structure for storing auxiliary statistics.
 
+// Encoding stages, for the timings of WebPEncStageStats.
+typedef enum WEBP_ENC_STAGE {
+  WEBP_ENC_STAGE_CONVERSION = 0,  // RGB/YUV import and conversion, including
+                                  // sharp YUV and transparent area cleanup
+  WEBP_ENC_STAGE_ANALYSIS,        // lossy segment and complexity analysis
+  WEBP_ENC_STAGE_PASSES,          // lossy size/PSNR search passes
+  WEBP_ENC_STAGE_ENCODE,          // lossy final coding pass (with trellis),
+                                  // token emission and bitstream assembly
+  WEBP_ENC_STAGE_ALPHA,           // alpha plane filtering and compression
+  WEBP_ENC_STAGE_TRANSFORMS,      // lossless analysis, transform search and
+                                  // transform data coding
+  WEBP_ENC_STAGE_HASH_CHAIN,      // lossless hash chain construction
+  WEBP_ENC_STAGE_BACKWARD_REFS,   // lossless backward references search
+  WEBP_ENC_STAGE_HISTOGRAMS,      // lossless histogram clustering
+  WEBP_ENC_STAGE_ENTROPY_CODING,  // lossless Huffman codes and symbol coding
+  WEBP_ENC_STAGE_LAST
+} WEBP_ENC_STAGE;
+
+// Structure for storing auxiliary statistics.
 struct WebPAuxStats {
   int coded_size;         // final size
 
@@ -235,6 +263,18 @@ struct WebPAuxStats {
   uint32_t pad[1];  // padding for later use
 };
 
+// Structure for storing the time spent in each encoding stage.
+// The timings are summed per stage, over all the threads used. With
+// 'thread_level', stages run in parallel and their sum can exceed the total
+// encoding time.
+struct WebPEncStageStats {
+  double wall_time[WEBP_ENC_STAGE_LAST];  // wall-clock time, in seconds
+  double cpu_time[WEBP_ENC_STAGE_LAST];   // CPU time, in seconds
+  int num_crunch_configs;                 // lossless parameter sets tried
+
+  uint32_t pad[3];  // padding for later use
+};
+
 // Signature for output function. Should return true if writing was successful.
 // data/data_size is the segment of data to write, and 'picture' is for
 // reference (and so one can make use of picture->custom_ptr).
@@ -262,6 +302,51 @@ WEBP_EXTERN void WebPMemoryWriterClear(WebPMemoryWriter* writer);
 WEBP_NODISCARD WEBP_EXTERN int WebPMemoryWrite(
     const uint8_t* data, size_t data_size, const WebPPicture* picture);
 
+// WebPChunkedWrite: a special WebPWriterFunction that collects the output in a
+// list of fixed-size memory blocks, using the following WebPChunkedWriter
+// object (to be set as a custom_ptr). Contrary to WebPMemoryWrite(), the data
+// already written is never moved or copied again as the output grows.
+struct WebPWriterChunk {
+  uint8_t* data;      // start of the block
+  size_t   size;      // number of bytes used in the block
+};
+// Note: WebPWriterChunk has the same layout as 'struct iovec' on POSIX systems,
+// so writer.chunks can be passed as is to writev() or sendmsg().
+
+struct WebPChunkedWriter {
+  WebPWriterChunk* chunks;  // filled blocks, in order
+  int      num_chunks;      // number of entries in 'chunks'
+  size_t   size;            // total size of the data
+  size_t   block_size;      // capacity of each block
+  int      max_chunks;      // allocated size of 'chunks'
+  uint32_t pad[2];          // padding for later use
+};
+
+// The following must be called first before any use. 'block_size' is the
+// capacity of each block, a default value is used if it is 0.
+WEBP_EXTERN void WebPChunkedWriterInit(WebPChunkedWriter* writer,
+                                       size_t block_size);
+
+// Deallocates all the blocks. The 'writer' object itself is not deallocated.
+WEBP_EXTERN void WebPChunkedWriterClear(WebPChunkedWriter* writer);
+
+// Copies the collected data into 'dst', which must hold at least writer->size
+// bytes. Returns the number of bytes copied.
+WEBP_EXTERN size_t WebPChunkedWriterCopy(const WebPChunkedWriter* writer,
+                                         uint8_t* dst);
+
+// The custom writer to be used with WebPChunkedWriter as custom_ptr. Upon
+// completion, writer.chunks[0..num_chunks-1] hold the coded data.
+WEBP_NODISCARD WEBP_EXTERN int WebPChunkedWrite(
+    const uint8_t* data, size_t data_size, const WebPPicture* picture);
+
+// WebPFileWrite: a special WebPWriterFunction that passes the output directly
+// to a stdio FILE* (to be set as custom_ptr) as it is produced, without
+// intermediate buffering. For a file descriptor, the FILE* can be obtained
+// with fdopen().
+WEBP_NODISCARD WEBP_EXTERN int WebPFileWrite(
+    const uint8_t* data, size_t data_size, const WebPPicture* picture);
+
 // Progress hook, called from time to time to report progress. It can return
 // false to request an abort of the encoding process, or true otherwise if
 // everything is OK.
@@ -356,15 +441,22 @@ struct WebPPicture {
 
   uint32_t pad3[3];       // padding for later use
 
+  // Pointer to per-stage timings (updated only if not NULL). Timing has a
+  // small cost, there's none otherwise.
+  WebPEncStageStats* stage_stats;
+
   // Unused for now
-  uint8_t* pad4, *pad5;
-  uint32_t pad6[8];       // padding for later use
+  uint8_t* pad5;
+  uint32_t pad6[6];       // padding for later use
 
   // PRIVATE FIELDS
   ////////////////////
+  int view_stride_;       // borrowed samples set by WebPPictureImportView():
+  int view_order_;        // stride in bytes and WebPChannelOrder.
   void* memory_;          // row chunk of memory for yuva planes
   void* memory_argb_;     // and for argb too.
-  void* pad7[2];          // padding for later use
+  const uint8_t* view_;   // borrowed samples, or NULL.
+  void* pad7[1];          // padding for later use
 };
 
 // Internal, version-checked, entry point
@@ -462,6 +554,16 @@ WEBP_EXTERN int WebPPictureIsView(const WebPPicture* picture);
 WEBP_NODISCARD WEBP_EXTERN int WebPPictureRescale(WebPPicture* picture,
                                                   int width, int height);
 
+// Same as WebPPictureRescale(), but the Y plane, the U/V planes and the alpha
+// plane of a YUV(A) picture are rescaled concurrently, on up to 3 threads.
+// The result is the same. ARGB pictures (use_argb = true) are still rescaled
+// in a single pass on the calling thread, since their one plane can't be split
+// into row bands without changing the output. Small pictures are rescaled
+// serially too. In case of error, 'picture->error_code' is set to
+// VP8_ENC_ERROR_OUT_OF_MEMORY if a thread could not be started.
+WEBP_NODISCARD WEBP_EXTERN int WebPPictureRescaleMT(WebPPicture* picture,
+                                                    int width, int height);
+
 // Colorspace conversion function to import RGB samples.
 // Previous buffer will be free'd, if any.
 // *rgb buffer should have a size of at least height * rgb_stride.
@@ -485,6 +587,35 @@ WEBP_NODISCARD WEBP_EXTERN int WebPPictureImportBGRA(
 WEBP_NODISCARD WEBP_EXTERN int WebPPictureImportBGRX(
     WebPPicture* picture, const uint8_t* bgrx, int bgrx_stride);
 
+// Byte order of the packed samples passed to WebPPictureImportView().
+typedef enum WebPChannelOrder {
+  WEBP_ORDER_RGB = 0,
+  WEBP_ORDER_BGR,
+  WEBP_ORDER_RGBA,
+  WEBP_ORDER_BGRA,
+  WEBP_ORDER_ARGB,
+  WEBP_ORDER_ABGR,
+  WEBP_ORDER_RGBX,   // the fourth byte is ignored
+  WEBP_ORDER_BGRX,
+  WEBP_ORDER_LAST
+} WebPChannelOrder;
+
+// Makes 'picture' a read-only view of the caller's packed samples, stored in
+// 'order' with 'stride' bytes per row. picture->width and picture->height
+// must be set beforehand. Previous buffer will be free'd, if any.
+// Contrary to the WebPPictureImportXXX() functions above, nothing is copied:
+// WebPEncode() converts the samples directly to YUV(A) for lossy encoding, and
+// reads them in place for lossless encoding when they are already in the
+// native ARGB layout (WEBP_ORDER_BGRA on little-endian platforms). The
+// 'rgba' buffer must therefore remain valid and unchanged until the picture
+// is free'd. Upon return, picture->use_argb is set to true but picture->argb
+// is NULL: the other picture tools (cropping, rescaling...) need a proper
+// import instead.
+// Returns false in case of invalid parameter.
+WEBP_NODISCARD WEBP_EXTERN int WebPPictureImportView(
+    WebPPicture* picture, const uint8_t* rgba, int stride,
+    WebPChannelOrder order);
+
 // Converts picture->argb data to the YUV420A format. The 'colorspace'
 // parameter is deprecated and should be equal to WEBP_YUV420.
 // Upon return, picture->use_argb is set to false. The presence of real
@@ -549,6 +680,33 @@ WEBP_EXTERN void WebPBlendAlpha(WebPPicture* picture, uint32_t background_rgb);
 WEBP_NODISCARD WEBP_EXTERN int WebPEncode(const WebPConfig* config,
                                           WebPPicture* picture);
 
+//------------------------------------------------------------------------------
+// Reusable encoding context
+//
+// When encoding many pictures in a row, a WebPEncoderContext keeps the
+// encoder's working memory from one call to the next: the lossy encoder state
+// and token pages, and the lossless encoders with their hash chain, backward
+// references, transform buffers, histogram sets and bit writers. Memory is
+// reused as long as it is large enough, which is always the case for pictures
+// of the same dimensions encoded with the same config.
+// A context must not be used by several threads at the same time. Use one
+// context per thread instead.
+
+// Returns a new encoding context, or NULL in case of memory error.
+WEBP_NODISCARD WEBP_EXTERN WebPEncoderContext* WebPEncoderContextNew(void);
+
+// Same as WebPEncode(), but reusing the memory held by 'context'.
+WEBP_NODISCARD WEBP_EXTERN int WebPEncodeWithContext(
+    WebPEncoderContext* context, const WebPConfig* config,
+    WebPPicture* picture);
+
+// Releases the memory held by 'context', which remains usable. This can be
+// called to trim memory after encoding a picture larger than the usual ones.
+WEBP_EXTERN void WebPEncoderContextReset(WebPEncoderContext* context);
+
+// Releases 'context' and all its memory.
+WEBP_EXTERN void WebPEncoderContextDelete(WebPEncoderContext* context);
+
 //------------------------------------------------------------------------------
 
 #ifdef __cplusplus
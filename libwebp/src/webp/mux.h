@@ -22,7 +22,7 @@
 extern "C" {
 #endif
 
-#define WEBP_MUX_ABI_VERSION 0x0109        // MAJOR(8b) + MINOR(8b)
+#define WEBP_MUX_ABI_VERSION 0x010a        // MAJOR(8b) + MINOR(8b)
 
 //------------------------------------------------------------------------------
 // Mux API
@@ -68,6 +68,7 @@ extern "C" {
 typedef struct WebPMux WebPMux;   // main opaque object.
 typedef struct WebPMuxFrameInfo WebPMuxFrameInfo;
 typedef struct WebPMuxAnimParams WebPMuxAnimParams;
+typedef struct WebPMuxSegments WebPMuxSegments;
 typedef struct WebPAnimEncoderOptions WebPAnimEncoderOptions;
 
 // Error codes
@@ -401,6 +402,40 @@ WEBP_EXTERN WebPMuxError WebPMuxNumChunks(const WebPMux* mux,
 WEBP_EXTERN WebPMuxError WebPMuxAssemble(WebPMux* mux,
                                          WebPData* assembled_data);
 
+// Assembled WebP data, as an ordered list of memory segments.
+struct WebPMuxSegments {
+  const WebPData* segments;  // list of segments, to be output in order
+  int num_segments;          // number of entries in 'segments'
+  size_t size;               // total size of the assembled data
+  void* memory_;             // private: storage for segments and headers
+  uint32_t pad[4];           // padding for later use
+};
+// Note: WebPData has the same layout as 'struct iovec' on POSIX systems, so
+// 'segments' can be passed as is to writev() or sendmsg().
+
+// Same as WebPMuxAssemble(), except that the chunk payloads are not copied.
+// Only the RIFF and chunk headers, padding and small payloads are written to
+// memory owned by 'assembled_segments', the other segments point directly to
+// the chunk data held by the mux (which is the caller's data if the chunks were
+// added with copy_data = 0). These segments are only valid until the 'mux' is
+// modified or deleted, or the referenced data is released.
+// 'assembled_segments' MUST be released by calling WebPMuxSegmentsClear(),
+// even in case of error.
+// Parameters:
+//   mux - (in/out) object whose chunks are to be assembled
+//   assembled_segments - (out) assembled WebP data segments
+// Returns:
+//   WEBP_MUX_BAD_DATA - if mux object is invalid.
+//   WEBP_MUX_INVALID_ARGUMENT - if mux or assembled_segments is NULL.
+//   WEBP_MUX_MEMORY_ERROR - on memory allocation error.
+//   WEBP_MUX_OK - on success.
+WEBP_EXTERN WebPMuxError WebPMuxAssembleSegments(
+    WebPMux* mux, WebPMuxSegments* assembled_segments);
+
+// Releases the memory owned by 'assembled_segments' (but not the structure
+// itself) and resets its content.
+WEBP_EXTERN void WebPMuxSegmentsClear(WebPMuxSegments* assembled_segments);
+
 //------------------------------------------------------------------------------
 // WebPAnimEncoder API
 //